@@ -0,0 +1,57 @@
+#include "alu-bench.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+
+namespace gameboy {
+    alu_bench::alu_bench() : _operands(4096)
+    {
+        std::default_random_engine generator;
+        std::uniform_int_distribution<int> distribution{0, 255};
+        for (auto& operand : _operands) {
+            operand = static_cast<byte>(distribution(generator));
+        }
+    }
+
+    double alu_bench::test_arithmetic(int round_count) const
+    {
+        return run(_alu, round_count, "Arithmetic ALU");
+    }
+
+#ifdef GAMEBOY_ALU_TABLES
+    double alu_bench::test_table(int round_count) const
+    {
+        return run(_alu_table, round_count, "Table ALU");
+    }
+#endif
+
+    // each round is ADD, ADC, DAA, SUB, SBC, CP feeding the accumulator and the carry forward
+    template<typename Alu>
+    double alu_bench::run(const Alu& backend, int round_count, const std::string& name) const
+    {
+        byte accumulator = 0;
+        flags status;
+        auto zero_count = 0;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < round_count; ++i) {
+            const auto operand = _operands[i % _operands.size()];
+            auto output = backend.add(accumulator, operand);
+            output = backend.add(output.result, operand, output.status[flag_type::carry]);
+            output = backend.daa(output.result, output.status);
+            output = backend.subtract(output.result, operand);
+            output = backend.subtract(output.result, operand, output.status[flag_type::carry]);
+            accumulator = output.result;
+            status = backend.subtract(accumulator, operand).status;
+            zero_count += status[flag_type::zero];
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = round_count * 6 / elapsed.count();
+        std::cout << "Bench " << name << ": " << rate / 1e6 << " M operations/s (" << zero_count << " zero)"
+            << std::endl;
+
+        return rate;
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef ALU_BENCH_H
+#define ALU_BENCH_H
+
+#include <string>
+#include <vector>
+#include "alu.h"
+#ifdef GAMEBOY_ALU_TABLES
+#include "alu-table.h"
+#endif
+#include "byte.h"
+
+namespace gameboy {
+    class alu_bench {
+    public:
+        alu_bench();
+        double test_arithmetic(int round_count) const;
+#ifdef GAMEBOY_ALU_TABLES
+        double test_table(int round_count) const;
+#endif
+    private:
+        template<typename Alu>
+        double run(const Alu& backend, int round_count, const std::string& name) const;
+
+        gameboy::alu _alu;
+#ifdef GAMEBOY_ALU_TABLES
+        gameboy::alu_table _alu_table;
+#endif
+        std::vector<byte> _operands;
+    };
+}
+
+#endif
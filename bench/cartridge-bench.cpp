@@ -0,0 +1,71 @@
+#include "cartridge-bench.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <vector>
+#include "cartridge.h"
+#include "memory.h"
+
+namespace gameboy {
+    cartridge_bench::cartridge_bench() : _path("gameboy-bench-cartridge.gb")
+    {
+        std::vector<byte> rom(64 * cartridge::ROM_BANK_SIZE);
+        for (std::size_t address = 0; address < rom.size(); ++address) {
+            rom[address] = static_cast<byte>(address * 7);
+        }
+        for (auto address = 0x0134; address < 0x0150; ++address) {
+            rom[static_cast<std::size_t>(address)] = 0x00;
+        }
+        rom[0x0147] = 0x19;
+        rom[0x0148] = 0x05;
+        rom[0x014D] = cartridge::compute_header_checksum(rom.data());
+
+        std::ofstream output{_path, std::ios::binary};
+        output.write(reinterpret_cast<const char*>(rom.data()), static_cast<std::streamsize>(rom.size()));
+    }
+
+    cartridge_bench::~cartridge_bench()
+    {
+        std::remove(_path.c_str());
+    }
+
+    double cartridge_bench::test_copied(int instance_count) const
+    {
+        std::vector<memory> instances(static_cast<std::size_t>(instance_count));
+        const auto start = std::chrono::steady_clock::now();
+        for (auto& instance : instances) {
+            std::ifstream input{_path, std::ios::binary};
+            std::vector<byte> rom{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+            instance.insert(std::make_shared<const cartridge>(std::move(rom)));
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = instance_count / elapsed.count();
+        const auto footprint = instances.front().get_footprint() + 64 * cartridge::ROM_BANK_SIZE;
+        std::cout << "Bench Copied ROM: " << rate << " instances/s (" << footprint / 1024 << " KiB each)" << std::endl;
+
+        return rate;
+    }
+
+    double cartridge_bench::test_shared(int instance_count) const
+    {
+        std::vector<memory> instances(static_cast<std::size_t>(instance_count));
+        const auto start = std::chrono::steady_clock::now();
+        const auto shared = cartridge::load(_path);
+        for (auto& instance : instances) {
+            instance.insert(shared);
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = instance_count / elapsed.count();
+        std::cout << "Bench Shared ROM: " << rate << " instances/s (" << instances.front().get_footprint() / 1024
+            << " KiB each)" << std::endl;
+
+        return rate;
+    }
+}
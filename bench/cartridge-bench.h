@@ -0,0 +1,21 @@
+#ifndef CARTRIDGE_BENCH_H
+#define CARTRIDGE_BENCH_H
+
+#include <string>
+
+namespace gameboy {
+    class cartridge_bench {
+    public:
+        // writes out a 1 MiB MBC5 ROM to start the instances from
+        cartridge_bench();
+        ~cartridge_bench();
+        // every instance reads the file into a cartridge of its own
+        double test_copied(int instance_count) const;
+        // one mapped cartridge inserted into every instance
+        double test_shared(int instance_count) const;
+    private:
+        std::string _path;
+    };
+}
+
+#endif
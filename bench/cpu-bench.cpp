@@ -0,0 +1,152 @@
+#include "cpu-bench.h"
+#include <chrono>
+#include <iostream>
+
+namespace gameboy {
+    cpu_bench::cpu_bench(memory& mem) : _cpu(mem)
+    {
+    }
+
+    double cpu_bench::test_dispatch(int instruction_count)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < instruction_count; ++i) {
+            _cpu.fetch_and_execute();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = instruction_count / elapsed.count();
+        std::cout << "Bench Dispatch: " << rate / 1e6 << " M instructions/s" << std::endl;
+
+        return rate;
+    }
+
+    double cpu_bench::test_run_frame(int frame_count)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < frame_count; ++i) {
+            _cpu.run_frame();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench Run Frame: " << rate << " frames/s" << std::endl;
+
+        return rate;
+    }
+
+    double cpu_bench::test_block_cache(int frame_count)
+    {
+        _cpu.enable_block_cache(true);
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < frame_count; ++i) {
+            _cpu.run_frame();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        _cpu.enable_block_cache(false);
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        const auto& cache = _cpu.get_block_cache();
+        std::cout << "Bench Block Cache: " << rate << " frames/s (" << cache.get_hits() << " hits, "
+            << cache.get_misses() << " misses)" << std::endl;
+
+        return rate;
+    }
+
+    double cpu_bench::test_fusion(int frame_count)
+    {
+        _cpu.enable_block_cache(true);
+        _cpu.enable_fusion(true);
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < frame_count; ++i) {
+            _cpu.run_frame();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        _cpu.enable_fusion(false);
+        _cpu.enable_block_cache(false);
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench Fusion: " << rate << " frames/s (" << _cpu.get_fused_sequences() << " sequences fused)"
+            << std::endl;
+
+        return rate;
+    }
+
+#ifdef GAMEBOY_JIT
+    double cpu_bench::test_jit(int frame_count)
+    {
+        _cpu.enable_jit(true);
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < frame_count; ++i) {
+            _cpu.run_frame();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        _cpu.enable_jit(false);
+        _cpu.enable_block_cache(false);
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench JIT: " << rate << " frames/s (" << _cpu.get_jit().get_compiled_blocks()
+            << " blocks compiled)" << std::endl;
+
+        return rate;
+    }
+#endif
+
+    double cpu_bench::test_prefixed_dispatch(int instruction_count)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < instruction_count; ++i) {
+            _cpu.fetch_and_execute();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = instruction_count / elapsed.count();
+        std::cout << "Bench Prefixed Dispatch: " << rate / 1e6 << " M instructions/s" << std::endl;
+
+        return rate;
+    }
+
+    double cpu_bench::test_halt(int frame_count)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < frame_count; ++i) {
+            _cpu.run_frame();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench Halt: " << rate << " frames/s" << std::endl;
+
+        return rate;
+    }
+
+    double cpu_bench::test_idle(int frame_count, bool skipping)
+    {
+        _cpu.enable_block_cache(true);
+        _cpu.enable_idle_skipping(skipping);
+        const auto skipped = _cpu.get_skipped_cycles();
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < frame_count; ++i) {
+            _cpu.run_frame();
+        }
+        const auto end = std::chrono::steady_clock::now();
+        _cpu.enable_idle_skipping(true);
+        _cpu.enable_block_cache(false);
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        const auto share = 100.0 * static_cast<double>(_cpu.get_skipped_cycles() - skipped)
+            / (static_cast<double>(frame_count) * cpu::CYCLES_PER_FRAME);
+        std::cout << "Bench Idle (skipping " << (skipping ? "on" : "off") << "): " << rate << " frames/s (" << share
+            << "% of cycles skipped)" << std::endl;
+
+        return rate;
+    }
+}
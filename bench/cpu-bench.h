@@ -0,0 +1,32 @@
+#ifndef CPU_BENCH_H
+#define CPU_BENCH_H
+
+#include "cpu.h"
+#include "memory.h"
+
+namespace gameboy {
+    class cpu_bench {
+    public:
+        cpu_bench(memory& mem);
+        double test_dispatch(int instruction_count);
+        double test_run_frame(int frame_count);
+        // test_run_frame with the block cache enabled
+        double test_block_cache(int frame_count);
+        // test_block_cache with common instruction sequences fused
+        double test_fusion(int frame_count);
+#ifdef GAMEBOY_JIT
+        // test_run_frame with hot blocks translated to native code
+        double test_jit(int frame_count);
+#endif
+        // same loop as test_dispatch, for memory filled with 0xCB-prefixed instructions
+        double test_prefixed_dispatch(int instruction_count);
+        // test_run_frame for a program that spends its time in HALT
+        double test_halt(int frame_count);
+        // test_block_cache for a program that spends its time polling memory, with idle loops skipped or run
+        double test_idle(int frame_count, bool skipping);
+    private:
+        cpu _cpu;
+    };
+}
+
+#endif
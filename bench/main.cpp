@@ -0,0 +1,173 @@
+#include <initializer_list>
+#include <limits>
+#include <random>
+#include <vector>
+#include "alu-bench.h"
+#include "cartridge-bench.h"
+#include "cpu-bench.h"
+#include "ppu-bench.h"
+#include "timer.h"
+
+int main()
+{
+    using namespace gameboy;
+
+    memory bench_memory;
+    std::vector<byte> opcodes;
+    // register-only loads and arithmetic, so the program never rewrites itself
+    for (auto opcode = 0x40; opcode < 0xC0; ++opcode) {
+        if (opcode < 0x70 || opcode > 0x77) {
+            opcodes.push_back(static_cast<byte>(opcode));
+        }
+    }
+
+    std::default_random_engine generator;
+    std::uniform_int_distribution<std::size_t> distribution{0, opcodes.size() - 1};
+    constexpr auto lower_bound = std::numeric_limits<unsigned short>::min() + 0;
+    constexpr auto upper_bound = std::numeric_limits<unsigned short>::max() + 1;
+    for (auto address = lower_bound; address < upper_bound; ++address) {
+        bench_memory.set_byte(address, opcodes[distribution(generator)]);
+    }
+
+    cpu_bench bench_cpu{bench_memory};
+    bench_cpu.test_dispatch(50000000);
+    bench_cpu.test_run_frame(5000);
+    bench_cpu.test_block_cache(5000);
+#ifdef GAMEBOY_JIT
+    bench_cpu.test_jit(5000);
+#endif
+
+    // register-only arithmetic, each instruction setting flags the next one overwrites unread, which is what a
+    // GAMEBOY_LAZY_FLAGS build is to be compared with the default one on
+    memory arithmetic_memory;
+    std::vector<byte> arithmetic;
+    for (auto opcode = 0x80; opcode < 0xC0; ++opcode) {
+        if ((opcode & 7) != 6) {
+            arithmetic.push_back(static_cast<byte>(opcode));
+        }
+    }
+    for (const auto opcode : {0x04, 0x05, 0x0C, 0x0D, 0x14, 0x15, 0x1C, 0x1D, 0x24, 0x25, 0x2C, 0x2D, 0x3C, 0x3D}) {
+        arithmetic.push_back(static_cast<byte>(opcode));
+    }
+    std::uniform_int_distribution<std::size_t> arithmetic_distribution{0, arithmetic.size() - 1};
+    // up to the echo of WRAM, and back to the start before the registers could read as some invalid opcode
+    constexpr auto arithmetic_end = 0xE000 - 3;
+    for (auto address = lower_bound; address < arithmetic_end; ++address) {
+        arithmetic_memory.set_byte(address, arithmetic[arithmetic_distribution(generator)]);
+    }
+    arithmetic_memory.set_byte(arithmetic_end, 0xC3);    // JP 0x0000
+
+    cpu_bench bench_arithmetic{arithmetic_memory};
+    bench_arithmetic.test_dispatch(50000000);
+    bench_arithmetic.test_run_frame(5000);
+
+    // register-only CB instructions, mostly BIT/RES/SET like real games
+    memory prefixed_memory;
+    std::uniform_int_distribution<int> prefixed_distribution{0, 0xFF};
+    for (auto address = lower_bound; address < upper_bound; address += 2) {
+        auto opcode = prefixed_distribution(generator);
+        if ((opcode & 7) == 6) {
+            ++opcode;
+        }
+        prefixed_memory.set_byte(address, 0xCB);
+        prefixed_memory.set_byte(address + 1, static_cast<byte>(opcode));
+    }
+
+    cpu_bench bench_prefixed{prefixed_memory};
+    bench_prefixed.test_prefixed_dispatch(50000000);
+
+    // the copy, countdown and polling loops games spend their time in
+    memory idiom_memory;
+    const std::vector<byte> idioms{
+        0x21, 0x00, 0xC0,                   // 0x0000: LD HL, 0xC000
+        0x11, 0x00, 0xD0,                   //         LD DE, 0xD000
+        0x06, 0x40,                         //         LD B, 0x40
+        0x2A, 0x12, 0x13, 0x05, 0x20, 0xFA, // 0x0008: LD A, (HL+); LD (DE), A; INC DE; DEC B; JR NZ, 0x0008
+        0x01, 0x40, 0x00,                   //         LD BC, 0x0040
+        0x0B, 0x78, 0xB1, 0x20, 0xFB,       // 0x0011: DEC BC; LD A, B; OR C; JR NZ, 0x0011
+        0xF0, 0x81, 0xFE, 0x00, 0x20, 0xFA, // 0x0016: LDH A, (0x81); CP 0x00; JR NZ, 0x0016
+        0xC3, 0x00, 0x00,                   //         JP 0x0000
+    };
+    for (std::size_t address = 0; address < idioms.size(); ++address) {
+        idiom_memory.set_byte(static_cast<int>(address), idioms[address]);
+    }
+
+    cpu_bench bench_idioms{idiom_memory};
+    bench_idioms.test_block_cache(5000);
+    bench_idioms.test_fusion(5000);
+
+    // a game waiting for its once-a-frame interrupt, here the timer's every 65536 cycles
+    memory halt_memory;
+    const std::vector<byte> waiting{
+        0x31, 0xFE, 0xFF,                   // 0x0000: LD SP, 0xFFFE
+        0x3E, 0x04, 0xE0, 0xFF,             //         LD A, 0x04; LDH (0xFF), A
+        0x3E, 0xC0, 0xE0, 0x06,             //         LD A, 0xC0; LDH (0x06), A
+        0x3E, 0x04, 0xE0, 0x07,             //         LD A, 0x04; LDH (0x07), A
+        0xFB,                               //         EI
+        0x76, 0x18, 0xFD,                   // 0x0010: HALT; JR 0x0010
+    };
+    for (std::size_t address = 0; address < waiting.size(); ++address) {
+        halt_memory.set_byte(static_cast<int>(address), waiting[address]);
+    }
+    halt_memory.set_byte(0x0050, 0xD9);     // RETI
+
+    timer halt_timer{halt_memory};
+    cpu_bench bench_halt{halt_memory};
+    bench_halt.test_halt(200000);
+
+    // the same wait done by polling a flag the interrupt handler sets
+    memory idle_memory;
+    const std::vector<byte> polling{
+        0x31, 0xFE, 0xFF,                   // 0x0000: LD SP, 0xFFFE
+        0x3E, 0x04, 0xE0, 0xFF,             //         LD A, 0x04; LDH (0xFF), A
+        0x3E, 0xC0, 0xE0, 0x06,             //         LD A, 0xC0; LDH (0x06), A
+        0x3E, 0x04, 0xE0, 0x07,             //         LD A, 0x04; LDH (0x07), A
+        0xFB,                               //         EI
+        0xAF, 0xEA, 0x00, 0xC0,             // 0x0010: XOR A; LD (0xC000), A
+        0xFA, 0x00, 0xC0, 0xB7, 0x28, 0xFA, // 0x0014: LD A, (0xC000); OR A; JR Z, 0x0014
+        0x18, 0xF4,                         //         JR 0x0010
+    };
+    for (std::size_t address = 0; address < polling.size(); ++address) {
+        idle_memory.set_byte(static_cast<int>(address), polling[address]);
+    }
+    // LD A, 0x01; LD (0xC000), A; RETI
+    const std::vector<byte> handler{0x3E, 0x01, 0xEA, 0x00, 0xC0, 0xD9};
+    for (std::size_t offset = 0; offset < handler.size(); ++offset) {
+        idle_memory.set_byte(0x0050 + static_cast<int>(offset), handler[offset]);
+    }
+
+    timer idle_timer{idle_memory};
+    cpu_bench bench_idle{idle_memory};
+    bench_idle.test_idle(2000, false);
+    bench_idle.test_idle(200000, true);
+
+    ppu_bench bench_ppu;
+    for (const auto type : {tile_decoder::kernel::scalar, tile_decoder::kernel::sse2, tile_decoder::kernel::bmi2,
+        tile_decoder::kernel::avx2}) {
+        if (tile_decoder::is_supported(type)) {
+            bench_ppu.test_decode(type, 20000000);
+            bench_ppu.test_composite(type, 20000000);
+            bench_ppu.test_render(type, 2000000);
+        }
+    }
+    bench_ppu.test_frames(true, 20000);
+    bench_ppu.test_frames(false, 200000);
+    bench_ppu.test_framebuffer(framebuffer::format::rgba8888, 20000);
+    bench_ppu.test_framebuffer(framebuffer::format::rgb565, 20000);
+    bench_ppu.test_export(20000);
+    bench_ppu.test_recording("/dev/null", 20000);
+    bench_ppu.test_program(false, 5000);
+    bench_ppu.test_program(true, 5000);
+
+    alu_bench bench_alu;
+    bench_alu.test_arithmetic(20000000);
+#ifdef GAMEBOY_ALU_TABLES
+    bench_alu.test_table(20000000);
+#endif
+
+    cartridge_bench bench_cartridge;
+    bench_cartridge.test_copied(256);
+    bench_cartridge.test_shared(256);
+
+    return 0;
+}
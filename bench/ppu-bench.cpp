@@ -0,0 +1,265 @@
+#include "ppu-bench.h"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "cpu.h"
+#include "line-compositor.h"
+#include "ppu.h"
+#include "registers.h"
+#include "shared-export.h"
+#include "stream-sink.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace gameboy {
+    ppu_bench::ppu_bench()
+    {
+        std::default_random_engine generator{1};
+        std::uniform_int_distribution<int> distribution{0, 255};
+        for (auto address = 0x8000; address < 0xA000; ++address) {
+            _memory.set_byte(address, static_cast<byte>(distribution(generator)));
+        }
+        // ten sprites 8 pixels high every 8 lines, spread across the screen
+        for (auto index = 0; index < 40; ++index) {
+            const auto address = 0xFE00 + index * 4;
+            _memory.set_byte(address, static_cast<byte>(16 + index / 10 * 8));
+            _memory.set_byte(address + 1, static_cast<byte>(8 + index % 10 * 16));
+            _memory.set_byte(address + 2, static_cast<byte>(distribution(generator)));
+            _memory.set_byte(address + 3, static_cast<byte>(distribution(generator) & 0xF0));
+        }
+    }
+
+    double ppu_bench::test_decode(tile_decoder::kernel type, int line_count) const
+    {
+        const tile_decoder decoder{type};
+        std::vector<byte> rows(2 * 21);
+        std::vector<byte> pixels(8 * 21);
+        auto checksum = 0u;
+        const auto start = std::chrono::steady_clock::now();
+        for (auto line = 0; line < line_count; ++line) {
+            // a different pair of bytes for each line, so that nothing is hoisted out of the loop
+            rows[static_cast<std::size_t>(line % 42)] = static_cast<byte>(line);
+            decoder.decode(rows.data(), pixels.data(), 21);
+            checksum += pixels[static_cast<std::size_t>(line % 168)];
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = line_count / elapsed.count();
+        std::cout << "Bench Tile Decode (" << tile_decoder::get_name(decoder.get_kernel()) << "): " << rate / 1e6
+            << " M lines/s (checksum " << checksum << ")" << std::endl;
+
+        return rate;
+    }
+
+    double ppu_bench::test_composite(tile_decoder::kernel type, int line_count) const
+    {
+        const line_compositor compositor{type};
+        line_compositor::positions ys{};
+        for (auto index = 0; index < line_compositor::OAM_ENTRIES; ++index) {
+            ys[static_cast<std::size_t>(index)] = _memory.get_byte(0xFE00 + index * 4);
+        }
+        // every other pixel under a sprite, some of them behind the background
+        std::vector<byte> background(ppu::WIDTH), sprites(ppu::WIDTH), attributes(ppu::WIDTH), output(ppu::WIDTH);
+        for (std::size_t x = 0; x < background.size(); ++x) {
+            background[x] = static_cast<byte>(_memory.get_byte(0x8000 + static_cast<int>(x)) & 3);
+            sprites[x] = static_cast<byte>(x % 2 * (x % 3 + 1));
+            attributes[x] = _memory.get_byte(0x8100 + static_cast<int>(x));
+        }
+        const line_compositor::shades table{{0, 1, 2, 3, 3, 2, 1, 0, 1, 1, 2, 2}};
+        auto checksum = 0u;
+        const auto start = std::chrono::steady_clock::now();
+        for (auto line = 0; line < line_count; ++line) {
+            const auto found = compositor.scan(ys, line % ppu::HEIGHT, 8);
+            // a different pixel for each line, so that nothing is hoisted out of the loop
+            sprites[static_cast<std::size_t>(line) % sprites.size()] = static_cast<byte>(line & 3);
+            compositor.composite(background.data(), sprites.data(), attributes.data(), table, output.data(), output.size());
+            checksum += static_cast<unsigned>(found) + output[static_cast<std::size_t>(line) % output.size()];
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = line_count / elapsed.count();
+        std::cout << "Bench Line Composite (" << tile_decoder::get_name(compositor.get_kernel()) << "): " << rate / 1e6
+            << " M lines/s (checksum " << checksum << ")" << std::endl;
+
+        return rate;
+    }
+
+    double ppu_bench::test_render(tile_decoder::kernel type, int line_count)
+    {
+        ppu video{_memory, type};
+        // background, window from the middle of the screen down and sprites
+        _memory.set_byte(ppu::LCD_CONTROL, 0xF3);
+        _memory.set_byte(ppu::WINDOW_Y, 72);
+        _memory.set_byte(ppu::WINDOW_X, 87);
+        _memory.set_byte(ppu::SCROLL_X, 3);
+        const auto start = std::chrono::steady_clock::now();
+        for (auto line = 0; line < line_count; ++line) {
+            video.render_line(line % ppu::HEIGHT);
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = line_count / elapsed.count();
+        std::cout << "Bench PPU Render (" << tile_decoder::get_name(video.get_decoder().get_kernel()) << "): "
+            << rate / 1e6 << " M lines/s" << std::endl;
+
+        return rate;
+    }
+
+    double ppu_bench::test_frames(bool rendering, int frame_count)
+    {
+        ppu video{_memory};
+        _memory.set_byte(ppu::LCD_CONTROL, 0xF3);
+        _memory.set_byte(ppu::WINDOW_Y, 72);
+        _memory.set_byte(ppu::WINDOW_X, 87);
+        _memory.set_byte(ppu::SCROLL_X, 3);
+        video.set_rendering(rendering);
+        auto& events = _memory.get_scheduler();
+        // up to line 0 of the next frame, which is where the setting takes hold
+        auto now = events.get_now() + ppu::FRAME_CYCLES;
+        events.set_now(now);
+        events.run_due();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto frame = 0; frame < frame_count; ++frame) {
+            now += ppu::FRAME_CYCLES;
+            events.set_now(now);
+            events.run_due();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench PPU Frames (" << (rendering ? "rendered" : "skipped") << "): " << rate << " frames/s ("
+            << video.get_frames() << " VBlanks)" << std::endl;
+
+        return rate;
+    }
+
+    double ppu_bench::test_framebuffer(framebuffer::format type, int frame_count)
+    {
+        ppu video{_memory};
+        _memory.set_byte(ppu::LCD_CONTROL, 0xF3);
+        _memory.set_byte(ppu::WINDOW_Y, 72);
+        _memory.set_byte(ppu::WINDOW_X, 87);
+        const auto size = ppu::WIDTH * ppu::HEIGHT * framebuffer::get_pixel_size(type) / sizeof(std::uint32_t);
+        std::vector<std::uint32_t> first(size), second(size);
+        framebuffer output{type, first.data(), second.data()};
+        video.set_framebuffer(&output);
+        auto& events = _memory.get_scheduler();
+        auto now = events.get_now();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto frame = 0; frame < frame_count; ++frame) {
+            now += ppu::FRAME_CYCLES;
+            events.set_now(now);
+            events.run_due();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench PPU Framebuffer (" << (type == framebuffer::format::rgba8888 ? "RGBA8888" : "RGB565") << "): "
+            << rate << " frames/s (" << output.get_frames() << " swapped)" << std::endl;
+
+        return rate;
+    }
+
+    double ppu_bench::test_export(int frame_count)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        ppu video{_memory};
+        _memory.set_byte(ppu::LCD_CONTROL, 0xF3);
+        _memory.set_byte(ppu::WINDOW_Y, 72);
+        _memory.set_byte(ppu::WINDOW_X, 87);
+        shared_export exported{"/gameboy-bench-export-" + std::to_string(getpid()), {{0xC000, 0x2000}, {0xFF80, 0x7F}}};
+        const registers state;
+        auto& events = _memory.get_scheduler();
+        auto now = events.get_now();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto frame = 0; frame < frame_count; ++frame) {
+            now += ppu::FRAME_CYCLES;
+            events.set_now(now);
+            events.run_due();
+            exported.publish(state, _memory, video.get_frame());
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench PPU Export: " << rate << " frames/s" << std::endl;
+
+        return rate;
+#else
+        std::cout << "Bench PPU Export: not supported here" << std::endl;
+        return 0;
+#endif
+    }
+
+    double ppu_bench::test_recording(const std::string& path, int frame_count)
+    {
+        ppu video{_memory};
+        _memory.set_byte(ppu::LCD_CONTROL, 0xF3);
+        _memory.set_byte(ppu::WINDOW_Y, 72);
+        _memory.set_byte(ppu::WINDOW_X, 87);
+        // every frame written, so that the rate is the disk's as well
+        y4m_sink sink{path, stream_writer::overflow::wait};
+        auto& events = _memory.get_scheduler();
+        auto now = events.get_now();
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto frame = 0; frame < frame_count; ++frame) {
+            now += ppu::FRAME_CYCLES;
+            events.set_now(now);
+            events.run_due();
+            sink.write_frame(video.get_frame());
+        }
+        sink.get_writer().flush();
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench PPU Recording: " << rate << " frames/s (" << sink.get_writer().get_written() / 1048576
+            << " MiB)" << std::endl;
+
+        return rate;
+    }
+
+    double ppu_bench::test_program(bool threading, int frame_count)
+    {
+        // the same VRAM and OAM, with INC A; JR -3 at 0, which is never idle
+        memory mem{_memory};
+        const std::vector<byte> program{0x3C, 0x18, 0xFD};
+        for (std::size_t address = 0; address < program.size(); ++address) {
+            mem.set_byte(static_cast<int>(address), program[address]);
+        }
+        ppu video{mem};
+        mem.set_byte(ppu::LCD_CONTROL, 0xF3);
+        mem.set_byte(ppu::WINDOW_Y, 72);
+        mem.set_byte(ppu::WINDOW_X, 87);
+        video.enable_threading(threading);
+        cpu processor{mem};
+        processor.enable_block_cache(true);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (auto frame = 0; frame < frame_count; ++frame) {
+            processor.run_frame();
+            video.get_frame();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const std::chrono::duration<double> elapsed = end - start;
+        const auto rate = frame_count / elapsed.count();
+        std::cout << "Bench PPU Program (threading " << (threading ? "on" : "off") << "): " << rate << " frames/s"
+            << std::endl;
+
+        return rate;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef PPU_BENCH_H
+#define PPU_BENCH_H
+
+#include <string>
+#include "framebuffer.h"
+#include "memory.h"
+#include "tile-decoder.h"
+
+namespace gameboy {
+    class ppu_bench {
+    public:
+        // VRAM full of random tiles and maps, with ten sprites on every line
+        ppu_bench();
+        // the 21 tile rows of a background line, decoded and nothing else
+        double test_decode(tile_decoder::kernel type, int line_count) const;
+        // an OAM scan and a composite of background and sprites for each line
+        double test_composite(tile_decoder::kernel type, int line_count) const;
+        // whole lines drawn with background, window and sprites
+        double test_render(tile_decoder::kernel type, int line_count);
+        // whole frames run through the scheduler, LY, STAT and interrupts included, drawn or not
+        double test_frames(bool rendering, int frame_count);
+        // test_frames() drawing host pixels into a framebuffer as well
+        double test_framebuffer(framebuffer::format type, int frame_count);
+        // test_frames() publishing each frame, the registers and work RAM to a shared memory export as well
+        double test_export(int frame_count);
+        // test_frames() recording each frame as Y4M to path, through the writer thread
+        double test_recording(const std::string& path, int frame_count);
+        // a busy CPU along with the PPU drawing every frame, on the same thread or another one
+        double test_program(bool threading, int frame_count);
+    private:
+        memory _memory;
+    };
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "cpu.h"
+#include "opcode-profile.h"
+
+// gameboy-ngrams <rom> [instructions] [length] [count]
+int main(int argc, char* argv[])
+{
+    using namespace gameboy;
+
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <rom> [instructions] [length] [count]" << std::endl;
+        return 1;
+    }
+
+    const auto instructions = argc > 2 ? std::stol(argv[2]) : 10000000l;
+    const auto longest = argc > 3 ? std::stoul(argv[3]) : 3ul;
+    const auto count = argc > 4 ? std::stoul(argv[4]) : 20ul;
+    if (longest < 2 || longest > opcode_profile::MAX_LENGTH) {
+        std::cerr << "length must be between 2 and " << opcode_profile::MAX_LENGTH << std::endl;
+        return 1;
+    }
+
+    memory rom;
+    try {
+        rom.insert(cartridge::load(argv[1]));
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    cpu processor{rom};
+    opcode_profile profile;
+    try {
+        for (auto executed = 0l; executed < instructions;) {
+            // read before it runs, and only counted if it does rather than giving way to an interrupt
+            const auto address = processor.get_registers().program_counter;
+            const auto instruction = opcode_profile::read_instruction(rom, address);
+            if (processor.fetch_and_execute()) {
+                profile.record(instruction, address);
+                ++executed;
+            }
+        }
+    }
+    catch (const std::exception& error) {
+        // whatever ran up to an instruction the interpreter does not know is still worth looking at
+        std::cerr << error.what() << std::endl;
+    }
+
+    for (auto length = 2ul; length <= longest; ++length) {
+        std::cout << "Length " << length << ":" << std::endl;
+        for (const auto& entry : profile.get_top(length, count)) {
+            std::cout << "   ";
+            for (const auto instruction : entry.first) {
+                std::cout << (instruction > 0xFF ? " CB " : " ") << std::hex << std::uppercase << std::setw(2)
+                    << std::setfill('0') << (instruction & 0xFF) << std::dec;
+            }
+            std::cout << "  " << entry.second << std::endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "recompiler.h"
+
+// gameboy-recompile <rom> <output.cpp> [name] [entry...]
+int main(int argc, char* argv[])
+{
+    using namespace gameboy;
+
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <rom> <output.cpp> [name] [entry...]" << std::endl;
+        return 1;
+    }
+
+    memory rom;
+    try {
+        rom.insert(cartridge::load(argv[1]));
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    recompiler translator{rom};
+    // further entry points in hex, for code only reached through jump tables
+    for (auto index = 4; index < argc; ++index) {
+        translator.add_entry(static_cast<unsigned short>(std::stoul(argv[index], nullptr, 16)));
+    }
+    translator.walk();
+
+    std::ofstream output{argv[2]};
+    translator.write(output, argc > 3 ? argv[3] : "recompiled_rom");
+    if (!output) {
+        std::cerr << "cannot write " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::cout << "Recompiled " << translator.get_blocks().size() << " blocks from " << argv[1] << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "cpu.h"
+#include "recompiler.h"
+
+namespace gameboy {
+    // defined by the translation unit gameboy-recompile generated for this executable
+    extern const recompiled_block recompiled_rom[];
+    extern const std::size_t recompiled_rom_count;
+    extern const unsigned int recompiled_rom_checksum;
+}
+
+// runs the ROM it was built for: <executable> [rom] [frames]
+int main(int argc, char* argv[])
+{
+    using namespace gameboy;
+
+    const std::string path = argc > 1 ? argv[1] : GAMEBOY_RECOMPILED_ROM;
+    const auto frames = argc > 2 ? std::stoi(argv[2]) : 600;
+
+    memory rom;
+    try {
+        rom.insert(cartridge::load(path));
+    }
+    catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+
+    if (recompiler::checksum(rom) != recompiled_rom_checksum) {
+        std::cerr << path << " is not the ROM this executable was recompiled from" << std::endl;
+        return 1;
+    }
+
+    cpu processor{rom};
+    processor.load_recompiled(recompiled_rom, recompiled_rom_count);
+    // whatever was not translated goes through the block cache
+    processor.enable_block_cache(true);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (auto frame = 0; frame < frames; ++frame) {
+        processor.run_frame();
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << frames / elapsed.count() << " frames/s (" << recompiled_rom_count << " blocks recompiled, "
+        << processor.get_recompiled_runs() << " runs)" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "alu-table.h"
+
+namespace gameboy {
+    namespace {
+        template<typename Operation>
+        std::array<alu::output<byte>, 2 * 256 * 256> make_arithmetic_table(Operation operation)
+        {
+            std::array<alu::output<byte>, 2 * 256 * 256> table;
+            for (auto carry = 0; carry < 2; ++carry) {
+                for (auto operand1 = 0; operand1 < 256; ++operand1) {
+                    for (auto operand2 = 0; operand2 < 256; ++operand2) {
+                        table[carry << 16 | operand1 << 8 | operand2] = operation(static_cast<byte>(operand1),
+                            static_cast<byte>(operand2), carry != 0);
+                    }
+                }
+            }
+
+            return table;
+        }
+
+        std::array<alu::output<byte>, 8 * 256> make_adjustment_table()
+        {
+            const alu arithmetic;
+            std::array<alu::output<byte>, 8 * 256> table;
+            for (auto status = 0; status < 8; ++status) {
+                for (auto number = 0; number < 256; ++number) {
+                    const flags flag{static_cast<byte>(status << 4)};
+                    table[status << 8 | number] = arithmetic.daa(static_cast<byte>(number), flag);
+                }
+            }
+
+            return table;
+        }
+    }
+
+    const std::array<alu::output<byte>, 2 * 256 * 256> alu_table::_addition =
+        make_arithmetic_table([](byte operand1, byte operand2, bool carry) {
+            return alu{}.add(operand1, operand2, carry);
+        });
+
+    const std::array<alu::output<byte>, 2 * 256 * 256> alu_table::_subtraction =
+        make_arithmetic_table([](byte operand1, byte operand2, bool carry) {
+            return alu{}.subtract(operand1, operand2, carry);
+        });
+
+    const std::array<alu::output<byte>, 8 * 256> alu_table::_adjustment = make_adjustment_table();
+}
@@ -0,0 +1,46 @@
+#ifndef ALU_TABLE_H
+#define ALU_TABLE_H
+
+#include <array>
+#include "alu.h"
+#include "byte.h"
+#include "flags.h"
+
+namespace gameboy {
+    // Same interface as alu, but the 8-bit ADD/ADC/SUB/SBC/CP and DAA paths read their result and flags
+    // from tables built once at startup instead of computing the masks on every call.
+    class alu_table : public alu {
+    public:
+        using alu::add;
+        using alu::subtract;
+
+        output<byte> add(byte operand1, byte operand2, bool carry = false) const
+        {
+            return _addition[index(operand1, operand2, carry)];
+        }
+
+        output<byte> subtract(byte operand1, byte operand2, bool carry = false) const
+        {
+            return _subtraction[index(operand1, operand2, carry)];
+        }
+
+        output<byte> daa(byte number, const flags& flag) const
+        {
+            return _adjustment[(flag & ADJUSTMENT_FLAGS) << 4 | number];
+        }
+    private:
+        // N, H and C are the only flags DAA looks at
+        static constexpr auto ADJUSTMENT_FLAGS = 0x70;
+
+        static int index(byte operand1, byte operand2, bool carry)
+        {
+            return carry << 16 | operand1 << 8 | operand2;
+        }
+
+        static const std::array<output<byte>, 2 * 256 * 256> _addition;
+        static const std::array<output<byte>, 2 * 256 * 256> _subtraction;
+        static const std::array<output<byte>, 8 * 256> _adjustment;
+    };
+}
+
+#endif
@@ -1,6 +1,78 @@
 #include "alu.h"
 
 namespace gameboy {
+    alu::output<byte> alu::rotate_left_through_carry(byte operand, bool carry) const
+    {
+        integer_result<byte> result{operand << 1 | carry};
+        output<byte> output{result.value};
+        output.status[flag_type::zero] = false;
+        output.status[flag_type::subtract] = false;
+        output.status[flag_type::half_carry] = false;
+        output.status[flag_type::carry] = (operand & 0x80) != 0;
+
+        return output;
+    }
+
+    alu::output<byte> alu::rotate_right_through_carry(byte operand, bool carry) const
+    {
+        integer_result<byte> result{operand >> 1 | carry << 7};
+        output<byte> output{result.value};
+        output.status[flag_type::zero] = false;
+        output.status[flag_type::subtract] = false;
+        output.status[flag_type::half_carry] = false;
+        output.status[flag_type::carry] = (operand & 0x01) != 0;
+
+        return output;
+    }
+
+    alu::output<byte> alu::shift_left_arithmetic(byte operand) const
+    {
+        integer_result<byte> result{operand << 1};
+        output<byte> output{result.value};
+        output.status[flag_type::zero] = result.value == 0;
+        output.status[flag_type::subtract] = false;
+        output.status[flag_type::half_carry] = false;
+        output.status[flag_type::carry] = (operand & 0x80) != 0;
+
+        return output;
+    }
+
+    alu::output<byte> alu::shift_right_arithmetic(byte operand) const
+    {
+        integer_result<byte> result{operand >> 1 | (operand & 0x80)};
+        output<byte> output{result.value};
+        output.status[flag_type::zero] = result.value == 0;
+        output.status[flag_type::subtract] = false;
+        output.status[flag_type::half_carry] = false;
+        output.status[flag_type::carry] = (operand & 0x01) != 0;
+
+        return output;
+    }
+
+    alu::output<byte> alu::shift_right_logical(byte operand) const
+    {
+        integer_result<byte> result{operand >> 1};
+        output<byte> output{result.value};
+        output.status[flag_type::zero] = result.value == 0;
+        output.status[flag_type::subtract] = false;
+        output.status[flag_type::half_carry] = false;
+        output.status[flag_type::carry] = (operand & 0x01) != 0;
+
+        return output;
+    }
+
+    alu::output<byte> alu::swap(byte operand) const
+    {
+        integer_result<byte> result{operand << 4 | operand >> 4};
+        output<byte> output{result.value};
+        output.status[flag_type::zero] = result.value == 0;
+        output.status[flag_type::subtract] = false;
+        output.status[flag_type::half_carry] = false;
+        output.status[flag_type::carry] = false;
+
+        return output;
+    }
+
     alu::output<byte> alu::and_byte(byte operand1, byte operand2) const
     {
         integer_result<byte> result{operand1 & operand2};
@@ -28,7 +28,7 @@ namespace gameboy {
         {
             constexpr auto half_mask = (1 << (sizeof(T) * 8 - 4)) - 1;
             constexpr auto full_mask = (1 << (sizeof(T) * 8)) - 1;
-            integer_result<T> result{operand1 + operand2};
+            integer_result<T> result{operand1 + operand2 + carry};
             output<T> output{result.value};
             output.status[flag_type::zero] = result.value == 0;
             output.status[flag_type::subtract] = false;
@@ -43,7 +43,7 @@ namespace gameboy {
         {
             constexpr auto half_mask = (1 << (sizeof(T) * 8 - 4)) - 1;
             constexpr auto full_mask = (1 << (sizeof(T) * 8)) - 1;
-            integer_result<T> result{operand1 - operand2};
+            integer_result<T> result{operand1 - operand2 - carry};
             output<T> output{result.value};
             output.status[flag_type::zero] = result.value == 0;
             output.status[flag_type::subtract] = true;
@@ -67,6 +67,29 @@ namespace gameboy {
             return output;
         }
 
+        template<typename T>
+        output<T> rotate_right(T operand1, T operand2) const
+        {
+            integer_result<T> result{operand1 >> operand2 | operand1 << (sizeof(T) * 8 - operand2)};
+            output<T> output{result.value};
+            output.status[flag_type::zero] = false;
+            output.status[flag_type::subtract] = false;
+            output.status[flag_type::half_carry] = false;
+            output.status[flag_type::carry] = (operand1 & 1) != 0;
+
+            return output;
+        }
+
+        // 9-bit rotations where the carry flag is shifted in and the bit shifted out becomes the new carry
+        output<byte> rotate_left_through_carry(byte operand, bool carry) const;
+        output<byte> rotate_right_through_carry(byte operand, bool carry) const;
+
+        // CB page shifts; unlike the rotations above these set Z from the result
+        output<byte> shift_left_arithmetic(byte operand) const;
+        output<byte> shift_right_arithmetic(byte operand) const;
+        output<byte> shift_right_logical(byte operand) const;
+        output<byte> swap(byte operand) const;
+
         output<byte> and_byte(byte operand1, byte operand2) const;
         output<byte> xor_byte(byte operand1, byte operand2) const;
         output<byte> or_byte(byte operand1, byte operand2) const;
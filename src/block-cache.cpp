@@ -0,0 +1,97 @@
+#include "block-cache.h"
+
+namespace gameboy {
+    block_cache::block_cache(memory& mem) : _memory(mem), _hits(0), _misses(0), _invalidations(0)
+    {
+    }
+
+    // a copy starts out empty, it only shares the memory
+    block_cache::block_cache(const block_cache& other) : _memory(other._memory), _hits(0), _misses(0), _invalidations(0)
+    {
+    }
+
+    block* block_cache::find(unsigned short address)
+    {
+        const auto& banks = _pages[address / memory::PAGE_SIZE];
+        const auto bank = static_cast<std::size_t>(_memory.get_page_bank(address / memory::PAGE_SIZE));
+        if (bank >= banks.size() || !banks[bank] || (*banks[bank])[address % memory::PAGE_SIZE].instructions.empty()) {
+            ++_misses;
+            return nullptr;
+        }
+
+        auto& cached = (*banks[bank])[address % memory::PAGE_SIZE];
+        if (_memory.get_page_version(cached.first_page) != cached.first_version
+            || _memory.get_page_version(cached.last_page) != cached.last_version
+            || _memory.get_page_bank(cached.last_page) != cached.last_bank) {
+            ++_invalidations;
+            ++_misses;
+            return nullptr;
+        }
+
+        ++_hits;
+        return &cached;
+    }
+
+    block& block_cache::allocate(unsigned short address)
+    {
+        auto& banks = _pages[address / memory::PAGE_SIZE];
+        const auto bank = static_cast<std::size_t>(_memory.get_page_bank(address / memory::PAGE_SIZE));
+        if (bank >= banks.size()) {
+            banks.resize(bank + 1);
+        }
+        if (!banks[bank]) {
+            banks[bank].reset(new page{});
+        }
+
+        auto& target = (*banks[bank])[address % memory::PAGE_SIZE];
+        target.address = address;
+        target.instructions.clear();
+        target.cycles = 0;
+        target.executions = 0;
+        target.native = nullptr;
+        target.native_generation = 0;
+        return target;
+    }
+
+    void block_cache::seal(block& target)
+    {
+        _memory.mark_code(target.first_page);
+        _memory.mark_code(target.last_page);
+        // a block stops in the page after its first one, so past its ends it only touches the registers by running
+        // onto or off the I/O page
+        const auto end = (target.instructions.back().next - 1) & 0xFFFF;
+        const auto is_register = [](int address) {
+            return address / memory::PAGE_SIZE == memory::IO_PAGE
+                && (address < memory::HIGH_RAM || address == memory::INTERRUPT_ENABLE);
+        };
+        if (is_register(target.address) || is_register(end)
+            || (target.first_page == memory::IO_PAGE) != (target.last_page == memory::IO_PAGE)) {
+            _memory.mark_register_code();
+        }
+        target.first_version = _memory.get_page_version(target.first_page);
+        target.last_version = _memory.get_page_version(target.last_page);
+        target.last_bank = _memory.get_page_bank(target.last_page);
+    }
+
+    void block_cache::clear()
+    {
+        for (auto& banks : _pages) {
+            banks.clear();
+        }
+    }
+
+    unsigned long long block_cache::get_hits() const
+    {
+        return _hits;
+    }
+
+    unsigned long long block_cache::get_misses() const
+    {
+        return _misses;
+    }
+
+    unsigned long long block_cache::get_invalidations() const
+    {
+        return _invalidations;
+    }
+}
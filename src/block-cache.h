@@ -0,0 +1,84 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "memory.h"
+
+namespace gameboy {
+    class cpu;
+    struct jit_state;
+
+    // one instruction with its handler resolved and its immediate operand already read
+    struct decoded_instruction {
+        int (*handler)(cpu&);
+        // for 0xCB the prefixed opcode is the low byte of the operand
+        byte opcode;
+        // instructions folded in after the first one, which then runs them all
+        byte fused;
+        // a fused sequence packs the operands of all its instructions here, a byte at a time
+        unsigned int operand;
+        // address of the following instruction, which is what PC holds while the handler runs
+        unsigned short next;
+        // cycles from the start of the block up to and including this instruction
+        int elapsed;
+    };
+
+    // straight-line run of instructions, ending at the first one that can leave it
+    struct block {
+        unsigned short address;
+        std::vector<decoded_instruction> instructions;
+        // cycles of every instruction but the last, which is the only one allowed to branch
+        int cycles;
+        // the block may run into the following page; both are checked for writes, and the following one for
+        // a bank switch
+        int first_page;
+        int last_page;
+        int last_bank;
+        unsigned int first_version;
+        unsigned int last_version;
+        // jumps back to its own start with nothing on the way writing memory, so it may be waiting on an event
+        bool idle;
+        // runs so far, used by the JIT to tell hot blocks apart
+        unsigned int executions;
+        // translation of a prefix of the block, only valid while native_generation matches the JIT's
+        int (*native)(jit_state*, cpu*);
+        unsigned int native_generation;
+        // translations of the code at this address, the ones of them made after it was rewritten, and the page
+        // versions the last one was made from; unlike the rest, these are kept when the block is decoded again
+        unsigned int translations;
+        unsigned int retranslations;
+        unsigned int translated_first_version;
+        unsigned int translated_last_version;
+    };
+
+    // decoded blocks keyed by start address and the bank mapped there, dropped when memory reports a write into
+    // their pages
+    class block_cache {
+    public:
+        block_cache(memory& mem);
+        block_cache(const block_cache& other);
+        // the block starting at address, or nullptr when it was never decoded or its code changed since
+        block* find(unsigned short address);
+        // empty block for the decoder to fill, followed by a call to seal()
+        block& allocate(unsigned short address);
+        void seal(block& target);
+        void clear();
+
+        unsigned long long get_hits() const;
+        unsigned long long get_misses() const;
+        unsigned long long get_invalidations() const;
+    private:
+        using page = std::array<block, memory::PAGE_SIZE>;
+
+        // allocated a page at a time, the first time code in it is decoded, for each bank it shows
+        std::array<std::vector<std::unique_ptr<page>>, memory::PAGE_COUNT> _pages;
+        memory& _memory;
+        unsigned long long _hits;
+        unsigned long long _misses;
+        unsigned long long _invalidations;
+    };
+}
+
+#endif
@@ -3,7 +3,6 @@
 namespace gameboy {
     int make_address(byte high, byte low)
     {
-        // little-endian implementation
-        return (low << 8) | high;
+        return (high << 8) | low;
     }
 }
\ No newline at end of file
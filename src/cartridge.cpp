@@ -0,0 +1,195 @@
+#include "cartridge.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#if defined(__unix__) || defined(__APPLE__)
+#define GAMEBOY_MAPPED_ROMS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gameboy {
+    namespace {
+        constexpr auto TITLE = 0x0134;
+        constexpr auto CARTRIDGE_TYPE = 0x0147;
+        constexpr auto ROM_SIZE = 0x0148;
+        constexpr auto RAM_SIZE = 0x0149;
+        constexpr auto HEADER_CHECKSUM = 0x014D;
+        constexpr auto GLOBAL_CHECKSUM = 0x014E;
+        constexpr auto HEADER_END = 0x0150;
+    }
+
+    cartridge::cartridge(std::vector<byte> rom) : _owned(std::move(rom)), _rom(nullptr), _size(0), _mapped(false),
+        _controller(controller::none), _ram_size(0), _valid_global_checksum(false)
+    {
+        if (_owned.size() < HEADER_END) {
+            throw std::runtime_error("ROM too short to hold a header");
+        }
+
+        // a whole number of banks, and never less than what 0x0000-0x7FFF shows
+        const auto banks = std::max<std::size_t>((_owned.size() + ROM_BANK_SIZE - 1) / ROM_BANK_SIZE, 2);
+        const auto size = _owned.size();
+        _owned.resize(banks * ROM_BANK_SIZE, 0xFF);
+        _rom = _owned.data();
+        _size = size;
+        validate();
+        _size = _owned.size();
+    }
+
+    cartridge::cartridge(const byte* mapping, std::size_t size) : _rom(mapping), _size(size), _mapped(true),
+        _controller(controller::none), _ram_size(0), _valid_global_checksum(false)
+    {
+        validate();
+    }
+
+    cartridge::~cartridge()
+    {
+#ifdef GAMEBOY_MAPPED_ROMS
+        if (_mapped) {
+            munmap(const_cast<byte*>(_rom), _size);
+        }
+#endif
+    }
+
+    std::shared_ptr<const cartridge> cartridge::load(const std::string& path)
+    {
+#ifdef GAMEBOY_MAPPED_ROMS
+        const auto descriptor = open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw std::runtime_error("cannot open " + path);
+        }
+
+        // anything else needs padding, which takes a copy
+        struct stat status;
+        const auto size = fstat(descriptor, &status) == 0 ? static_cast<std::size_t>(status.st_size) : 0;
+        if (size >= 2 * ROM_BANK_SIZE && size % ROM_BANK_SIZE == 0) {
+            const auto mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            close(descriptor);
+            if (mapping != MAP_FAILED) {
+                try {
+                    return std::shared_ptr<const cartridge>(new cartridge(static_cast<const byte*>(mapping), size));
+                }
+                catch (...) {
+                    munmap(mapping, size);
+                    throw;
+                }
+            }
+        }
+        else {
+            close(descriptor);
+        }
+#endif
+
+        std::ifstream input{path, std::ios::binary};
+        if (!input) {
+            throw std::runtime_error("cannot open " + path);
+        }
+
+        std::vector<byte> rom{std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{}};
+        return std::make_shared<const cartridge>(std::move(rom));
+    }
+
+    byte cartridge::compute_header_checksum(const byte* rom)
+    {
+        auto checksum = 0;
+        for (auto address = TITLE; address < HEADER_CHECKSUM; ++address) {
+            checksum = checksum - rom[address] - 1;
+        }
+
+        return static_cast<byte>(checksum);
+    }
+
+    void cartridge::validate()
+    {
+        if (compute_header_checksum(_rom) != _rom[HEADER_CHECKSUM]) {
+            throw std::runtime_error("ROM header checksum mismatch");
+        }
+
+        // sizes past 8 MiB are not ones any controller here can reach
+        const auto size_code = _rom[ROM_SIZE];
+        if (size_code <= 8 && _size < static_cast<std::size_t>(2 * ROM_BANK_SIZE) << size_code) {
+            throw std::runtime_error("ROM shorter than its header says");
+        }
+
+        const auto type = _rom[CARTRIDGE_TYPE];
+        switch (type) {
+        case 0x00:
+        case 0x08:
+        case 0x09:
+            _controller = controller::none;
+            break;
+        case 0x01:
+        case 0x02:
+        case 0x03:
+            _controller = controller::mbc1;
+            break;
+        case 0x0F:
+        case 0x10:
+        case 0x11:
+        case 0x12:
+        case 0x13:
+            _controller = controller::mbc3;
+            break;
+        case 0x19:
+        case 0x1A:
+        case 0x1B:
+        case 0x1C:
+        case 0x1D:
+        case 0x1E:
+            _controller = controller::mbc5;
+            break;
+        default: {
+            std::ostringstream message;
+            message << "unsupported cartridge type 0x" << std::hex << static_cast<int>(type);
+            throw std::runtime_error(message.str());
+        }
+        }
+
+        static const std::size_t ram_sizes[] = {0, 0x800, 0x2000, 0x8000, 0x20000, 0x10000};
+        const auto ram_code = _rom[RAM_SIZE];
+        _ram_size = ram_code < sizeof ram_sizes / sizeof ram_sizes[0] ? ram_sizes[ram_code] : 0;
+
+        auto sum = 0u;
+        for (std::size_t address = 0; address < _size; ++address) {
+            sum += _rom[address];
+        }
+        sum -= _rom[GLOBAL_CHECKSUM] + _rom[GLOBAL_CHECKSUM + 1];
+        const auto expected = static_cast<unsigned>(_rom[GLOBAL_CHECKSUM] << 8 | _rom[GLOBAL_CHECKSUM + 1]);
+        _valid_global_checksum = (sum & 0xFFFF) == expected;
+    }
+
+    cartridge::controller cartridge::get_controller() const
+    {
+        return _controller;
+    }
+
+    int cartridge::get_rom_banks() const
+    {
+        return static_cast<int>(_size / ROM_BANK_SIZE);
+    }
+
+    std::size_t cartridge::get_ram_size() const
+    {
+        return _ram_size;
+    }
+
+    const byte* cartridge::get_rom_bank(int bank) const
+    {
+        return _rom + static_cast<std::size_t>(bank % get_rom_banks()) * ROM_BANK_SIZE;
+    }
+
+    bool cartridge::has_valid_global_checksum() const
+    {
+        return _valid_global_checksum;
+    }
+
+    bool cartridge::is_mapped() const
+    {
+        return _mapped;
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef CARTRIDGE_H
+#define CARTRIDGE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "byte.h"
+
+namespace gameboy {
+    // A ROM image and what its header says about the hardware around it; memory maps it in. Nothing writes to it,
+    // so one image is shared between every memory it is inserted into.
+    class cartridge {
+    public:
+        static constexpr auto ROM_BANK_SIZE = 0x4000;
+        static constexpr auto RAM_BANK_SIZE = 0x2000;
+
+        enum class controller {
+            none,
+            mbc1,
+            mbc3,
+            mbc5
+        };
+
+        // throws std::runtime_error when the header checksum is wrong, the ROM is shorter than its header says or
+        // the controller is not one of the above
+        explicit cartridge(std::vector<byte> rom);
+        // maps the file read-only instead of reading it in whenever it holds whole banks; throws like the
+        // constructor, or when the file cannot be read
+        static std::shared_ptr<const cartridge> load(const std::string& path);
+        cartridge(const cartridge&) = delete;
+        cartridge& operator=(const cartridge&) = delete;
+        ~cartridge();
+
+        // what the boot ROM compares against 0x014D before it runs anything, computed over 0x0134-0x014C
+        static byte compute_header_checksum(const byte* rom);
+
+        controller get_controller() const;
+        // padded out to at least two banks
+        int get_rom_banks() const;
+        // external RAM in bytes, 0 when there is none
+        std::size_t get_ram_size() const;
+        // banks past the end wrap around, like the unconnected address lines they are selected with
+        const byte* get_rom_bank(int bank) const;
+        // the checksum over the whole ROM at 0x014E, which nothing on the hardware checks
+        bool has_valid_global_checksum() const;
+        // whether the image is the file itself, mapped into memory, rather than a copy
+        bool is_mapped() const;
+    private:
+        // takes over a read-only mapping of size bytes, unmapped on destruction once the header checked out
+        cartridge(const byte* mapping, std::size_t size);
+        void validate();
+
+        std::vector<byte> _owned;
+        const byte* _rom;
+        std::size_t _size;
+        bool _mapped;
+        controller _controller;
+        std::size_t _ram_size;
+        bool _valid_global_checksum;
+    };
+}
+
+#endif
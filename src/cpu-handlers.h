@@ -0,0 +1,1011 @@
+#ifndef CPU_HANDLERS_H
+#define CPU_HANDLERS_H
+
+#include <algorithm>
+#include <initializer_list>
+#include <sstream>
+#include <stdexcept>
+#include "cpu.h"
+
+// decoding and the instruction handler templates, shared by cpu.cpp and the translation units gameboy-recompile
+// generates, so that both can instantiate and inline the same handlers
+namespace gameboy {
+    // opcode fields: xx yyy zzz, with yyy split into pp q where it names a register pair
+    constexpr cpu::operation cpu::decode(int opcode)
+    {
+        const auto x = opcode >> 6, y = opcode >> 3 & 7, z = opcode & 7, q = y & 1;
+
+        switch (x) {
+        case 0:
+            switch (z) {
+            case 0:
+                return y == 0 ? operation::no_operation
+                    : y == 1 ? operation::store_stack_pointer
+                    : y == 2 ? operation::halt // STOP
+                    : operation::jump_relative;
+            case 1:
+                return q == 0 ? operation::load_pair_immediate : operation::add_pair;
+            case 2:
+                return q == 0 ? operation::store_indirect : operation::load_indirect;
+            case 3:
+                return q == 0 ? operation::increment_pair : operation::decrement_pair;
+            case 4:
+                return operation::increment;
+            case 5:
+                return operation::decrement;
+            case 6:
+                return operation::load_immediate;
+            default:
+                return y < 4 ? operation::rotate_accumulator
+                    : y == 4 ? operation::decimal_adjust
+                    : y == 5 ? operation::complement
+                    : y == 6 ? operation::set_carry
+                    : operation::complement_carry;
+            }
+        case 1:
+            return opcode == 0x76 ? operation::halt : operation::load;
+        case 2:
+            return operation::arithmetic;
+        default:
+            switch (z) {
+            case 0:
+                return y < 4 ? operation::return_from_call
+                    : y == 4 ? operation::store_high
+                    : y == 5 ? operation::add_stack_offset
+                    : y == 6 ? operation::load_high
+                    : operation::load_stack_offset;
+            case 1:
+                return q == 0 ? operation::pop
+                    : y == 1 ? operation::return_from_call
+                    : y == 3 ? operation::return_from_interrupt
+                    : y == 5 ? operation::jump_hl
+                    : operation::load_stack_pointer;
+            case 2:
+                return y < 4 ? operation::jump
+                    : y == 4 ? operation::store_high
+                    : y == 5 ? operation::store_absolute
+                    : y == 6 ? operation::load_high
+                    : operation::load_absolute;
+            case 3:
+                return y == 0 ? operation::jump
+                    : y == 1 ? operation::prefix
+                    : y < 6 ? operation::invalid
+                    : operation::interrupt_enable;
+            case 4:
+                return y < 4 ? operation::call : operation::invalid;
+            case 5:
+                return q == 0 ? operation::push
+                    : y == 1 ? operation::call
+                    : operation::invalid;
+            case 6:
+                return operation::arithmetic_immediate;
+            default:
+                return operation::restart;
+            }
+        }
+    }
+
+    // xx selects the family, yyy the operation or bit index and zzz the operand
+    constexpr cpu::operation cpu::decode_prefixed(int opcode)
+    {
+        return opcode < 0x40 ? operation::rotate_shift
+            : opcode < 0x80 ? operation::test_bit
+            : opcode < 0xC0 ? operation::reset_bit
+            : operation::set_bit;
+    }
+
+    constexpr int cpu::length(int opcode)
+    {
+        switch (decode(opcode)) {
+        case operation::load_pair_immediate:
+        case operation::store_stack_pointer:
+        case operation::load_absolute:
+        case operation::store_absolute:
+        case operation::jump:
+        case operation::call:
+            return 3;
+        case operation::load_high:
+        case operation::store_high:
+            return (opcode & 7) == 0 ? 2 : 1;
+        case operation::load_immediate:
+        case operation::load_stack_offset:
+        case operation::add_stack_offset:
+        case operation::arithmetic_immediate:
+        case operation::jump_relative:
+        case operation::prefix:
+            return 2;
+        case operation::halt:
+            // STOP is followed by a byte nothing looks at
+            return opcode == 0x10 ? 2 : 1;
+        default:
+            return 1;
+        }
+    }
+
+    // has to agree with what the handlers return; cpu_test::test_durations checks every opcode
+    constexpr int cpu::duration(int opcode)
+    {
+        const auto source = (opcode & 7) == INDIRECT, destination = (opcode >> 3 & 7) == INDIRECT;
+
+        switch (decode(opcode)) {
+        case operation::no_operation:
+        case operation::rotate_accumulator:
+        case operation::decimal_adjust:
+        case operation::complement:
+        case operation::set_carry:
+        case operation::complement_carry:
+        case operation::jump_hl:
+        case operation::interrupt_enable:
+        case operation::halt:
+            return 4;
+        case operation::load:
+            return source || destination ? 8 : 4;
+        case operation::arithmetic:
+            return source ? 8 : 4;
+        case operation::increment:
+        case operation::decrement:
+            return destination ? 12 : 4;
+        case operation::load_immediate:
+            return destination ? 12 : 8;
+        case operation::load_high:
+        case operation::store_high:
+            return (opcode & 7) == 0 ? 12 : 8;
+        case operation::load_indirect:
+        case operation::store_indirect:
+        case operation::load_stack_pointer:
+        case operation::increment_pair:
+        case operation::decrement_pair:
+        case operation::add_pair:
+        case operation::arithmetic_immediate:
+        case operation::jump_relative:
+            return 8;
+        case operation::return_from_call:
+            return opcode == 0xC9 ? 16 : 8;
+        case operation::load_pair_immediate:
+        case operation::load_stack_offset:
+        case operation::jump:
+        case operation::call:
+        case operation::pop:
+            return 12;
+        case operation::load_absolute:
+        case operation::store_absolute:
+        case operation::add_stack_offset:
+        case operation::return_from_interrupt:
+        case operation::restart:
+        case operation::push:
+            return 16;
+        case operation::store_stack_pointer:
+            return 20;
+        default:
+            return 0;
+        }
+    }
+
+    constexpr int cpu::duration_prefixed(int opcode)
+    {
+        return (opcode & 7) != INDIRECT ? 8 : decode_prefixed(opcode) == operation::test_bit ? 12 : 16;
+    }
+
+    constexpr bool cpu::ends_block(int opcode)
+    {
+        switch (decode(opcode)) {
+        case operation::invalid:
+        case operation::jump:
+        case operation::jump_relative:
+        case operation::jump_hl:
+        case operation::call:
+        case operation::return_from_call:
+        case operation::return_from_interrupt:
+        case operation::restart:
+        case operation::interrupt_enable:
+        case operation::halt:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    constexpr bool cpu::writes(int opcode)
+    {
+        const auto destination = (opcode >> 3 & 7) == INDIRECT;
+
+        switch (decode(opcode)) {
+        case operation::store_indirect:
+        case operation::store_high:
+        case operation::store_absolute:
+        case operation::store_stack_pointer:
+        case operation::call:
+        case operation::restart:
+        case operation::push:
+            return true;
+        case operation::load:
+        case operation::load_immediate:
+        case operation::increment:
+        case operation::decrement:
+            return destination;
+        default:
+            return false;
+        }
+    }
+
+    // the (HL) forms of everything but BIT
+    constexpr bool cpu::writes_prefixed(int opcode)
+    {
+        return (opcode & 7) == INDIRECT && decode_prefixed(opcode) != operation::test_bit;
+    }
+
+    inline byte cpu::fetch_byte()
+    {
+        return _memory.get_byte(_registers.program_counter++);
+    }
+
+    inline unsigned short cpu::fetch_word()
+    {
+        const auto low = fetch_byte();
+        const auto high = fetch_byte();
+        return static_cast<unsigned short>(make_address(high, low));
+    }
+
+    inline byte cpu::immediate_byte() const
+    {
+        return static_cast<byte>(_operand);
+    }
+
+    inline unsigned short cpu::immediate_word() const
+    {
+        return static_cast<unsigned short>(_operand);
+    }
+
+    inline void cpu::push(unsigned short value)
+    {
+        _memory.set_byte(--_registers.stack_pointer, static_cast<byte>(value >> 8));
+        _memory.set_byte(--_registers.stack_pointer, static_cast<byte>(value));
+    }
+
+    inline unsigned short cpu::pop()
+    {
+        const auto low = _memory.get_byte(_registers.stack_pointer++);
+        const auto high = _memory.get_byte(_registers.stack_pointer++);
+        return static_cast<unsigned short>(make_address(high, low));
+    }
+
+    template<int Index>
+    byte& cpu::register8()
+    {
+        switch (Index) {
+        case 0:
+            return _registers.general_bc.bytes.high;
+        case 1:
+            return _registers.general_bc.bytes.low;
+        case 2:
+            return _registers.general_de.bytes.high;
+        case 3:
+            return _registers.general_de.bytes.low;
+        case 4:
+            return _registers.general_hl.bytes.high;
+        case 5:
+            return _registers.general_hl.bytes.low;
+        default:
+            return _registers.accumulator;
+        }
+    }
+
+    template<int Index>
+    byte cpu::read()
+    {
+        return Index == INDIRECT ? _memory.get_byte(_registers.general_hl.value) : register8<Index>();
+    }
+
+    template<int Index>
+    void cpu::write(byte value)
+    {
+        if (Index == INDIRECT) {
+            _memory.set_byte(_registers.general_hl.value, value);
+        }
+        else {
+            register8<Index>() = value;
+        }
+    }
+
+    template<int Pair>
+    unsigned short& cpu::register16()
+    {
+        switch (Pair) {
+        case 0:
+            return _registers.general_bc.value;
+        case 1:
+            return _registers.general_de.value;
+        case 2:
+            return _registers.general_hl.value;
+        default:
+            return _registers.stack_pointer;
+        }
+    }
+
+    // (BC), (DE), (HL+), (HL-)
+    template<int Pair>
+    unsigned short cpu::indirect_address()
+    {
+        switch (Pair) {
+        case 0:
+            return _registers.general_bc.value;
+        case 1:
+            return _registers.general_de.value;
+        case 2:
+            return _registers.general_hl.value++;
+        default:
+            return _registers.general_hl.value--;
+        }
+    }
+
+    template<int Condition>
+    bool cpu::condition() const
+    {
+        switch (Condition) {
+        case 0:
+            return !_registers.flag[flag_type::zero];
+        case 1:
+            return _registers.flag[flag_type::zero];
+        case 2:
+            return !_registers.flag[flag_type::carry];
+        case 3:
+            return _registers.flag[flag_type::carry];
+        default:
+            return true;
+        }
+    }
+
+    inline byte cpu::add_byte(byte operand1, byte operand2, bool carry)
+    {
+#ifdef GAMEBOY_LAZY_FLAGS
+        _registers.flag.record_add(operand1, operand2, carry);
+        return static_cast<byte>(operand1 + operand2 + carry);
+#else
+        const auto output = _alu.add(operand1, operand2, carry);
+        _registers.flag = output.status;
+        return output.result;
+#endif
+    }
+
+    inline byte cpu::subtract_byte(byte operand1, byte operand2, bool carry)
+    {
+#ifdef GAMEBOY_LAZY_FLAGS
+        _registers.flag.record_subtract(operand1, operand2, carry);
+        return static_cast<byte>(operand1 - operand2 - carry);
+#else
+        const auto output = _alu.subtract(operand1, operand2, carry);
+        _registers.flag = output.status;
+        return output.result;
+#endif
+    }
+
+    inline byte cpu::increment_byte(byte operand)
+    {
+#ifdef GAMEBOY_LAZY_FLAGS
+        _registers.flag.record_increment(operand);
+        return static_cast<byte>(operand + 1);
+#else
+        const auto output = _alu.add(operand, byte{1});
+        _registers.flag.assign<true, true, true, false>(output.status);
+        return output.result;
+#endif
+    }
+
+    inline byte cpu::decrement_byte(byte operand)
+    {
+#ifdef GAMEBOY_LAZY_FLAGS
+        _registers.flag.record_decrement(operand);
+        return static_cast<byte>(operand - 1);
+#else
+        const auto output = _alu.subtract(operand, byte{1});
+        _registers.flag.assign<true, true, true, false>(output.status);
+        return output.result;
+#endif
+    }
+
+    template<int Operation>
+    void cpu::accumulate(byte operand)
+    {
+        auto& accumulator = _registers.accumulator;
+
+        switch (Operation) {
+        case 0:
+            accumulator = add_byte(accumulator, operand);
+            break;
+        case 1:
+            accumulator = add_byte(accumulator, operand, _registers.flag[flag_type::carry]);
+            break;
+        case 2:
+            accumulator = subtract_byte(accumulator, operand);
+            break;
+        case 3:
+            accumulator = subtract_byte(accumulator, operand, _registers.flag[flag_type::carry]);
+            break;
+        case 4: {
+            const auto output = _alu.and_byte(accumulator, operand);
+            accumulator = output.result;
+            _registers.flag = output.status;
+            break;
+        }
+        case 5: {
+            const auto output = _alu.xor_byte(accumulator, operand);
+            accumulator = output.result;
+            _registers.flag = output.status;
+            break;
+        }
+        case 6: {
+            const auto output = _alu.or_byte(accumulator, operand);
+            accumulator = output.result;
+            _registers.flag = output.status;
+            break;
+        }
+        default:
+            subtract_byte(accumulator, operand);
+            break;
+        }
+    }
+
+    // SP + e, where H and C come from the unsigned addition of the low byte and Z is always cleared
+    inline flags cpu::offset_stack_pointer(byte offset)
+    {
+        auto status = _alu.add(static_cast<byte>(_registers.stack_pointer), offset).status;
+        status[flag_type::zero] = false;
+        _registers.stack_pointer = static_cast<unsigned short>(_registers.stack_pointer + static_cast<sbyte>(offset));
+        return status;
+    }
+
+    template<int Operation>
+    byte cpu::rotate_shift(byte operand)
+    {
+        const auto carry = _registers.flag[flag_type::carry];
+        auto output = Operation == 0 ? _alu.rotate_left(operand, byte{1})
+            : Operation == 1 ? _alu.rotate_right(operand, byte{1})
+            : Operation == 2 ? _alu.rotate_left_through_carry(operand, carry)
+            : Operation == 3 ? _alu.rotate_right_through_carry(operand, carry)
+            : Operation == 4 ? _alu.shift_left_arithmetic(operand)
+            : Operation == 5 ? _alu.shift_right_arithmetic(operand)
+            : Operation == 6 ? _alu.swap(operand)
+            : _alu.shift_right_logical(operand);
+        // the accumulator rotations always clear Z, the CB forms test the result
+        output.status[flag_type::zero] = output.result == 0;
+        _registers.flag = output.status;
+        return output.result;
+    }
+
+    template<int Opcode>
+    int cpu::execute()
+    {
+        return execute<Opcode>(family<decode(Opcode)>{});
+    }
+
+    template<int Opcode>
+    int cpu::execute(family<operation::invalid>)
+    {
+        std::ostringstream message;
+        message << "invalid opcode 0x" << std::hex << Opcode;
+        throw std::runtime_error(message.str());
+    }
+
+    // NOP 00 000 000
+    template<int Opcode>
+    int cpu::execute(family<operation::no_operation>)
+    {
+        return 4;
+    }
+
+    // LD 01 rrr rrr
+    template<int Opcode>
+    int cpu::execute(family<operation::load>)
+    {
+        constexpr auto destination = Opcode >> 3 & 7, source = Opcode & 7;
+        write<destination>(read<source>());
+        return destination == INDIRECT || source == INDIRECT ? 8 : 4;
+    }
+
+    // LD 00 rrr 110
+    template<int Opcode>
+    int cpu::execute(family<operation::load_immediate>)
+    {
+        constexpr auto destination = Opcode >> 3 & 7;
+        write<destination>(immediate_byte());
+        return destination == INDIRECT ? 12 : 8;
+    }
+
+    // LD 00 pp 1 010
+    template<int Opcode>
+    int cpu::execute(family<operation::load_indirect>)
+    {
+        _registers.accumulator = _memory.get_byte(indirect_address<(Opcode >> 4 & 3)>());
+        return 8;
+    }
+
+    // LD 00 pp 0 010
+    template<int Opcode>
+    int cpu::execute(family<operation::store_indirect>)
+    {
+        _memory.set_byte(indirect_address<(Opcode >> 4 & 3)>(), _registers.accumulator);
+        return 8;
+    }
+
+    // LD 11 110 000 (n), LD 11 110 010 (C)
+    template<int Opcode>
+    int cpu::execute(family<operation::load_high>)
+    {
+        constexpr auto immediate = (Opcode & 7) == 0;
+        const auto low = immediate ? immediate_byte() : _registers.general_bc.bytes.low;
+        _registers.accumulator = _memory.get_byte(make_address('\xFF', low));
+        return immediate ? 12 : 8;
+    }
+
+    // LD 11 100 000 (n), LD 11 100 010 (C)
+    template<int Opcode>
+    int cpu::execute(family<operation::store_high>)
+    {
+        constexpr auto immediate = (Opcode & 7) == 0;
+        const auto low = immediate ? immediate_byte() : _registers.general_bc.bytes.low;
+        _memory.set_byte(make_address('\xFF', low), _registers.accumulator);
+        return immediate ? 12 : 8;
+    }
+
+    // LD 11 111 010
+    template<int Opcode>
+    int cpu::execute(family<operation::load_absolute>)
+    {
+        _registers.accumulator = _memory.get_byte(immediate_word());
+        return 16;
+    }
+
+    // LD 11 101 010
+    template<int Opcode>
+    int cpu::execute(family<operation::store_absolute>)
+    {
+        _memory.set_byte(immediate_word(), _registers.accumulator);
+        return 16;
+    }
+
+    // LD 00 pp 0 001
+    template<int Opcode>
+    int cpu::execute(family<operation::load_pair_immediate>)
+    {
+        register16<(Opcode >> 4 & 3)>() = immediate_word();
+        return 12;
+    }
+
+    // LD 00 001 000
+    template<int Opcode>
+    int cpu::execute(family<operation::store_stack_pointer>)
+    {
+        const auto address = immediate_word();
+        _memory.set_byte(address, static_cast<byte>(_registers.stack_pointer));
+        _memory.set_byte((address + 1) & 0xFFFF, static_cast<byte>(_registers.stack_pointer >> 8));
+        return 20;
+    }
+
+    // LD 11 111 001
+    template<int Opcode>
+    int cpu::execute(family<operation::load_stack_pointer>)
+    {
+        _registers.stack_pointer = _registers.general_hl.value;
+        return 8;
+    }
+
+    // LD 11 111 000
+    template<int Opcode>
+    int cpu::execute(family<operation::load_stack_offset>)
+    {
+        const auto stack_pointer = _registers.stack_pointer;
+        _registers.flag = offset_stack_pointer(immediate_byte());
+        _registers.general_hl.value = _registers.stack_pointer;
+        _registers.stack_pointer = stack_pointer;
+        return 12;
+    }
+
+    // INC 00 rrr 100
+    template<int Opcode>
+    int cpu::execute(family<operation::increment>)
+    {
+        constexpr auto target = Opcode >> 3 & 7;
+        write<target>(increment_byte(read<target>()));
+        return target == INDIRECT ? 12 : 4;
+    }
+
+    // DEC 00 rrr 101
+    template<int Opcode>
+    int cpu::execute(family<operation::decrement>)
+    {
+        constexpr auto target = Opcode >> 3 & 7;
+        write<target>(decrement_byte(read<target>()));
+        return target == INDIRECT ? 12 : 4;
+    }
+
+    // INC 00 pp 0 011
+    template<int Opcode>
+    int cpu::execute(family<operation::increment_pair>)
+    {
+        ++register16<(Opcode >> 4 & 3)>();
+        return 8;
+    }
+
+    // DEC 00 pp 1 011
+    template<int Opcode>
+    int cpu::execute(family<operation::decrement_pair>)
+    {
+        --register16<(Opcode >> 4 & 3)>();
+        return 8;
+    }
+
+    // ADD 00 pp 1 001
+    template<int Opcode>
+    int cpu::execute(family<operation::add_pair>)
+    {
+        const auto output = _alu.add(_registers.general_hl.value, register16<(Opcode >> 4 & 3)>());
+        _registers.general_hl.value = output.result;
+        _registers.flag.assign<false, true, true, true>(output.status);
+        return 8;
+    }
+
+    // ADD 11 101 000
+    template<int Opcode>
+    int cpu::execute(family<operation::add_stack_offset>)
+    {
+        _registers.flag = offset_stack_pointer(immediate_byte());
+        return 16;
+    }
+
+    // ADD, ADC, SUB, SBC, AND, XOR, OR, CP 10 ooo rrr
+    template<int Opcode>
+    int cpu::execute(family<operation::arithmetic>)
+    {
+        constexpr auto source = Opcode & 7;
+        accumulate<(Opcode >> 3 & 7)>(read<source>());
+        return source == INDIRECT ? 8 : 4;
+    }
+
+    // ADD, ADC, SUB, SBC, AND, XOR, OR, CP 11 ooo 110
+    template<int Opcode>
+    int cpu::execute(family<operation::arithmetic_immediate>)
+    {
+        accumulate<(Opcode >> 3 & 7)>(immediate_byte());
+        return 8;
+    }
+
+    // RLCA, RRCA, RLA, RRA 00 0oo 111
+    template<int Opcode>
+    int cpu::execute(family<operation::rotate_accumulator>)
+    {
+        const auto accumulator = _registers.accumulator;
+        const auto carry = _registers.flag[flag_type::carry];
+        const auto output = Opcode == 0x07 ? _alu.rotate_left(accumulator, byte{1})
+            : Opcode == 0x0F ? _alu.rotate_right(accumulator, byte{1})
+            : Opcode == 0x17 ? _alu.rotate_left_through_carry(accumulator, carry)
+            : _alu.rotate_right_through_carry(accumulator, carry);
+        _registers.accumulator = output.result;
+        _registers.flag = output.status;
+        return 4;
+    }
+
+    // DAA 00 100 111
+    template<int Opcode>
+    int cpu::execute(family<operation::decimal_adjust>)
+    {
+        const auto output = _alu.daa(_registers.accumulator, _registers.flag);
+        _registers.accumulator = output.result;
+        _registers.flag.assign<true, false, true, true>(output.status);
+        return 4;
+    }
+
+    // CPL 00 101 111
+    template<int Opcode>
+    int cpu::execute(family<operation::complement>)
+    {
+        _registers.accumulator = static_cast<byte>(~_registers.accumulator);
+        _registers.flag[flag_type::subtract] = true;
+        _registers.flag[flag_type::half_carry] = true;
+        return 4;
+    }
+
+    // SCF 00 110 111
+    template<int Opcode>
+    int cpu::execute(family<operation::set_carry>)
+    {
+        _registers.flag.assign<false, true, true, true>(flags{static_cast<byte>(flag_type::carry)});
+        return 4;
+    }
+
+    // CCF 00 111 111
+    template<int Opcode>
+    int cpu::execute(family<operation::complement_carry>)
+    {
+        const auto carry = _registers.flag[flag_type::carry] ? byte{0} : static_cast<byte>(flag_type::carry);
+        _registers.flag.assign<false, true, true, true>(flags{carry});
+        return 4;
+    }
+
+    // JP 11 000 011, JP 11 0cc 010
+    template<int Opcode>
+    int cpu::execute(family<operation::jump>)
+    {
+        constexpr auto condition_index = Opcode == 0xC3 ? ALWAYS : Opcode >> 3 & 3;
+        const auto address = immediate_word();
+        if (!condition<condition_index>()) {
+            return 12;
+        }
+
+        _registers.program_counter = address;
+        return 16;
+    }
+
+    // JR 00 011 000, JR 00 1cc 000
+    template<int Opcode>
+    int cpu::execute(family<operation::jump_relative>)
+    {
+        constexpr auto condition_index = Opcode == 0x18 ? ALWAYS : Opcode >> 3 & 3;
+        const auto offset = static_cast<sbyte>(immediate_byte());
+        if (!condition<condition_index>()) {
+            return 8;
+        }
+
+        _registers.program_counter = static_cast<unsigned short>(_registers.program_counter + offset);
+        return 12;
+    }
+
+    // JP 11 101 001
+    template<int Opcode>
+    int cpu::execute(family<operation::jump_hl>)
+    {
+        _registers.program_counter = _registers.general_hl.value;
+        return 4;
+    }
+
+    // CALL 11 001 101, CALL 11 0cc 100
+    template<int Opcode>
+    int cpu::execute(family<operation::call>)
+    {
+        constexpr auto condition_index = Opcode == 0xCD ? ALWAYS : Opcode >> 3 & 3;
+        const auto address = immediate_word();
+        if (!condition<condition_index>()) {
+            return 12;
+        }
+
+        push(_registers.program_counter);
+        _registers.program_counter = address;
+        return 24;
+    }
+
+    // RET 11 001 001, RET 11 0cc 000
+    template<int Opcode>
+    int cpu::execute(family<operation::return_from_call>)
+    {
+        constexpr auto condition_index = Opcode == 0xC9 ? ALWAYS : Opcode >> 3 & 3;
+        if (!condition<condition_index>()) {
+            return 8;
+        }
+
+        _registers.program_counter = pop();
+        return condition_index == ALWAYS ? 16 : 20;
+    }
+
+    // RETI 11 011 001
+    template<int Opcode>
+    int cpu::execute(family<operation::return_from_interrupt>)
+    {
+        _registers.program_counter = pop();
+        _interrupts_enabled = true;
+        _enable_at = scheduler::NEVER;
+        // unlike EI, right after this instruction
+        _memory.get_scheduler().schedule(scheduler::event::interrupt, _memory.get_scheduler().get_now());
+        return 16;
+    }
+
+    // RST 11 ttt 111
+    template<int Opcode>
+    int cpu::execute(family<operation::restart>)
+    {
+        push(_registers.program_counter);
+        _registers.program_counter = Opcode & 0x38;
+        return 16;
+    }
+
+    // PUSH 11 pp 0 101, where pair 3 is AF instead of SP
+    template<int Opcode>
+    int cpu::execute(family<operation::push>)
+    {
+        constexpr auto pair = Opcode >> 4 & 3;
+        if (pair == 3) {
+            push(word{static_cast<byte>(_registers.flag), _registers.accumulator}.value);
+        }
+        else {
+            push(register16<pair>());
+        }
+
+        return 16;
+    }
+
+    // POP 11 pp 0 001, where pair 3 is AF instead of SP
+    template<int Opcode>
+    int cpu::execute(family<operation::pop>)
+    {
+        constexpr auto pair = Opcode >> 4 & 3;
+        if (pair == 3) {
+            word value;
+            value.value = pop();
+            _registers.flag = static_cast<byte>(value.bytes.low & 0xF0);
+            _registers.accumulator = value.bytes.high;
+        }
+        else {
+            register16<pair>() = pop();
+        }
+
+        return 12;
+    }
+
+    // DI 11 110 011, EI 11 111 011
+    template<int Opcode>
+    int cpu::execute(family<operation::interrupt_enable>)
+    {
+        if (Opcode == 0xF3) {
+            _interrupts_enabled = false;
+            _enable_at = scheduler::NEVER;
+        }
+        else if (!_interrupts_enabled && _enable_at == scheduler::NEVER) {
+            // EI takes effect after the instruction following it, so the cpu looks again once that one started
+            _enable_at = _memory.get_scheduler().get_now() + 5;
+            _memory.get_scheduler().schedule(scheduler::event::interrupt, _enable_at);
+        }
+
+        return 4;
+    }
+
+    // HALT 01 110 110, STOP 00 010 000 followed by any byte
+    template<int Opcode>
+    int cpu::execute(family<operation::halt>)
+    {
+        // an interrupt both requested and enabled ends it at once, whether IME then lets it be taken or not; the
+        // byte after a HALT run into this way with IME off is not read twice, unlike on hardware
+        if ((_memory.get_byte(memory::INTERRUPT_FLAG) & _memory.get_byte(memory::INTERRUPT_ENABLE) & 0x1F) != 0) {
+            _halted = 0;
+            return 4;
+        }
+
+        // STOP resets the divider on the way in; there is no joypad to wake it, so it waits for an interrupt too
+        if (Opcode == 0x10 && _halted == 0) {
+            _memory.set_byte(0xFF04, 0);
+        }
+
+        // nothing can change before the next event, so the clock skips straight to it, or to the end of the run,
+        // in whole machine cycles; PC stays on the instruction, which runs again then unless an interrupt is taken
+        _halted = length(Opcode);
+        _registers.program_counter = static_cast<unsigned short>(_registers.program_counter - _halted);
+        const auto& events = _memory.get_scheduler();
+        const auto until = std::min(events.get_next(), _run_end);
+        return until > events.get_now() + 4 ? static_cast<int>((until - events.get_now() + 3) & ~3ull) : 4;
+    }
+
+    // CB 11 001 011
+    template<int Opcode>
+    int cpu::execute(family<operation::prefix>)
+    {
+        return step_prefixed();
+    }
+
+    template<int Opcode>
+    int cpu::execute_prefixed()
+    {
+        return execute_prefixed<Opcode>(family<decode_prefixed(Opcode)>{});
+    }
+
+    // RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL 00 ooo rrr
+    template<int Opcode>
+    int cpu::execute_prefixed(family<operation::rotate_shift>)
+    {
+        constexpr auto target = Opcode & 7;
+        write<target>(rotate_shift<(Opcode >> 3 & 7)>(read<target>()));
+        return target == INDIRECT ? 16 : 8;
+    }
+
+    // BIT 01 bbb rrr
+    template<int Opcode>
+    int cpu::execute_prefixed(family<operation::test_bit>)
+    {
+        constexpr auto source = Opcode & 7;
+        constexpr auto mask = 1 << (Opcode >> 3 & 7);
+        const auto zero = (read<source>() & mask) == 0 ? static_cast<byte>(flag_type::zero) : byte{0};
+        _registers.flag.assign<true, true, true, false>(flags{static_cast<byte>(zero | static_cast<byte>(flag_type::half_carry))});
+        return source == INDIRECT ? 12 : 8;
+    }
+
+    // RES 10 bbb rrr
+    template<int Opcode>
+    int cpu::execute_prefixed(family<operation::reset_bit>)
+    {
+        constexpr auto target = Opcode & 7;
+        constexpr auto mask = static_cast<byte>(~(1 << (Opcode >> 3 & 7)));
+        write<target>(static_cast<byte>(read<target>() & mask));
+        return target == INDIRECT ? 16 : 8;
+    }
+
+    // SET 11 bbb rrr
+    template<int Opcode>
+    int cpu::execute_prefixed(family<operation::set_bit>)
+    {
+        constexpr auto target = Opcode & 7;
+        constexpr auto mask = static_cast<byte>(1 << (Opcode >> 3 & 7));
+        write<target>(static_cast<byte>(read<target>() | mask));
+        return target == INDIRECT ? 16 : 8;
+    }
+
+    template<int... Opcodes>
+    int cpu::execute_fused()
+    {
+        return execute_fused<Opcodes...>(_operand, _memory.get_code_writes());
+    }
+
+    template<int Opcode>
+    int cpu::execute_fused(unsigned int operands, unsigned int)
+    {
+        _operand = operands;
+        return execute<Opcode>();
+    }
+
+    template<int Opcode, int Next, int... Rest>
+    int cpu::execute_fused(unsigned int operands, unsigned int code_writes)
+    {
+        constexpr auto bits = 8 * (length(Opcode) - 1);
+        _operand = operands & ((1u << bits) - 1);
+        const auto cycles = execute<Opcode>();
+        if (_memory.get_code_writes() != code_writes) {
+            _fused_cut_length = fused_length<Next, Rest...>();
+            _fused_cut_cycles = fused_duration<Next, Rest...>();
+            return cycles;
+        }
+
+        auto& events = _memory.get_scheduler();
+        events.set_now(events.get_now() + static_cast<unsigned long long>(cycles));
+        return cycles + execute_fused<Next, Rest...>(operands >> bits, code_writes);
+    }
+
+    template<int... Opcodes>
+    constexpr int cpu::fused_length()
+    {
+        auto sum = 0;
+        for (const auto part : {length(Opcodes)...}) {
+            sum += part;
+        }
+        return sum;
+    }
+
+    template<int... Opcodes>
+    constexpr int cpu::fused_duration()
+    {
+        auto sum = 0;
+        for (const auto part : {duration(Opcodes)...}) {
+            sum += part;
+        }
+        return sum;
+    }
+
+    template<int Opcode>
+    int cpu::run_static(unsigned short operand, unsigned short next)
+    {
+        _registers.program_counter = next;
+        _operand = operand;
+        auto& events = _memory.get_scheduler();
+        const auto cycles = execute<Opcode>();
+        // the next instruction starts when this one ends
+        events.set_now(events.get_now() + static_cast<unsigned long long>(cycles));
+        return cycles;
+    }
+
+    template<int Opcode>
+    int cpu::run_static_prefixed(unsigned short next)
+    {
+        _registers.program_counter = next;
+        _operand = Opcode;
+        auto& events = _memory.get_scheduler();
+        const auto cycles = execute_prefixed<Opcode>();
+        events.set_now(events.get_now() + static_cast<unsigned long long>(cycles));
+        return cycles;
+    }
+}
+
+#endif
@@ -1,1452 +1,600 @@
-#include "cpu.h"
+#include "cpu-handlers.h"
 
 namespace gameboy {
-    cpu::cpu(memory& mem) : _memory(mem), _cycle(0)
+    cpu::cpu(memory& mem) : _memory(mem), _cycle(0), _frame_start(mem.get_scheduler().get_now()),
+        _interrupts_enabled(false), _enable_at(scheduler::NEVER), _halted(0), _run_end(0), _operand(0), _block_cache(mem),
+        _block_cache_enabled(false), _fusion_enabled(false), _idle_skipping(true), _skipped_cycles(0), _fused_cut_length(0),
+        _fused_cut_cycles(0), _fused_sequences(0), _recompiled_versions(), _recompiled_runs(0)
+#ifdef GAMEBOY_JIT
+        , _jit_enabled(false), _native_start(0)
+#endif
     {
-        _instruction_map['\x00'] = [this, cycle = 4] {
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 00 0001 n n
-        _instruction_map['\x01'] = [this, cycle = 12] {
-            _registers.general_c = _memory.get_byte(_registers.program_counter++);
-            _registers.general_b = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00000010
-        _instruction_map['\x02'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_bc, _registers.accumulator);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 00 0011
-        _instruction_map['\x03'] = [this, cycle = 8] {
-            ++_registers.general_bc;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 000 100
-        _instruction_map['\x04'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.general_b, 1);
-            _registers.general_b = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 000 101
-        _instruction_map['\x05'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.general_b, 1);
-            _registers.general_b = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 000 110 n
-        _instruction_map['\x06'] = [this, cycle = 8] {
-            _registers.general_b = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // RLCA 00000111
-        _instruction_map['\x07'] = [this, cycle = 4] {
-            const auto output = _alu.rotate_left(_registers.accumulator, {1});
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 00 00 1001
-        _instruction_map['\x09'] = [this, cycle = 8] {
-            const auto output = _alu.add(_registers.general_hl, _registers.general_bc);
-            _registers.general_hl = output.result;
-            _registers.flag.assign<false, true, true, true>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00001010
-        _instruction_map['\x0A'] = [this, cycle = 8] {
-            _registers.accumulator = _memory.get_byte(_registers.general_bc);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 00 1011
-        _instruction_map['\x0B'] = [this, cycle = 8] {
-            --_registers.general_bc;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 001 100
-        _instruction_map['\x0C'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.general_c, 1);
-            _registers.general_c = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 001 101
-        _instruction_map['\x0D'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.general_c, 1);
-            _registers.general_c = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 001 110 n
-        _instruction_map['\x0E'] = [this, cycle = 8] {
-            _registers.general_c = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 01 0001 n n
-        _instruction_map['\x11'] = [this, cycle = 12] {
-            _registers.general_e = _memory.get_byte(_registers.program_counter++);
-            _registers.general_d = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00010010
-        _instruction_map['\x12'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_de, _registers.accumulator);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 01 0011
-        _instruction_map['\x13'] = [this, cycle = 8] {
-            ++_registers.general_de;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 010 100
-        _instruction_map['\x14'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.general_d, 1);
-            _registers.general_d = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 010 101
-        _instruction_map['\x15'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.general_d, 1);
-            _registers.general_d = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 010 110 n
-        _instruction_map['\x16'] = [this, cycle = 8] {
-            _registers.general_d = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 00 01 1001
-        _instruction_map['\x19'] = [this, cycle = 8] {
-            const auto output = _alu.add(_registers.general_hl, _registers.general_de);
-            _registers.general_hl = output.result;
-            _registers.flag.assign<false, true, true, true>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00011010
-        _instruction_map['\x1A'] = [this, cycle = 8] {
-            _registers.accumulator = _memory.get_byte(_registers.general_de);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 01 1011
-        _instruction_map['\x1B'] = [this, cycle = 8] {
-            --_registers.general_de;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 011 100
-        _instruction_map['\x1C'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.general_e, 1);
-            _registers.general_e = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 011 101
-        _instruction_map['\x1D'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.general_e, 1);
-            _registers.general_e = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 011 110 n
-        _instruction_map['\x1E'] = [this, cycle = 8] {
-            _registers.general_e = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 10 0001 n n
-        _instruction_map['\x21'] = [this, cycle = 12] {
-            _registers.general_l = _memory.get_byte(_registers.program_counter++);
-            _registers.general_h = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LDI 00100010
-        _instruction_map['\x22'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_hl++, _registers.accumulator);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 10 0011
-        _instruction_map['\x23'] = [this, cycle = 8] {
-            ++_registers.general_hl;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 100 100
-        _instruction_map['\x24'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.general_h, 1);
-            _registers.general_h = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 100 101
-        _instruction_map['\x25'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.general_h, 1);
-            _registers.general_h = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 100 110 n
-        _instruction_map['\x26'] = [this, cycle = 8] {
-            _registers.general_h = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DAA 00100111
-        _instruction_map['\x27'] = [this, cycle = 4] {
-            const auto output = _alu.daa(_registers.accumulator, _registers.flag);
-            _registers.accumulator = output.result;
-            _registers.flag.assign<true, false, true, true>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 00 10 1001
-        _instruction_map['\x29'] = [this, cycle = 8] {
-            const auto output = _alu.add(_registers.general_hl, _registers.general_hl);
-            _registers.general_hl = output.result;
-            _registers.flag.assign<false, true, true, true>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LDI 00101010
-        _instruction_map['\x2A'] = [this, cycle = 8] {
-            _registers.accumulator = _memory.get_byte(_registers.general_hl++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 10 1011
-        _instruction_map['\x2B'] = [this, cycle = 8] {
-            --_registers.general_hl;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 101 100
-        _instruction_map['\x2C'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.general_l, 1);
-            _registers.general_l = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 101 101
-        _instruction_map['\x2D'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.general_l, 1);
-            _registers.general_l = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 101 110 n
-        _instruction_map['\x2E'] = [this, cycle = 8] {
-            _registers.general_l = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CPL 00101111
-        _instruction_map['\x2F'] = [this, cycle = 4] {
-            const auto output = _alu.xor_byte(_registers.accumulator, {0xFF});
-            _registers.accumulator = output.result;
-            _registers.flag[flag_type::subtract] = true;
-            _registers.flag[flag_type::half_carry] = true;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 11 0001 n n
-        _instruction_map['\x31'] = [this, cycle = 12] {
-            const auto low = _memory.get_byte(_registers.program_counter++);
-            const auto high = _memory.get_byte(_registers.program_counter++);
-            _registers.stack_pointer = word(low, high).value;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LDD 00110010
-        _instruction_map['\x32'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_hl--, _registers.accumulator);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 11 0011
-        _instruction_map['\x33'] = [this, cycle = 8] {
-            ++_registers.stack_pointer;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 110 100
-        _instruction_map['\x34'] = [this, cycle = 12] {
-            const auto output = _alu.add(_memory.get_byte(_registers.general_hl), 1);
-            _memory.set_byte(_registers.general_hl, output.result);
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 110 101
-        _instruction_map['\x35'] = [this, cycle = 12] {
-            const auto output = _alu.subtract(_memory.get_byte(_registers.general_hl), 1);
-            _memory.set_byte(_registers.general_hl, output.result);
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00110110 n
-        _instruction_map['\x36'] = [this, cycle = 12] {
-            _memory.set_byte(_registers.general_hl, _memory.get_byte(_registers.program_counter++));
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 00 11 1001
-        _instruction_map['\x39'] = [this, cycle = 8] {
-            const auto output = _alu.add(_registers.general_hl, _registers.stack_pointer);
-            _registers.general_hl = output.result;
-            _registers.flag.assign<false, true, true, true>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LDD 00111010
-        _instruction_map['\x3A'] = [this, cycle = 8] {
-            _registers.accumulator = _memory.get_byte(_registers.general_hl--);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 11 1011
-        _instruction_map['\x3B'] = [this, cycle = 8] {
-            --_registers.stack_pointer;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // INC 00 111 100
-        _instruction_map['\x3C'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, 1);
-            _registers.accumulator = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // DEC 00 111 101
-        _instruction_map['\x3D'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, 1);
-            _registers.accumulator = output.result;
-            _registers.flag.assign<true, true, true, false>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 00 111 110 n
-        _instruction_map['\x3E'] = [this, cycle = 8] {
-            _registers.accumulator = _memory.get_byte(_registers.program_counter++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 000 000
-        _instruction_map['\x40'] = [this, cycle = 4] {
-            _registers.general_b = _registers.general_b;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 000 001
-        _instruction_map['\x41'] = [this, cycle = 4] {
-            _registers.general_b = _registers.general_c;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 000 010
-        _instruction_map['\x42'] = [this, cycle = 4] {
-            _registers.general_b = _registers.general_d;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 000 011
-        _instruction_map['\x43'] = [this, cycle = 4] {
-            _registers.general_b = _registers.general_e;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 000 100
-        _instruction_map['\x44'] = [this, cycle = 4] {
-            _registers.general_b = _registers.general_h;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 000 101
-        _instruction_map['\x45'] = [this, cycle = 4] {
-            _registers.general_b = _registers.general_l;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 000 110
-        _instruction_map['\x46'] = [this, cycle = 8] {
-            _registers.general_b = _memory.get_byte(_registers.general_hl);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 000 111
-        _instruction_map['\x47'] = [this, cycle = 4] {
-            _registers.general_b = _registers.accumulator;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 001 000
-        _instruction_map['\x48'] = [this, cycle = 4] {
-            _registers.general_c = _registers.general_b;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 001 001
-        _instruction_map['\x49'] = [this, cycle = 4] {
-            _registers.general_c = _registers.general_c;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 001 010
-        _instruction_map['\x4A'] = [this, cycle = 4] {
-            _registers.general_c = _registers.general_d;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 001 011
-        _instruction_map['\x4B'] = [this, cycle = 4] {
-            _registers.general_c = _registers.general_e;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 001 100
-        _instruction_map['\x4C'] = [this, cycle = 4] {
-            _registers.general_c = _registers.general_h;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 001 101
-        _instruction_map['\x4D'] = [this, cycle = 4] {
-            _registers.general_c = _registers.general_l;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 001 110
-        _instruction_map['\x4E'] = [this, cycle = 8] {
-            _registers.general_c = _memory.get_byte(_registers.general_hl);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 001 111
-        _instruction_map['\x4F'] = [this, cycle = 4] {
-            _registers.general_c = _registers.accumulator;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 010 000
-        _instruction_map['\x50'] = [this, cycle = 4] {
-            _registers.general_d = _registers.general_b;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 010 001
-        _instruction_map['\x51'] = [this, cycle = 4] {
-            _registers.general_d = _registers.general_c;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 010 010
-        _instruction_map['\x52'] = [this, cycle = 4] {
-            _registers.general_d = _registers.general_d;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 010 011
-        _instruction_map['\x53'] = [this, cycle = 4] {
-            _registers.general_d = _registers.general_e;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 010 100
-        _instruction_map['\x54'] = [this, cycle = 4] {
-            _registers.general_d = _registers.general_h;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 010 101
-        _instruction_map['\x55'] = [this, cycle = 4] {
-            _registers.general_d = _registers.general_l;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 010 110
-        _instruction_map['\x56'] = [this, cycle = 8] {
-            _registers.general_d = _memory.get_byte(_registers.general_hl);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 010 111
-        _instruction_map['\x57'] = [this, cycle = 4] {
-            _registers.general_d = _registers.accumulator;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 011 000
-        _instruction_map['\x58'] = [this, cycle = 4] {
-            _registers.general_e = _registers.general_b;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 011 001
-        _instruction_map['\x59'] = [this, cycle = 4] {
-            _registers.general_e = _registers.general_c;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 011 010
-        _instruction_map['\x5A'] = [this, cycle = 4] {
-            _registers.general_e = _registers.general_d;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 011 011
-        _instruction_map['\x5B'] = [this, cycle = 4] {
-            _registers.general_e = _registers.general_e;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 011 100
-        _instruction_map['\x5C'] = [this, cycle = 4] {
-            _registers.general_e = _registers.general_h;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 011 101
-        _instruction_map['\x5D'] = [this, cycle = 4] {
-            _registers.general_e = _registers.general_l;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 011 110
-        _instruction_map['\x5E'] = [this, cycle = 8] {
-            _registers.general_e = _memory.get_byte(_registers.general_hl);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 011 111
-        _instruction_map['\x5F'] = [this, cycle = 4] {
-            _registers.general_e = _registers.accumulator;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 100 000
-        _instruction_map['\x60'] = [this, cycle = 4] {
-            _registers.general_h = _registers.general_b;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 100 001
-        _instruction_map['\x61'] = [this, cycle = 4] {
-            _registers.general_h = _registers.general_c;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 100 010
-        _instruction_map['\x62'] = [this, cycle = 4] {
-            _registers.general_h = _registers.general_d;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 100 011
-        _instruction_map['\x63'] = [this, cycle = 4] {
-            _registers.general_h = _registers.general_e;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 100 100
-        _instruction_map['\x64'] = [this, cycle = 4] {
-            _registers.general_h = _registers.general_h;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 100 101
-        _instruction_map['\x65'] = [this, cycle = 4] {
-            _registers.general_h = _registers.general_l;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 100 110
-        _instruction_map['\x66'] = [this, cycle = 8] {
-            _registers.general_h = _memory.get_byte(_registers.general_hl);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 100 111
-        _instruction_map['\x67'] = [this, cycle = 4] {
-            _registers.general_h = _registers.accumulator;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 101 000
-        _instruction_map['\x68'] = [this, cycle = 4] {
-            _registers.general_l = _registers.general_b;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 101 001
-        _instruction_map['\x69'] = [this, cycle = 4] {
-            _registers.general_l = _registers.general_c;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 101 010
-        _instruction_map['\x6A'] = [this, cycle = 4] {
-            _registers.general_l = _registers.general_d;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 101 011
-        _instruction_map['\x6B'] = [this, cycle = 4] {
-            _registers.general_l = _registers.general_e;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 101 100
-        _instruction_map['\x6C'] = [this, cycle = 4] {
-            _registers.general_l = _registers.general_h;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 101 101
-        _instruction_map['\x6D'] = [this, cycle = 4] {
-            _registers.general_l = _registers.general_l;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 101 110
-        _instruction_map['\x6E'] = [this, cycle = 8] {
-            _registers.general_l = _memory.get_byte(_registers.general_hl);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 101 111
-        _instruction_map['\x6F'] = [this, cycle = 4] {
-            _registers.general_l = _registers.accumulator;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01110 000
-        _instruction_map['\x70'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_hl, _registers.general_b);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01110 001
-        _instruction_map['\x71'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_hl, _registers.general_c);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01110 010
-        _instruction_map['\x72'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_hl, _registers.general_d);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01110 011
-        _instruction_map['\x73'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_hl, _registers.general_e);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01110 100
-        _instruction_map['\x74'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_hl, _registers.general_h);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01110 101
-        _instruction_map['\x75'] = [this, cycle = 8] {
-            _memory.set_byte( _registers.general_hl, _registers.general_l);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01110 111
-        _instruction_map['\x77'] = [this, cycle = 8] {
-            _memory.set_byte(_registers.general_hl, _registers.accumulator);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 111 000
-        _instruction_map['\x78'] = [this, cycle = 4] {
-            _registers.accumulator = _registers.general_b;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 111 001
-        _instruction_map['\x79'] = [this, cycle = 4] {
-            _registers.accumulator = _registers.general_c;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 111 010
-        _instruction_map['\x7A'] = [this, cycle = 4] {
-            _registers.accumulator = _registers.general_d;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 111 011
-        _instruction_map['\x7B'] = [this, cycle = 4] {
-            _registers.accumulator = _registers.general_e;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 111 100
-        _instruction_map['\x7C'] = [this, cycle = 4] {
-            _registers.accumulator = _registers.general_h;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 111 101
-        _instruction_map['\x7D'] = [this, cycle = 4] {
-            _registers.accumulator = _registers.general_l;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 111 110
-        _instruction_map['\x7E'] = [this, cycle = 8] {
-            _registers.accumulator = _memory.get_byte(_registers.general_hl);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 01 111 111
-        _instruction_map['\x7F'] = [this, cycle = 4] {
-            _registers.accumulator = _registers.accumulator;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 10000 000
-        _instruction_map['\x80'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_b);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 10000 001
-        _instruction_map['\x81'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_c);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 10000 010
-        _instruction_map['\x82'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_d);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 10000 011
-        _instruction_map['\x83'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_e);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 10000 100
-        _instruction_map['\x84'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_h);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 10000 101
-        _instruction_map['\x85'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_l);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 10000110
-        _instruction_map['\x86'] = [this, cycle = 8] {
-            const auto output = _alu.add(_registers.accumulator, _memory.get_byte(_registers.general_hl));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 10000 111
-        _instruction_map['\x87'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.accumulator);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 10001 000
-        _instruction_map['\x88'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_b, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 10001 001
-        _instruction_map['\x89'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_c, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 10001 010
-        _instruction_map['\x8A'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_d, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 10001 011
-        _instruction_map['\x8B'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_e, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 10001 100
-        _instruction_map['\x8C'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_h, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 10001 101
-        _instruction_map['\x8D'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.general_l, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 10001110
-        _instruction_map['\x8E'] = [this, cycle = 8] {
-            const auto output = _alu.add(_registers.accumulator, _memory.get_byte(_registers.general_hl),
-                _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 10001 111
-        _instruction_map['\x8F'] = [this, cycle = 4] {
-            const auto output = _alu.add(_registers.accumulator, _registers.accumulator, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 10010 000
-        _instruction_map['\x90'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_b);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 10010 001
-        _instruction_map['\x91'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_c);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 10010 010
-        _instruction_map['\x92'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_d);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 10010 011
-        _instruction_map['\x93'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_e);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 10010 100
-        _instruction_map['\x94'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_h);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 10010 101
-        _instruction_map['\x95'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_l);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 10010110
-        _instruction_map['\x96'] = [this, cycle = 8] {
-            const auto output = _alu.subtract(_registers.accumulator, _memory.get_byte(_registers.general_hl));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 10010 111
-        _instruction_map['\x97'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.accumulator);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 10011 000
-        _instruction_map['\x98'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_b, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 10011 001
-        _instruction_map['\x99'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_c, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 10011 010
-        _instruction_map['\x9A'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_d, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 10011 011
-        _instruction_map['\x9B'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_e, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 10011 100
-        _instruction_map['\x9C'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_h, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 10011 101
-        _instruction_map['\x9D'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_l, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 10011110
-        _instruction_map['\x9E'] = [this, cycle = 8] {
-            const auto output = _alu.subtract(_registers.accumulator, _memory.get_byte(_registers.general_hl),
-                _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 10011 111
-        _instruction_map['\x9F'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.accumulator, _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 10100 000
-        _instruction_map['\xA0'] = [this, cycle = 4] {
-            const auto output = _alu.and_byte(_registers.accumulator, _registers.general_b);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 10100 001
-        _instruction_map['\xA1'] = [this, cycle = 4] {
-            const auto output = _alu.and_byte(_registers.accumulator, _registers.general_c);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 10100 010
-        _instruction_map['\xA2'] = [this, cycle = 4] {
-            const auto output = _alu.and_byte(_registers.accumulator, _registers.general_d);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 10100 011
-        _instruction_map['\xA3'] = [this, cycle = 4] {
-            const auto output = _alu.and_byte(_registers.accumulator, _registers.general_e);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 10100 100
-        _instruction_map['\xA4'] = [this, cycle = 4] {
-            const auto output = _alu.and_byte(_registers.accumulator, _registers.general_h);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 10100 101
-        _instruction_map['\xA5'] = [this, cycle = 4] {
-            const auto output = _alu.and_byte(_registers.accumulator, _registers.general_l);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 10100110
-        _instruction_map['\xA6'] = [this, cycle = 8] {
-            const auto output = _alu.and_byte(_registers.accumulator, _memory.get_byte(_registers.general_hl));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 10100 111
-        _instruction_map['\xA7'] = [this, cycle = 4] {
-            const auto output = _alu.and_byte(_registers.accumulator, _registers.accumulator);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 10101 000
-        _instruction_map['\xA8'] = [this, cycle = 4] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _registers.general_b);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 10101 001
-        _instruction_map['\xA9'] = [this, cycle = 4] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _registers.general_c);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 10101 010
-        _instruction_map['\xAA'] = [this, cycle = 4] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _registers.general_d);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 10101 011
-        _instruction_map['\xAB'] = [this, cycle = 4] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _registers.general_e);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 10101 100
-        _instruction_map['\xAC'] = [this, cycle = 4] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _registers.general_h);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 10101 101
-        _instruction_map['\xAD'] = [this, cycle = 4] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _registers.general_l);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 10101110
-        _instruction_map['\xAE'] = [this, cycle = 8] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _memory.get_byte(_registers.general_hl));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 10101 111
-        _instruction_map['\xAF'] = [this, cycle = 4] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _registers.accumulator);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 10110 000
-        _instruction_map['\xB0'] = [this, cycle = 4] {
-            const auto output = _alu.or_byte(_registers.accumulator, _registers.general_b);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 10110 001
-        _instruction_map['\xB1'] = [this, cycle = 4] {
-            const auto output = _alu.or_byte(_registers.accumulator, _registers.general_c);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 10110 010
-        _instruction_map['\xB2'] = [this, cycle = 4] {
-            const auto output = _alu.or_byte(_registers.accumulator, _registers.general_d);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 10110 011
-        _instruction_map['\xB3'] = [this, cycle = 4] {
-            const auto output = _alu.or_byte(_registers.accumulator, _registers.general_e);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 10110 100
-        _instruction_map['\xB4'] = [this, cycle = 4] {
-            const auto output = _alu.or_byte(_registers.accumulator, _registers.general_h);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 10110 101
-        _instruction_map['\xB5'] = [this, cycle = 4] {
-            const auto output = _alu.or_byte(_registers.accumulator, _registers.general_l);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 10110110
-        _instruction_map['\xB6'] = [this, cycle = 8] {
-            const auto output = _alu.or_byte(_registers.accumulator, _memory.get_byte(_registers.general_hl));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 10110 111
-        _instruction_map['\xB7'] = [this, cycle = 4] {
-            const auto output = _alu.or_byte(_registers.accumulator, _registers.accumulator);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 10111 000
-        _instruction_map['\xB8'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_b);
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 10111 001
-        _instruction_map['\xB9'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_c);
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 10111 010
-        _instruction_map['\xBA'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_d);
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 10111 011
-        _instruction_map['\xBB'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_e);
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 10111 100
-        _instruction_map['\xBC'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_h);
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 10111 101
-        _instruction_map['\xBD'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.general_l);
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 10111110
-        _instruction_map['\xBE'] = [this, cycle = 8] {
-            const auto output = _alu.subtract(_registers.accumulator, _memory.get_byte(_registers.general_hl));
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 10111 111
-        _instruction_map['\xBF'] = [this, cycle = 4] {
-            const auto output = _alu.subtract(_registers.accumulator, _registers.accumulator);
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // POP 11 00 0001
-        _instruction_map['\xC1'] = [this, cycle = 12] {
-            _registers.general_c = _memory.get_byte(_registers.stack_pointer++);
-            _registers.general_b = _memory.get_byte(_registers.stack_pointer++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // PUSH 11 00 0101
-        _instruction_map['\xC5'] = [this, cycle = 16] {
-            _memory.set_byte(--_registers.stack_pointer, _registers.general_b);
-            _memory.set_byte(--_registers.stack_pointer, _registers.general_c);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 11000110 n
-        _instruction_map['\xC6'] = [this, cycle = 8] {
-            const auto output = _alu.add(_registers.accumulator, _memory.get_byte(_registers.program_counter++));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADC 11001110 n
-        _instruction_map['\xCE'] = [this, cycle = 8] {
-            const auto output = _alu.add(_registers.accumulator, _memory.get_byte(_registers.program_counter++),
-                _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // POP 11 01 0001
-        _instruction_map['\xD1'] = [this, cycle = 12] {
-            _registers.general_e = _memory.get_byte(_registers.stack_pointer++);
-            _registers.general_d = _memory.get_byte(_registers.stack_pointer++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // PUSH 11 01 0101
-        _instruction_map['\xD5'] = [this, cycle = 16] {
-            _memory.set_byte(--_registers.stack_pointer, _registers.general_d);
-            _memory.set_byte(--_registers.stack_pointer, _registers.general_e);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SUB 11010110 n
-        _instruction_map['\xD6'] = [this, cycle = 8] {
-            const auto output = _alu.subtract(_registers.accumulator, _memory.get_byte(_registers.program_counter++));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // SBC 11011110 n
-        _instruction_map['\xDE'] = [this, cycle = 8] {
-            const auto output = _alu.subtract(_registers.accumulator, _memory.get_byte(_registers.program_counter++),
-                _registers.flag[flag_type::carry]);
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 11100000 n
-        _instruction_map['\xE0'] = [this, cycle = 12] {
-            const auto address = make_address('\xFF', _memory.get_byte(_registers.program_counter++));
-            _memory.set_byte(address, _registers.accumulator);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // POP 11 10 0001
-        _instruction_map['\xE1'] = [this, cycle = 12] {
-            _registers.general_l = _memory.get_byte(_registers.stack_pointer++);
-            _registers.general_h = _memory.get_byte(_registers.stack_pointer++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 11100010
-        _instruction_map['\xE2'] = [this, cycle = 8] {
-            const auto address = make_address('\xFF', _registers.general_c);
-            _registers.accumulator = _memory.get_byte(address);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // PUSH 11 10 0101
-        _instruction_map['\xE5'] = [this, cycle = 16] {
-            _memory.set_byte(--_registers.stack_pointer, _registers.general_h);
-            _memory.set_byte(--_registers.stack_pointer, _registers.general_l);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // AND 11000110 n
-        _instruction_map['\xE6'] = [this, cycle = 8] {
-            const auto output = _alu.and_byte(_registers.accumulator, _memory.get_byte(_registers.program_counter++));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // ADD 11101000
-        _instruction_map['\xE8'] = [this, cycle = 16] {
-            const sbyte offset = _memory.get_byte(_registers.program_counter++);
-            const auto output = _alu.add(_registers.stack_pointer, offset);
-            _registers.stack_pointer = output.result;
-            _registers.flag[flag_type::zero] = false;
-            _registers.flag.assign<false, true, true, true>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 11101010 (nn)
-        _instruction_map['\xEA'] = [this, cycle = 16] {
-            const auto low = _memory.get_byte(_registers.program_counter++);
-            const auto high = _memory.get_byte(_registers.program_counter++);
-            const auto address = make_address(high, low);
-            _memory.set_byte(address, _registers.accumulator);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // XOR 11101110 n
-        _instruction_map['\xEE'] = [this, cycle = 8] {
-            const auto output = _alu.xor_byte(_registers.accumulator, _memory.get_byte(_registers.program_counter++));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 11110000 n
-        _instruction_map['\xF0'] = [this, cycle = 12] {
-            const auto address = 0xFF00 + _memory.get_byte(_registers.program_counter++);
-            _registers.accumulator = _memory.get_byte(address);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // POP 11 11 0001
-        _instruction_map['\xF1'] = [this, cycle = 12] {
-            _registers.flag = _memory.get_byte(_registers.stack_pointer++);
-            _registers.accumulator = _memory.get_byte(_registers.stack_pointer++);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 11110010
-        _instruction_map['\xF2'] = [this, cycle = 8] {
-            const auto address = 0xFF00 + _registers.general_c;
-            _memory.set_byte(address, _registers.accumulator);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // PUSH 11 11 0101
-        _instruction_map['\xF5'] = [this, cycle = 16] {
-            _memory.set_byte(--_registers.stack_pointer, _registers.accumulator);
-            _memory.set_byte(--_registers.stack_pointer, _registers.flag);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // OR 11110110 n
-        _instruction_map['\xF6'] = [this, cycle = 8] {
-            const auto output = _alu.or_byte(_registers.accumulator, _memory.get_byte(_registers.program_counter++));
-            _registers.accumulator = output.result;
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 11111000
-        _instruction_map['\xF8'] = [this, cycle = 12] {
-            const sbyte offset = _memory.get_byte(_registers.program_counter++);
-            const auto output = _alu.add(_registers.stack_pointer, offset);
-            _registers.general_hl = output.result;
-            _registers.flag[flag_type::zero] = false;
-            _registers.flag.assign<false, true, true, true>(output.status);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 11111001
-        _instruction_map['\xF9'] = [this, cycle = 8] {
-            _registers.stack_pointer = _registers.general_hl;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // LD 11111010 (nn)
-        _instruction_map['\xFA'] = [this, cycle = 16] {
-            const auto low = _memory.get_byte(_registers.program_counter++);
-            const auto high = _memory.get_byte(_registers.program_counter++);
-            const auto address = make_address(high, low);
-            _registers.accumulator = _memory.get_byte(address);
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
-
-        // CP 11111110 n
-        _instruction_map['\xFE'] = [this, cycle = 8] {
-            const auto output = _alu.subtract(_registers.accumulator, _memory.get_byte(_registers.program_counter++));
-            _registers.flag = output.status;
-            _cycle = (_cycle + cycle) % CYCLES_PER_FRAME;
-        };
     }
 
-    void cpu::fetch_and_execute()
+    const registers& cpu::get_registers() const
     {
-        const auto opcode = _memory.get_byte(_registers.program_counter++);
+        return _registers;
+    }
+
+    void cpu::enable_block_cache(bool enabled)
+    {
+        _block_cache_enabled = enabled;
+    }
+
+    const block_cache& cpu::get_block_cache() const
+    {
+        return _block_cache;
+    }
+
+    int cpu::step_block()
+    {
+        return run_block(find_block());
+    }
+
+    void cpu::enable_fusion(bool enabled)
+    {
+        // blocks decoded the other way have to go
+        if (enabled != _fusion_enabled) {
+            _block_cache.clear();
+        }
+        _fusion_enabled = enabled;
+    }
+
+    int cpu::get_fused_sequences() const
+    {
+        return _fused_sequences;
+    }
+
+    void cpu::enable_idle_skipping(bool enabled)
+    {
+        _idle_skipping = enabled;
+    }
+
+    unsigned long long cpu::get_skipped_cycles() const
+    {
+        return _skipped_cycles;
+    }
+
+    const cpu::opcode_info& cpu::get_opcode_info(byte opcode)
+    {
+        return _opcode_info[opcode];
+    }
+
+    const cpu::opcode_info& cpu::get_prefixed_info(byte opcode)
+    {
+        return _prefixed_info[opcode];
+    }
+
+    void cpu::load_recompiled(const recompiled_block* blocks, std::size_t count)
+    {
+        _recompiled.assign(0x10000, nullptr);
+        for (std::size_t index = 0; index < count; ++index) {
+            const auto& loaded = blocks[index];
+            _recompiled[loaded.address] = &loaded;
+            // the pages are watched like decoded code, and their versions now are the ones the blocks match
+            _memory.mark_code(loaded.first_page);
+            _memory.mark_code(loaded.last_page);
+            if (loaded.first_page == memory::IO_PAGE || loaded.last_page == memory::IO_PAGE) {
+                _memory.mark_register_code();
+            }
+        }
+
+        for (auto page = 0; page < memory::PAGE_COUNT; ++page) {
+            _recompiled_versions[page] = _memory.get_page_version(page);
+        }
+    }
+
+    int cpu::get_recompiled_runs() const
+    {
+        return _recompiled_runs;
+    }
+
+    unsigned int cpu::get_code_writes() const
+    {
+        return _memory.get_code_writes();
+    }
+
+#ifdef GAMEBOY_JIT
+    void cpu::enable_jit(bool enabled)
+    {
+        _jit_enabled = enabled;
+        _block_cache_enabled |= enabled;
+    }
+
+    const jit& cpu::get_jit() const
+    {
+        return _jit;
+    }
+#endif
+
+    const std::array<cpu::instruction, 256> cpu::_instruction_table =
+        cpu::make_instruction_table(std::make_integer_sequence<int, 256>{});
+
+    const std::array<cpu::instruction, 256> cpu::_prefixed_table =
+        cpu::make_prefixed_table(std::make_integer_sequence<int, 256>{});
+
+    const std::array<cpu::opcode_info, 256> cpu::_opcode_info =
+        cpu::make_opcode_info(std::make_integer_sequence<int, 256>{});
+
+    const std::array<cpu::opcode_info, 256> cpu::_prefixed_info =
+        cpu::make_prefixed_info(std::make_integer_sequence<int, 256>{});
+
+    // the most frequent sequences gameboy-ngrams finds in game traces: polling loops on an I/O register, memory
+    // copies and counted loops
+    const std::array<cpu::fusion, 9> cpu::_fusions = {{
+        {{{0xF0, 0xFE, 0x20}}, 3, &cpu::invoke_fused<0xF0, 0xFE, 0x20>},     // LDH A, (n); CP n; JR NZ
+        {{{0xF0, 0xFE, 0x28}}, 3, &cpu::invoke_fused<0xF0, 0xFE, 0x28>},     // LDH A, (n); CP n; JR Z
+        {{{0xF0, 0xE6, 0x20}}, 3, &cpu::invoke_fused<0xF0, 0xE6, 0x20>},     // LDH A, (n); AND n; JR NZ
+        {{{0xF0, 0xE6, 0x28}}, 3, &cpu::invoke_fused<0xF0, 0xE6, 0x28>},     // LDH A, (n); AND n; JR Z
+        {{{0x2A, 0x12, 0x13}}, 3, &cpu::invoke_fused<0x2A, 0x12, 0x13>},     // LD A, (HL+); LD (DE), A; INC DE
+        {{{0x1A, 0x22, 0x13}}, 3, &cpu::invoke_fused<0x1A, 0x22, 0x13>},     // LD A, (DE); LD (HL+), A; INC DE
+        {{{0x05, 0x20}}, 2, &cpu::invoke_fused<0x05, 0x20>},                 // DEC B; JR NZ
+        {{{0x0D, 0x20}}, 2, &cpu::invoke_fused<0x0D, 0x20>},                 // DEC C; JR NZ
+        {{{0x0B, 0x78, 0xB1, 0x20}}, 4, &cpu::invoke_fused<0x0B, 0x78, 0xB1, 0x20>}  // DEC BC; LD A, B; OR C; JR NZ
+    }};
+
+#ifdef GAMEBOY_SWITCH_DISPATCH
+    // lets the compiler inline every handler behind a single jump table
+    #define GAMEBOY_CASE(handler, n) case (n): return handler<(n)>();
+    #define GAMEBOY_CASE_4(handler, n) GAMEBOY_CASE(handler, n) GAMEBOY_CASE(handler, n + 1) \
+        GAMEBOY_CASE(handler, n + 2) GAMEBOY_CASE(handler, n + 3)
+    #define GAMEBOY_CASE_16(handler, n) GAMEBOY_CASE_4(handler, n) GAMEBOY_CASE_4(handler, n + 4) \
+        GAMEBOY_CASE_4(handler, n + 8) GAMEBOY_CASE_4(handler, n + 12)
+    #define GAMEBOY_CASE_64(handler, n) GAMEBOY_CASE_16(handler, n) GAMEBOY_CASE_16(handler, n + 16) \
+        GAMEBOY_CASE_16(handler, n + 32) GAMEBOY_CASE_16(handler, n + 48)
+    #define GAMEBOY_CASE_256(handler) GAMEBOY_CASE_64(handler, 0x00) GAMEBOY_CASE_64(handler, 0x40) \
+        GAMEBOY_CASE_64(handler, 0x80) GAMEBOY_CASE_64(handler, 0xC0)
+#endif
+
+    int cpu::step()
+    {
+        const auto opcode = fetch_byte();
+        switch (_opcode_info[opcode].length) {
+        case 3:
+            _operand = fetch_word();
+            break;
+        case 2:
+            _operand = fetch_byte();
+            break;
+        }
+
+#ifdef GAMEBOY_SWITCH_DISPATCH
+        switch (opcode) {
+            GAMEBOY_CASE_256(execute)
+        }
+
+        return 0;
+#else
+        return _instruction_table[opcode](*this);
+#endif
+    }
 
-        _instruction_map[opcode]();
+    int cpu::step_prefixed()
+    {
+        const auto opcode = immediate_byte();
+#ifdef GAMEBOY_SWITCH_DISPATCH
+        switch (opcode) {
+            GAMEBOY_CASE_256(execute_prefixed)
+        }
+
+        return 0;
+#else
+        return _prefixed_table[opcode](*this);
+#endif
+    }
+
+#ifdef GAMEBOY_SWITCH_DISPATCH
+    #undef GAMEBOY_CASE_256
+    #undef GAMEBOY_CASE_64
+    #undef GAMEBOY_CASE_16
+    #undef GAMEBOY_CASE_4
+    #undef GAMEBOY_CASE
+#endif
+
+    bool cpu::fetch_and_execute()
+    {
+        auto& events = _memory.get_scheduler();
+        const auto time = _frame_start + static_cast<unsigned long long>(_cycle);
+        // a HALT sleeps until the next event or the end of the frame
+        _run_end = _frame_start + CYCLES_PER_FRAME;
+        auto cycles = time >= events.get_next() ? service_events(time) : 0;
+        const auto executed = cycles == 0;
+        if (executed) {
+            events.set_now(time);
+            cycles = step();
+        }
+
+        _cycle += cycles;
+        if (_cycle >= CYCLES_PER_FRAME) {
+            _cycle -= CYCLES_PER_FRAME;
+            _frame_start += CYCLES_PER_FRAME;
+        }
+
+        return executed;
+    }
+
+    int cpu::service_events(unsigned long long time)
+    {
+        auto& events = _memory.get_scheduler();
+        events.set_now(time);
+        events.run_due();
+        if (time >= _enable_at) {
+            _interrupts_enabled = true;
+            _enable_at = scheduler::NEVER;
+        }
+        if (!_interrupts_enabled) {
+            return 0;
+        }
+
+        const auto requested = _memory.get_byte(memory::INTERRUPT_FLAG);
+        const auto pending = requested & _memory.get_byte(memory::INTERRUPT_ENABLE) & 0x1F;
+        if (pending == 0) {
+            return 0;
+        }
+
+        // the lowest bit has the highest priority, and each one has its vector 8 bytes after the previous one's
+        auto index = 0;
+        while ((pending >> index & 1) == 0) {
+            ++index;
+        }
+        _interrupts_enabled = false;
+        _memory.set_byte(memory::INTERRUPT_FLAG, static_cast<byte>(requested & ~(1 << index)));
+        // the interrupt returns past a HALT it woke up
+        _registers.program_counter = static_cast<unsigned short>(_registers.program_counter + _halted);
+        _halted = 0;
+        push(_registers.program_counter);
+        _registers.program_counter = static_cast<unsigned short>(0x40 + 8 * index);
+        return 20;
+    }
+
+    block& cpu::decode_block(unsigned short address)
+    {
+        auto& target = _block_cache.allocate(address);
+        auto program_counter = address;
+        auto elapsed = 0;
+        for (;;) {
+            const auto opcode = _memory.get_byte(program_counter);
+            const auto& info = _opcode_info[opcode];
+            decoded_instruction decoded{_instruction_table[opcode], opcode, 0, 0, 0, 0};
+            if (info.length == 2) {
+                decoded.operand = _memory.get_byte((program_counter + 1) & 0xFFFF);
+            }
+            else if (info.length == 3) {
+                decoded.operand = static_cast<unsigned short>(make_address(_memory.get_byte((program_counter + 2) & 0xFFFF),
+                    _memory.get_byte((program_counter + 1) & 0xFFFF)));
+            }
+
+            // CB instructions go straight to their handler on the second page
+            auto cycles = static_cast<int>(info.duration);
+            if (decode(opcode) == operation::prefix) {
+                decoded.handler = _prefixed_table[decoded.operand];
+                cycles = _prefixed_info[decoded.operand].duration;
+            }
+
+            decoded.next = static_cast<unsigned short>(program_counter + info.length);
+            target.cycles = elapsed;
+            elapsed += cycles;
+            decoded.elapsed = elapsed;
+            target.instructions.push_back(decoded);
+
+            // stop at the page boundary so that a block never spans more than two pages
+            if (info.ends_block || target.instructions.size() == BLOCK_LIMIT
+                || decoded.next / memory::PAGE_SIZE != address / memory::PAGE_SIZE) {
+                target.first_page = address / memory::PAGE_SIZE;
+                target.last_page = ((decoded.next - 1) & 0xFFFF) / memory::PAGE_SIZE;
+                break;
+            }
+
+            program_counter = decoded.next;
+        }
+
+        const auto& last = target.instructions.back();
+        const auto relative = static_cast<unsigned short>(last.next + static_cast<sbyte>(last.operand));
+        const auto loops = last.opcode == 0x18 || (last.opcode & 0xE7) == 0x20 ? relative == address
+            : last.opcode == 0xC3 || (last.opcode & 0xE7) == 0xC2 ? last.operand == address
+            : false;
+        target.idle = loops && std::none_of(target.instructions.begin(), target.instructions.end() - 1,
+            [](const decoded_instruction& decoded) {
+                return decoded.opcode == 0xCB ? _prefixed_info[decoded.operand].writes : _opcode_info[decoded.opcode].writes;
+            });
+
+        // the JIT translates the instructions on their own rather than calling fused handlers
+#ifdef GAMEBOY_JIT
+        if (_fusion_enabled && !_jit_enabled) {
+#else
+        if (_fusion_enabled) {
+#endif
+            fuse(target);
+        }
+
+        _block_cache.seal(target);
+        return target;
+    }
+
+    void cpu::fuse(block& target)
+    {
+        auto& instructions = target.instructions;
+        std::size_t kept = 0;
+        for (std::size_t index = 0; index < instructions.size(); ++kept) {
+            instructions[kept] = instructions[index];
+            for (const auto& candidate : _fusions) {
+                if (index + candidate.length > instructions.size()) {
+                    continue;
+                }
+
+                auto matches = true;
+                for (std::size_t part = 0; part < candidate.length && matches; ++part) {
+                    matches = instructions[index + part].opcode == candidate.opcodes[part];
+                }
+                if (!matches) {
+                    continue;
+                }
+
+                auto operands = 0u;
+                auto shift = 0;
+                for (std::size_t part = 0; part < candidate.length; ++part) {
+                    const auto& folded = instructions[index + part];
+                    operands |= folded.operand << shift;
+                    shift += 8 * (_opcode_info[folded.opcode].length - 1);
+                }
+                const auto& last = instructions[index + candidate.length - 1];
+                auto& fused = instructions[kept];
+                fused.operand = operands;
+                fused.handler = candidate.handler;
+                fused.fused = static_cast<byte>(candidate.length - 1);
+                fused.next = last.next;
+                fused.elapsed = last.elapsed;
+                index += candidate.length - 1;
+                ++_fused_sequences;
+                break;
+            }
+            ++index;
+        }
+        instructions.resize(kept);
+    }
+
+    block& cpu::find_block()
+    {
+        const auto current = _block_cache.find(_registers.program_counter);
+        return current != nullptr ? *current : decode_block(_registers.program_counter);
+    }
+
+    int cpu::run_block(block& current)
+    {
+#ifdef GAMEBOY_JIT
+        if (_jit_enabled) {
+            return run_native(current);
+        }
+#endif
+
+        auto& events = _memory.get_scheduler();
+        const auto start = events.get_now();
+        const auto code_writes = _memory.get_code_writes();
+        const auto last = current.instructions.data() + current.instructions.size() - 1;
+        // only the last instruction can read PC, so the ones before it do not need it kept up to date
+        for (auto decoded = current.instructions.data(); decoded != last; ++decoded) {
+            _operand = decoded->operand;
+            decoded->handler(*this);
+            // the block wrote into code, possibly its own, so whatever follows has to be decoded again; or an
+            // event now comes due before the block ends
+            if (_memory.get_code_writes() != code_writes) {
+                // a fused sequence stops right after the write, before the rest of it
+                _registers.program_counter = static_cast<unsigned short>(decoded->next - _fused_cut_length);
+                const auto elapsed = decoded->elapsed - _fused_cut_cycles;
+                _fused_cut_length = 0;
+                _fused_cut_cycles = 0;
+                return elapsed;
+            }
+            events.set_now(start + static_cast<unsigned long long>(decoded->elapsed));
+        }
+
+        // a fused last entry reports the cycles of its whole sequence, which block.cycles partly covers already
+        const auto before = last == current.instructions.data() ? 0 : (last - 1)->elapsed;
+        _registers.program_counter = last->next;
+        _operand = last->operand;
+        const auto cycles = last->handler(*this);
+        // a fused last entry cut short by a code write only counts the cycles it ran, but still has to go back to
+        // the rest of its sequence
+        _registers.program_counter = static_cast<unsigned short>(_registers.program_counter - _fused_cut_length);
+        _fused_cut_length = 0;
+        _fused_cut_cycles = 0;
+        return before + cycles;
+    }
+
+    int cpu::step_within(int remaining)
+    {
+        auto& current = find_block();
+        // a whole block only runs when the interpreter would not have stopped inside it
+        if (current.cycles >= remaining) {
+            return step();
+        }
+
+        return current.idle && _idle_skipping ? run_idle(current, remaining) : run_block(current);
+    }
+
+    int cpu::run_idle(block& current, int remaining)
+    {
+        auto& events = _memory.get_scheduler();
+        const auto start = events.get_now();
+        const auto before = _registers;
+        const auto code_writes = _memory.get_code_writes();
+        const auto timed_reads = _memory.get_timed_reads();
+        const auto cycles = run_block(current);
+        const auto& after = _registers;
+        if (after.program_counter != current.address || after.accumulator != before.accumulator
+            || static_cast<byte>(after.flag) != static_cast<byte>(before.flag)
+            || after.general_bc.value != before.general_bc.value || after.general_de.value != before.general_de.value
+            || after.general_hl.value != before.general_hl.value || after.stack_pointer != before.stack_pointer
+            || _memory.get_code_writes() != code_writes || _memory.get_timed_reads() != timed_reads) {
+            return cycles;
+        }
+
+        // nothing the pass read can change before the next event, so every pass until then is this one again;
+        // the loop in run_until() would run another while the block still ends before remaining
+        const auto left = remaining - cycles;
+        if (left <= current.cycles) {
+            return cycles;
+        }
+
+        const auto skipped = (left - current.cycles + cycles - 1) / cycles * cycles;
+        _skipped_cycles += static_cast<unsigned long long>(skipped);
+        // the last instruction of the last pass is the one that started last
+        events.set_now(start + static_cast<unsigned long long>(skipped + current.cycles));
+        return cycles + skipped;
+    }
+
+#ifdef GAMEBOY_JIT
+    int cpu::run_native(block& current)
+    {
+        if (current.native_generation != _jit.get_generation()) {
+            // a translation into a buffer recycled since is gone, and the block has to get hot again
+            if (current.native != nullptr) {
+                current.native = nullptr;
+                current.executions = 0;
+            }
+            if (current.executions < jit::THRESHOLD && ++current.executions == jit::THRESHOLD) {
+                const auto rewritten = current.translations > 0
+                    && (current.translated_first_version != current.first_version
+                        || current.translated_last_version != current.last_version);
+                // code that keeps being rewritten would only be translated over and over again
+                if (!rewritten || current.retranslations < jit::REWRITE_LIMIT) {
+                    current.native = _jit.compile(current, &cpu::interpret);
+                    current.native_generation = _jit.get_generation();
+                    ++current.translations;
+                    current.retranslations += rewritten;
+                    current.translated_first_version = current.first_version;
+                    current.translated_last_version = current.last_version;
+                }
+            }
+        }
+
+        if (current.native == nullptr || current.native_generation != _jit.get_generation()) {
+            const auto enabled = _jit_enabled;
+            _jit_enabled = false;
+            const auto cycles = run_block(current);
+            _jit_enabled = enabled;
+            return cycles;
+        }
+
+        _native_start = _memory.get_scheduler().get_now();
+        auto state = save_state();
+        const auto cycles = current.native(&state, this);
+        load_state(state);
+        // translated instructions do not publish when they start, so catch up with the last one when the block ran
+        // to its end rather than stopping after a write
+        if (cycles > current.cycles) {
+            _memory.get_scheduler().set_now(_native_start + static_cast<unsigned long long>(current.cycles));
+        }
+        return cycles;
+    }
+
+    int cpu::interpret(cpu* target, jit_state* state, const decoded_instruction* decoded)
+    {
+        target->load_state(*state);
+        target->_registers.program_counter = decoded->next;
+        target->_operand = decoded->operand;
+        const auto& info = decoded->opcode == 0xCB ? _prefixed_info[decoded->operand & 0xFF] : _opcode_info[decoded->opcode];
+        target->_memory.get_scheduler().set_now(target->_native_start
+            + static_cast<unsigned long long>(decoded->elapsed - info.duration));
+        const auto code_writes = target->_memory.get_code_writes();
+        const auto cycles = decoded->handler(*target);
+        *state = target->save_state();
+        state->rewritten = target->_memory.get_code_writes() != code_writes;
+        return cycles;
+    }
+
+    jit_state cpu::save_state() const
+    {
+        return {_registers.accumulator, static_cast<byte>(_registers.flag),
+            _registers.general_bc.bytes.high, _registers.general_bc.bytes.low,
+            _registers.general_de.bytes.high, _registers.general_de.bytes.low,
+            _registers.general_hl.bytes.high, _registers.general_hl.bytes.low,
+            _registers.stack_pointer, _registers.program_counter, false};
+    }
+
+    void cpu::load_state(const jit_state& state)
+    {
+        _registers.accumulator = state.accumulator;
+        _registers.flag = state.flag;
+        _registers.general_bc.bytes.high = state.general_b;
+        _registers.general_bc.bytes.low = state.general_c;
+        _registers.general_de.bytes.high = state.general_d;
+        _registers.general_de.bytes.low = state.general_e;
+        _registers.general_hl.bytes.high = state.general_h;
+        _registers.general_hl.bytes.low = state.general_l;
+        _registers.stack_pointer = state.stack_pointer;
+        _registers.program_counter = state.program_counter;
+    }
+#endif
+
+    int cpu::run_until(int cycle_budget)
+    {
+        // handlers never touch _cycle, so the clock can live in a register for the whole run; the one comparison
+        // against the next event covers every device, and a block only runs whole when it ends before that event
+        auto& events = _memory.get_scheduler();
+        const auto end = _frame_start + static_cast<unsigned long long>(std::max(cycle_budget, 0));
+        auto time = _frame_start + static_cast<unsigned long long>(_cycle);
+        _run_end = end;
+        if (!_recompiled.empty()) {
+            while (time < end) {
+                const auto next = events.get_next();
+                if (time >= next) {
+                    time += static_cast<unsigned long long>(service_events(time));
+                    continue;
+                }
+
+                events.set_now(time);
+                const auto limit = std::min(end, next);
+                const auto recompiled = _recompiled[_registers.program_counter];
+                if (recompiled != nullptr && time + static_cast<unsigned long long>(recompiled->cycles) < limit
+                    && _memory.get_page_version(recompiled->first_page) == _recompiled_versions[recompiled->first_page]
+                    && _memory.get_page_version(recompiled->last_page) == _recompiled_versions[recompiled->last_page]
+                    && _memory.get_page_bank(recompiled->first_page) == recompiled->first_bank
+                    && _memory.get_page_bank(recompiled->last_page) == recompiled->last_bank) {
+                    time += static_cast<unsigned long long>(recompiled->run(*this));
+                    ++_recompiled_runs;
+                }
+                else if (_block_cache_enabled) {
+                    time += static_cast<unsigned long long>(step_within(static_cast<int>(limit - time)));
+                }
+                else {
+                    time += static_cast<unsigned long long>(step());
+                }
+            }
+        }
+        else if (_block_cache_enabled) {
+            while (time < end) {
+                const auto next = events.get_next();
+                if (time >= next) {
+                    time += static_cast<unsigned long long>(service_events(time));
+                    continue;
+                }
+
+                events.set_now(time);
+                time += static_cast<unsigned long long>(step_within(static_cast<int>(std::min(end, next) - time)));
+            }
+        }
+        else {
+            while (time < end) {
+                if (time >= events.get_next()) {
+                    time += static_cast<unsigned long long>(service_events(time));
+                    continue;
+                }
+
+                events.set_now(time);
+                time += static_cast<unsigned long long>(step());
+            }
+        }
+
+        _cycle = static_cast<int>(time - _frame_start);
+        return _cycle - cycle_budget;
+    }
+
+    int cpu::run_frame()
+    {
+        const auto overshoot = run_until(CYCLES_PER_FRAME);
+        _cycle = overshoot;
+        _frame_start += CYCLES_PER_FRAME;
+        return overshoot;
     }
-}
\ No newline at end of file
+}
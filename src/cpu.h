@@ -1,26 +1,383 @@
 #ifndef CPU_H
 #define CPU_H
 
-#include <functional>
-#include <unordered_map>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
 #include "registers.h"
 #include "memory.h"
+#include "ppu.h"
 #include "byte.h"
 #include "alu.h"
+#ifdef GAMEBOY_ALU_TABLES
+#include "alu-table.h"
+#endif
+#include "block-cache.h"
+#include "recompiled.h"
+#ifdef GAMEBOY_JIT
+#include "jit.h"
+#endif
 
 namespace gameboy {
     class cpu {
     public:
+        // the LCD's, from one VBlank to the next
+        static constexpr auto CYCLES_PER_FRAME = ppu::FRAME_CYCLES;
+
+        // static properties of an opcode, looked up by the fetch, the block decoder and the static recompiler
+        struct opcode_info {
+            // bytes including the opcode
+            byte length;
+            // cycles when no branch is taken
+            byte duration;
+            // control flow, interrupt state changes and anything that throws end a block
+            bool ends_block;
+            // stores, read-modify-writes of (HL), pushes and calls; for 0xCB it is up to the prefixed opcode
+            bool writes;
+        };
+
+        static const opcode_info& get_opcode_info(byte opcode);
+        // CB opcodes, with the cycles of the whole instruction
+        static const opcode_info& get_prefixed_info(byte opcode);
+
         cpu(memory& mem);
-        void fetch_and_execute();
+        // runs one instruction, or takes an interrupt instead and returns false
+        bool fetch_and_execute();
+        // runs until the frame cycle counter reaches cycle_budget and returns the overshoot; the events in the
+        // memory's scheduler run as they come due, between instructions, and so do interrupts
+        int run_until(int cycle_budget);
+        // runs one whole frame, carrying the overshoot into the next one
+        int run_frame();
+        const registers& get_registers() const;
+        // run_until() executes whole pre-decoded blocks instead of single instructions while enabled
+        void enable_block_cache(bool enabled);
+        const block_cache& get_block_cache() const;
+        // runs exactly one block and returns its cycles, leaving the frame cycle counter and the events alone;
+        // the interpreter can then be brought to the same point with run_until() to compare the two
+        int step_block();
+#ifdef GAMEBOY_JIT
+        // translates hot blocks to native code; works on top of the block cache, which it turns on
+        void enable_jit(bool enabled);
+        const jit& get_jit() const;
+#endif
+        // a block that jumps back to its own start, writes nothing and comes round to the same registers without
+        // reading a timed register can only be waiting for an event; run_until() then moves time on to where the
+        // passes before that event would have ended instead of running them. Needs the block cache; on by default
+        void enable_idle_skipping(bool enabled);
+        // cycles moved over that way, which count as run everywhere else
+        unsigned long long get_skipped_cycles() const;
+        // the block decoder replaces common instruction sequences with single fused handlers while enabled
+        void enable_fusion(bool enabled);
+        // sequences fused into the blocks decoded so far
+        int get_fused_sequences() const;
+        // run_until() calls blocks translated ahead of time whenever PC lands on one, and falls back to the
+        // interpreter everywhere else or once their pages have been written to
+        void load_recompiled(const recompiled_block* blocks, std::size_t count);
+        int get_recompiled_runs() const;
+        // one instruction of a recompiled block, with its operand and the address after it known up front;
+        // defined in cpu-handlers.h
+        template<int Opcode>
+        int run_static(unsigned short operand, unsigned short next);
+        template<int Opcode>
+        int run_static_prefixed(unsigned short next);
+        // what recompiled blocks compare to stop right after an instruction that wrote into code or moved an
+        // event ahead, the same place run_block() would have stopped
+        unsigned int get_code_writes() const;
     private:
-        static constexpr auto CYCLES_PER_FRAME = 70244;
+        // every handler returns the number of cycles it took
+        using instruction = int (*)(cpu&);
+
+        // instruction families an opcode decodes into; each one is a single handler template
+        enum class operation {
+            invalid,
+            no_operation,
+            load,
+            load_immediate,
+            load_indirect,
+            store_indirect,
+            load_high,
+            store_high,
+            load_absolute,
+            store_absolute,
+            load_pair_immediate,
+            store_stack_pointer,
+            load_stack_pointer,
+            load_stack_offset,
+            increment,
+            decrement,
+            increment_pair,
+            decrement_pair,
+            add_pair,
+            add_stack_offset,
+            arithmetic,
+            arithmetic_immediate,
+            rotate_accumulator,
+            decimal_adjust,
+            complement,
+            set_carry,
+            complement_carry,
+            jump,
+            jump_relative,
+            jump_hl,
+            call,
+            return_from_call,
+            return_from_interrupt,
+            restart,
+            push,
+            pop,
+            interrupt_enable,
+            halt,
+            prefix,
+            // 0xCB page
+            rotate_shift,
+            test_bit,
+            reset_bit,
+            set_bit
+        };
+
+        template<operation Operation>
+        using family = std::integral_constant<operation, Operation>;
+
+        // operand index 6 in the r[] encoding is (HL) rather than a register
+        static constexpr auto INDIRECT = 6;
+        // condition index used by the unconditional JR/JP/CALL/RET forms
+        static constexpr auto ALWAYS = 4;
+
+        static const std::array<instruction, 256> _instruction_table;
+        // second page behind 0xCB, indexed by the byte after the prefix
+        static const std::array<instruction, 256> _prefixed_table;
+        static const std::array<opcode_info, 256> _opcode_info;
+        static const std::array<opcode_info, 256> _prefixed_info;
+        // longest block the decoder produces
+        static constexpr auto BLOCK_LIMIT = 64;
+
+        static constexpr operation decode(int opcode);
+        static constexpr operation decode_prefixed(int opcode);
+        static constexpr int length(int opcode);
+        static constexpr int duration(int opcode);
+        static constexpr int duration_prefixed(int opcode);
+        static constexpr bool ends_block(int opcode);
+        static constexpr bool writes(int opcode);
+        static constexpr bool writes_prefixed(int opcode);
+
+        int step();
+        int step_prefixed();
+        // runs the events due by time and takes an interrupt if one is pending, returning the cycles that took
+        int service_events(unsigned long long time);
+        block& decode_block(unsigned short address);
+        block& find_block();
+        int run_block(block& current);
+        // run_block() on an idle candidate, adding the passes that would follow it up to remaining
+        int run_idle(block& current, int remaining);
+        // one block through the cache if it ends before remaining runs out, otherwise one instruction
+        int step_within(int remaining);
+#ifdef GAMEBOY_JIT
+        int run_native(block& current);
+        // called from translated code for the instructions it leaves to the handlers
+        static int interpret(cpu* target, jit_state* state, const decoded_instruction* decoded);
+        jit_state save_state() const;
+        void load_state(const jit_state& state);
+#endif
+
+        byte fetch_byte();
+        unsigned short fetch_word();
+        // the immediate operand, read before the handler runs
+        byte immediate_byte() const;
+        unsigned short immediate_word() const;
+        void push(unsigned short value);
+        unsigned short pop();
+
+        // operands in the order of the opcode encoding: B, C, D, E, H, L, (HL), A and BC, DE, HL, SP
+        template<int Index>
+        byte& register8();
+        template<int Index>
+        byte read();
+        template<int Index>
+        void write(byte value);
+        template<int Pair>
+        unsigned short& register16();
+        template<int Pair>
+        unsigned short indirect_address();
+        // NZ, Z, NC, C, or ALWAYS
+        template<int Condition>
+        bool condition() const;
+
+        // 8-bit arithmetic setting the flags it affects, only recorded for later when GAMEBOY_LAZY_FLAGS is set
+        byte add_byte(byte operand1, byte operand2, bool carry = false);
+        byte subtract_byte(byte operand1, byte operand2, bool carry = false);
+        byte increment_byte(byte operand);
+        byte decrement_byte(byte operand);
+        // ADD, ADC, SUB, SBC, AND, XOR, OR, CP on the accumulator
+        template<int Operation>
+        void accumulate(byte operand);
+        flags offset_stack_pointer(byte offset);
+        // RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL
+        template<int Operation>
+        byte rotate_shift(byte operand);
+
+        template<int Opcode>
+        int execute();
+
+        template<int Opcode> int execute(family<operation::invalid>);
+        template<int Opcode> int execute(family<operation::no_operation>);
+        template<int Opcode> int execute(family<operation::load>);
+        template<int Opcode> int execute(family<operation::load_immediate>);
+        template<int Opcode> int execute(family<operation::load_indirect>);
+        template<int Opcode> int execute(family<operation::store_indirect>);
+        template<int Opcode> int execute(family<operation::load_high>);
+        template<int Opcode> int execute(family<operation::store_high>);
+        template<int Opcode> int execute(family<operation::load_absolute>);
+        template<int Opcode> int execute(family<operation::store_absolute>);
+        template<int Opcode> int execute(family<operation::load_pair_immediate>);
+        template<int Opcode> int execute(family<operation::store_stack_pointer>);
+        template<int Opcode> int execute(family<operation::load_stack_pointer>);
+        template<int Opcode> int execute(family<operation::load_stack_offset>);
+        template<int Opcode> int execute(family<operation::increment>);
+        template<int Opcode> int execute(family<operation::decrement>);
+        template<int Opcode> int execute(family<operation::increment_pair>);
+        template<int Opcode> int execute(family<operation::decrement_pair>);
+        template<int Opcode> int execute(family<operation::add_pair>);
+        template<int Opcode> int execute(family<operation::add_stack_offset>);
+        template<int Opcode> int execute(family<operation::arithmetic>);
+        template<int Opcode> int execute(family<operation::arithmetic_immediate>);
+        template<int Opcode> int execute(family<operation::rotate_accumulator>);
+        template<int Opcode> int execute(family<operation::decimal_adjust>);
+        template<int Opcode> int execute(family<operation::complement>);
+        template<int Opcode> int execute(family<operation::set_carry>);
+        template<int Opcode> int execute(family<operation::complement_carry>);
+        template<int Opcode> int execute(family<operation::jump>);
+        template<int Opcode> int execute(family<operation::jump_relative>);
+        template<int Opcode> int execute(family<operation::jump_hl>);
+        template<int Opcode> int execute(family<operation::call>);
+        template<int Opcode> int execute(family<operation::return_from_call>);
+        template<int Opcode> int execute(family<operation::return_from_interrupt>);
+        template<int Opcode> int execute(family<operation::restart>);
+        template<int Opcode> int execute(family<operation::push>);
+        template<int Opcode> int execute(family<operation::pop>);
+        template<int Opcode> int execute(family<operation::interrupt_enable>);
+        template<int Opcode> int execute(family<operation::halt>);
+        template<int Opcode> int execute(family<operation::prefix>);
+
+        // handlers for the 0xCB page return the cycles of the whole instruction, prefix included
+        template<int Opcode>
+        int execute_prefixed();
+
+        // a fused sequence: the instructions run one after the other, and stop right after one that writes into
+        // code, the same place run_block() would have stopped
+        template<int... Opcodes>
+        int execute_fused();
+        template<int Opcode>
+        int execute_fused(unsigned int operands, unsigned int code_writes);
+        template<int Opcode, int Next, int... Rest>
+        int execute_fused(unsigned int operands, unsigned int code_writes);
+        template<int... Opcodes>
+        static constexpr int fused_length();
+        template<int... Opcodes>
+        static constexpr int fused_duration();
+
+        template<int Opcode> int execute_prefixed(family<operation::rotate_shift>);
+        template<int Opcode> int execute_prefixed(family<operation::test_bit>);
+        template<int Opcode> int execute_prefixed(family<operation::reset_bit>);
+        template<int Opcode> int execute_prefixed(family<operation::set_bit>);
+
+        template<int Opcode>
+        static int invoke(cpu& target)
+        {
+            return target.execute<Opcode>();
+        }
+
+        template<int Opcode>
+        static int invoke_prefixed(cpu& target)
+        {
+            return target.execute_prefixed<Opcode>();
+        }
+
+        template<int... Opcodes>
+        static int invoke_fused(cpu& target)
+        {
+            return target.execute_fused<Opcodes...>();
+        }
+
+        // a sequence the block decoder fuses, with up to four operand bytes between its instructions; only the
+        // last instruction may branch, and then nothing before it may write memory
+        struct fusion {
+            std::array<byte, 4> opcodes;
+            std::size_t length;
+            instruction handler;
+        };
+
+        static const std::array<fusion, 9> _fusions;
+
+        // folds the sequences in _fusions in target, keeping each one's next and elapsed from its last instruction
+        void fuse(block& target);
+
+        template<int... Opcodes>
+        static std::array<instruction, 256> make_instruction_table(std::integer_sequence<int, Opcodes...>)
+        {
+            return {{&invoke<Opcodes>...}};
+        }
+
+        template<int... Opcodes>
+        static std::array<instruction, 256> make_prefixed_table(std::integer_sequence<int, Opcodes...>)
+        {
+            return {{&invoke_prefixed<Opcodes>...}};
+        }
+
+        template<int... Opcodes>
+        static std::array<opcode_info, 256> make_opcode_info(std::integer_sequence<int, Opcodes...>)
+        {
+            return {{opcode_info{static_cast<byte>(length(Opcodes)), static_cast<byte>(duration(Opcodes)), ends_block(Opcodes),
+                writes(Opcodes)}...}};
+        }
+
+        template<int... Opcodes>
+        static std::array<opcode_info, 256> make_prefixed_info(std::integer_sequence<int, Opcodes...>)
+        {
+            return {{opcode_info{byte{2}, static_cast<byte>(duration_prefixed(Opcodes)), false,
+                writes_prefixed(Opcodes)}...}};
+        }
+
         registers _registers;
         memory& _memory;
+#ifdef GAMEBOY_ALU_TABLES
+        alu_table _alu;
+#else
         alu _alu;
+#endif
         int _cycle;
-        std::unordered_map<byte, std::function<void()>> _instruction_map;
+        // cycles since power-on at the start of the current frame
+        unsigned long long _frame_start;
+        bool _interrupts_enabled;
+        // when the interrupts an EI enables take effect, or scheduler::NEVER
+        unsigned long long _enable_at;
+        // length of the HALT or STOP PC is held on, or 0 while running
+        int _halted;
+        // where the current run ends, which a HALT skips ahead to at most
+        unsigned long long _run_end;
+        // a fused sequence has the operands of all its instructions packed in here, a byte at a time
+        unsigned int _operand;
+        block_cache _block_cache;
+        bool _block_cache_enabled;
+        bool _fusion_enabled;
+        bool _idle_skipping;
+        unsigned long long _skipped_cycles;
+        // what a fused sequence that stopped early after writing into code left out
+        int _fused_cut_length;
+        int _fused_cut_cycles;
+        int _fused_sequences;
+        // indexed by address, empty unless blocks were loaded
+        std::vector<const recompiled_block*> _recompiled;
+        std::array<unsigned int, memory::PAGE_COUNT> _recompiled_versions;
+        int _recompiled_runs;
+#ifdef GAMEBOY_JIT
+        jit _jit;
+        bool _jit_enabled;
+        // when the translated block running now started, for the instructions it hands back to publish theirs
+        unsigned long long _native_start;
+#endif
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,50 +1,87 @@
 #ifndef FLAGS_H
 #define FLAGS_H
 
-#include <bitset>
-#include <unordered_map>
 #include "byte.h"
 
 namespace gameboy {
-    enum class flag_type {
-        zero,
-        subtract,
-        half_carry,
-        carry
+    // each enumerator is the bit mask of the flag inside the F register
+    enum class flag_type : byte {
+        zero = 0x80,
+        subtract = 0x40,
+        half_carry = 0x20,
+        carry = 0x10
     };
 
     class flags {
     public:
-        flags();
-        explicit flags(byte value);
-        flags& operator=(byte value);
-        bool operator[](flag_type type) const;
-        std::bitset<8>::reference operator[](flag_type type);
-        operator byte() const;
-
-        template<bool Z, bool N, bool H, bool C>
-        void assign(const flags& value)
-        {
-            if (Z) {
-                _flags.set(_flag_map[flag_type::zero], value[flag_type::zero]);
+        class reference {
+        public:
+            reference& operator=(bool value)
+            {
+                _value = static_cast<byte>(value ? _value | _mask : _value & ~_mask);
+                return *this;
             }
 
-            if (N) {
-                _flags.set(_flag_map[flag_type::subtract], value[flag_type::subtract]);
+            reference& operator=(const reference& other)
+            {
+                return *this = static_cast<bool>(other);
             }
 
-            if (H) {
-                _flags.set(_flag_map[flag_type::half_carry], value[flag_type::half_carry]);
+            operator bool() const
+            {
+                return (_value & _mask) != 0;
             }
-
-            if (C) {
-                _flags.set(_flag_map[flag_type::carry], value[flag_type::carry]);
+        private:
+            friend class flags;
+            reference(byte& value, byte mask) : _value(value), _mask(mask)
+            {
             }
+
+            byte& _value;
+            byte _mask;
+        };
+
+        constexpr flags() : _flags(0)
+        {
+        }
+
+        explicit constexpr flags(byte value) : _flags(value)
+        {
+        }
+
+        flags& operator=(byte value)
+        {
+            _flags = value;
+            return *this;
+        }
+
+        bool operator[](flag_type type) const
+        {
+            return (_flags & static_cast<byte>(type)) != 0;
+        }
+
+        reference operator[](flag_type type)
+        {
+            return reference{_flags, static_cast<byte>(type)};
+        }
+
+        operator byte() const
+        {
+            return _flags;
+        }
+
+        template<bool Z, bool N, bool H, bool C>
+        void assign(const flags& value)
+        {
+            constexpr auto mask = (Z ? static_cast<byte>(flag_type::zero) : 0)
+                | (N ? static_cast<byte>(flag_type::subtract) : 0)
+                | (H ? static_cast<byte>(flag_type::half_carry) : 0)
+                | (C ? static_cast<byte>(flag_type::carry) : 0);
+            _flags = static_cast<byte>((_flags & ~mask) | (value._flags & mask));
         }
     private:
-        static std::unordered_map<flag_type, int> _flag_map;
-        std::bitset<8> _flags;
+        byte _flags;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
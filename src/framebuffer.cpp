@@ -0,0 +1,83 @@
+#include "framebuffer.h"
+#include <cstring>
+
+namespace gameboy {
+    std::size_t framebuffer::get_pixel_size(format type)
+    {
+        return type == format::rgba8888 ? sizeof(std::uint32_t) : sizeof(std::uint16_t);
+    }
+
+    framebuffer::framebuffer(format type, void* first, void* second, const std::array<std::uint32_t, 4>& colours)
+        : _format(type), _buffers{{first, second}}, _recoloured(false), _rgba{}, _rgb565{}, _frames(0)
+    {
+        for (std::size_t shade = 0; shade < colours.size(); ++shade) {
+            _colours[shade].store(colours[shade], std::memory_order_relaxed);
+        }
+        make_pixels();
+    }
+
+    framebuffer::format framebuffer::get_format() const
+    {
+        return _format;
+    }
+
+    const void* framebuffer::get_front() const
+    {
+        return _buffers[(_frames.load(std::memory_order_acquire) + 1) % 2];
+    }
+
+    unsigned long long framebuffer::get_frames() const
+    {
+        // whatever was read from the front buffer before this stays before it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return _frames.load(std::memory_order_acquire);
+    }
+
+    void framebuffer::set_colours(const std::array<std::uint32_t, 4>& colours)
+    {
+        for (std::size_t shade = 0; shade < colours.size(); ++shade) {
+            _colours[shade].store(colours[shade], std::memory_order_relaxed);
+        }
+        _recoloured.store(true, std::memory_order_release);
+    }
+
+    void framebuffer::write_line(int line, const byte* shades)
+    {
+        if (_recoloured.load(std::memory_order_relaxed) && _recoloured.exchange(false, std::memory_order_acquire)) {
+            make_pixels();
+        }
+
+        const auto back = _buffers[_frames.load(std::memory_order_relaxed) % 2];
+        const auto offset = static_cast<std::size_t>(line * WIDTH);
+        if (_format == format::rgba8888) {
+            const auto pixels = static_cast<std::uint32_t*>(back) + offset;
+            for (std::size_t x = 0; x < WIDTH; ++x) {
+                pixels[x] = _rgba[shades[x]];
+            }
+        }
+        else {
+            const auto pixels = static_cast<std::uint16_t*>(back) + offset;
+            for (std::size_t x = 0; x < WIDTH; ++x) {
+                pixels[x] = _rgb565[shades[x]];
+            }
+        }
+    }
+
+    void framebuffer::swap()
+    {
+        _frames.store(_frames.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        // and what is written to the new back buffer after this stays after it
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void framebuffer::make_pixels()
+    {
+        for (std::size_t shade = 0; shade < _colours.size(); ++shade) {
+            const auto colour = _colours[shade].load(std::memory_order_relaxed);
+            const auto red = colour >> 16 & 0xFF, green = colour >> 8 & 0xFF, blue = colour & 0xFF;
+            const byte rgba[] = {static_cast<byte>(red), static_cast<byte>(green), static_cast<byte>(blue), 0xFF};
+            std::memcpy(&_rgba[shade], rgba, sizeof(rgba));
+            _rgb565[shade] = static_cast<std::uint16_t>((red >> 3) << 11 | (green >> 2) << 5 | blue >> 3);
+        }
+    }
+}
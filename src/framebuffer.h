@@ -0,0 +1,67 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "byte.h"
+
+namespace gameboy {
+    // Two buffers of host pixels owned by the caller, which the PPU draws into a line at a time as each one is done:
+    // it only ever writes to the back buffer, and makes it the front one at the end of a frame with a single atomic
+    // store, so a display or encoder thread can take the front one without locking. That thread has until the next
+    // frame is complete to be done with it, and get_frames() tells whether it was.
+    class framebuffer {
+    public:
+        static constexpr auto WIDTH = 160;
+        static constexpr auto HEIGHT = 144;
+
+        enum class format {
+            // bytes R, G, B and A, in that order
+            rgba8888,
+            // 16 bit pixels, red in the top 5 bits and blue in the bottom ones
+            rgb565
+        };
+
+        static std::size_t get_pixel_size(format type);
+
+        // first and second hold WIDTH * HEIGHT pixels each, aligned for them; colours are 0xRRGGBB for the shades
+        // from white to black, the shades being what BGP, OBP0 and OBP1 made of each pixel on its own line
+        framebuffer(format type, void* first, void* second,
+            const std::array<std::uint32_t, 4>& colours = {{0xFFFFFF, 0xAAAAAA, 0x555555, 0x000000}});
+        framebuffer(const framebuffer&) = delete;
+        framebuffer& operator=(const framebuffer&) = delete;
+
+        format get_format() const;
+        // the last frame drawn completely, or the second buffer before there is one
+        const void* get_front() const;
+        // frames completed, the front one being the last; a reader seeing the same count before and after it reads
+        // the front buffer has read it whole
+        unsigned long long get_frames() const;
+
+        // the colours of the shades from the next line written on, from any thread
+        void set_colours(const std::array<std::uint32_t, 4>& colours);
+
+        // line of shades into the back buffer
+        void write_line(int line, const byte* shades);
+        // makes the back buffer the front one
+        void swap();
+    private:
+        // the pixels for _colours
+        void make_pixels();
+
+        format _format;
+        std::array<void*, 2> _buffers;
+        std::array<std::atomic<std::uint32_t>, 4> _colours;
+        // whether _colours changed since the pixels were made from them
+        std::atomic<bool> _recoloured;
+        // the pixel for each shade, as stored
+        std::array<std::uint32_t, 4> _rgba;
+        std::array<std::uint16_t, 4> _rgb565;
+        // the back buffer is the one this picks, the other one being the front
+        std::atomic<unsigned long long> _frames;
+    };
+}
+
+#endif
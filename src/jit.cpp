@@ -0,0 +1,485 @@
+#include "jit.h"
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#include "x86-emitter.h"
+
+namespace gameboy {
+    namespace {
+        using reg = x86_emitter::reg;
+
+        constexpr byte ZERO = 0x80;
+        constexpr byte SUBTRACT = 0x40;
+        constexpr byte HALF_CARRY = 0x20;
+        constexpr byte CARRY = 0x10;
+        constexpr byte ALL_FLAGS = ZERO | SUBTRACT | HALF_CARRY | CARRY;
+
+        // B, C, D, E, H, L, -, A in the SM83 operand encoding; F lives in r15
+        constexpr reg HOST_REGISTERS[] = {
+            reg::r9, reg::r10, reg::r11, reg::r12, reg::r13, reg::r14, reg::rax, reg::r8
+        };
+        constexpr auto FLAG_REGISTER = reg::r15;
+        constexpr auto INDIRECT = 6;
+
+        // ADD, ADC, SUB, SBC, AND, XOR, OR, CP
+        constexpr x86_emitter::operation HOST_OPERATIONS[] = {
+            x86_emitter::add, x86_emitter::adc, x86_emitter::sub, x86_emitter::sbb,
+            x86_emitter::and_, x86_emitter::xor_, x86_emitter::or_, x86_emitter::cmp
+        };
+
+        enum class translation {
+            native, interpreted, unsupported
+        };
+
+        // how an instruction is translated and which flags it reads and writes, for the liveness pass
+        struct effect {
+            translation kind;
+            byte reads;
+            byte writes;
+        };
+
+        // the interpreter's handler runs the instruction. It may leave any flag as it was, so all of them have to
+        // be up to date when it is called; the opcodes that raise an error are not called from translated code
+        // at all, since the exception could not unwind through it
+        effect interpreted(int opcode)
+        {
+            const auto raises = opcode == 0xD3 || opcode == 0xDB || opcode == 0xDD
+                || opcode == 0xE3 || opcode == 0xE4 || opcode == 0xEB || opcode == 0xEC || opcode == 0xED
+                || opcode == 0xF4 || opcode == 0xFC || opcode == 0xFD;
+            return {raises ? translation::unsupported : translation::interpreted, ALL_FLAGS, 0};
+        }
+
+        effect native(byte reads, byte writes)
+        {
+            return {translation::native, reads, writes};
+        }
+
+        effect analyse(const decoded_instruction& decoded)
+        {
+            const auto opcode = decoded.opcode;
+            const auto x = opcode >> 6, y = opcode >> 3 & 7, z = opcode & 7;
+
+            // a fused sequence can stop halfway, which the exits of translated code know nothing about
+            if (decoded.fused != 0) {
+                return {translation::unsupported, ALL_FLAGS, 0};
+            }
+
+            if (opcode == 0xCB) {
+                const auto prefixed = decoded.operand & 0xFF;
+                if ((prefixed & 7) == INDIRECT || prefixed < 0x40) {
+                    return interpreted(opcode);
+                }
+
+                return native(0, static_cast<byte>(prefixed < 0x80 ? ZERO | SUBTRACT | HALF_CARRY : 0));
+            }
+
+            switch (x) {
+            case 0:
+                switch (z) {
+                case 0:
+                    // NOP, JR, JR cc
+                    return y == 0 || y == 3 ? native(0, 0)
+                        : y >= 4 ? native(static_cast<byte>(y < 6 ? ZERO : CARRY), 0)
+                        : interpreted(opcode);
+                case 1:
+                case 3:
+                    // LD rr, nn and INC/DEC rr, but not ADD HL, rr
+                    return z == 3 || (y & 1) == 0 ? native(0, 0) : interpreted(opcode);
+                case 4:
+                case 5:
+                    return y != INDIRECT ? native(0, ZERO | SUBTRACT | HALF_CARRY) : interpreted(opcode);
+                case 6:
+                    return y != INDIRECT ? native(0, 0) : interpreted(opcode);
+                case 7:
+                    // CPL, SCF, CCF
+                    return y == 5 ? native(0, SUBTRACT | HALF_CARRY)
+                        : y == 6 ? native(0, SUBTRACT | HALF_CARRY | CARRY)
+                        : y == 7 ? native(CARRY, SUBTRACT | HALF_CARRY | CARRY)
+                        : interpreted(opcode);
+                default:
+                    return interpreted(opcode);
+                }
+            case 1:
+                return y != INDIRECT && z != INDIRECT ? native(0, 0) : interpreted(opcode);
+            case 2:
+                return z != INDIRECT ? native(static_cast<byte>(y == 1 || y == 3 ? CARRY : 0), ALL_FLAGS)
+                    : interpreted(opcode);
+            default:
+                if (z == 6) {
+                    return native(static_cast<byte>(y == 1 || y == 3 ? CARRY : 0), ALL_FLAGS);
+                }
+
+                // JP nn, JP cc
+                return opcode == 0xC3 ? native(0, 0)
+                    : z == 2 && y < 4 ? native(static_cast<byte>(y < 2 ? ZERO : CARRY), 0)
+                    : interpreted(opcode);
+            }
+        }
+
+        // replaces the needed flags in F with the ones computed in the low byte of eax
+        void merge_flags(x86_emitter& emitter, byte needed)
+        {
+            emitter.alu32(x86_emitter::and_, reg::rax, static_cast<unsigned int>(needed));
+            emitter.alu32(x86_emitter::and_, FLAG_REGISTER, static_cast<unsigned int>(~needed & 0xFF));
+            emitter.alu32(x86_emitter::or_, FLAG_REGISTER, reg::rax);
+        }
+
+        // Z, H and C straight from the host flags of the previous add/sub/inc/dec, which agree with the SM83 ones
+        void arithmetic_flags(x86_emitter& emitter, byte needed, bool subtract)
+        {
+            if (needed == 0) {
+                return;
+            }
+
+            emitter.load_flags();
+            emitter.mov32(reg::rcx, reg::rax);
+            emitter.alu32(x86_emitter::and_, reg::rcx, 0x50u);
+            emitter.shl32(reg::rcx, 1);
+            emitter.alu32(x86_emitter::and_, reg::rax, 0x01u);
+            emitter.shl32(reg::rax, 4);
+            emitter.alu32(x86_emitter::or_, reg::rax, reg::rcx);
+            if (subtract) {
+                emitter.alu32(x86_emitter::or_, reg::rax, static_cast<unsigned int>(SUBTRACT));
+            }
+            merge_flags(emitter, needed);
+        }
+
+        // Z from the host zero flag, everything else constant
+        void logic_flags(x86_emitter& emitter, byte needed, byte constant)
+        {
+            if (needed == 0) {
+                return;
+            }
+
+            emitter.setcc(x86_emitter::equal, reg::rax);
+            emitter.movzx8(reg::rax, reg::rax);
+            emitter.shl32(reg::rax, 7);
+            if (constant != 0) {
+                emitter.alu32(x86_emitter::or_, reg::rax, static_cast<unsigned int>(constant));
+            }
+            merge_flags(emitter, needed);
+        }
+
+        // BC, DE and HL are two pinned registers; the pair is put together in eax, updated and split again
+        void pair_step(x86_emitter& emitter, int pair, bool increment)
+        {
+            const auto high = HOST_REGISTERS[pair * 2], low = HOST_REGISTERS[pair * 2 + 1];
+            emitter.mov32(reg::rax, high);
+            emitter.shl32(reg::rax, 8);
+            emitter.alu32(x86_emitter::or_, reg::rax, low);
+            emitter.alu32(increment ? x86_emitter::add : x86_emitter::sub, reg::rax, 1u);
+            emitter.movzx8(low, reg::rax);
+            emitter.shr32(reg::rax, 8);
+            emitter.movzx8(high, reg::rax);
+        }
+
+        void emit_instruction(x86_emitter& emitter, const decoded_instruction& decoded, byte needed)
+        {
+            const auto opcode = decoded.opcode;
+            const auto x = opcode >> 6, y = opcode >> 3 & 7, z = opcode & 7, p = y >> 1;
+            const auto immediate = static_cast<byte>(decoded.operand);
+
+            if (opcode == 0xCB) {
+                const auto prefixed = decoded.operand & 0xFF;
+                const auto target = HOST_REGISTERS[prefixed & 7];
+                const auto mask = static_cast<byte>(1 << (prefixed >> 3 & 7));
+                if (prefixed < 0x80) {
+                    emitter.test8(target, mask);
+                    logic_flags(emitter, needed, HALF_CARRY);
+                }
+                else if (prefixed < 0xC0) {
+                    emitter.alu8(x86_emitter::and_, target, static_cast<byte>(~mask));
+                }
+                else {
+                    emitter.alu8(x86_emitter::or_, target, mask);
+                }
+                return;
+            }
+
+            switch (x) {
+            case 0:
+                switch (z) {
+                case 1:
+                    if (p == 3) {
+                        emitter.store16(offsetof(jit_state, stack_pointer), static_cast<unsigned short>(decoded.operand));
+                    }
+                    else {
+                        emitter.mov32(HOST_REGISTERS[p * 2], static_cast<unsigned int>(decoded.operand >> 8));
+                        emitter.mov32(HOST_REGISTERS[p * 2 + 1], static_cast<unsigned int>(decoded.operand & 0xFF));
+                    }
+                    break;
+                case 3:
+                    if (p == 3) {
+                        if ((y & 1) == 0) {
+                            emitter.inc16(offsetof(jit_state, stack_pointer));
+                        }
+                        else {
+                            emitter.dec16(offsetof(jit_state, stack_pointer));
+                        }
+                    }
+                    else {
+                        pair_step(emitter, p, (y & 1) == 0);
+                    }
+                    break;
+                case 4:
+                    emitter.inc8(HOST_REGISTERS[y]);
+                    arithmetic_flags(emitter, needed, false);
+                    break;
+                case 5:
+                    emitter.dec8(HOST_REGISTERS[y]);
+                    arithmetic_flags(emitter, needed, true);
+                    break;
+                case 6:
+                    emitter.mov8(HOST_REGISTERS[y], immediate);
+                    break;
+                case 7:
+                    if (y == 5) {
+                        emitter.not8(HOST_REGISTERS[7]);
+                        emitter.alu32(x86_emitter::or_, FLAG_REGISTER, static_cast<unsigned int>(needed));
+                    }
+                    else if (y == 6) {
+                        emitter.alu32(x86_emitter::and_, FLAG_REGISTER, static_cast<unsigned int>(~needed & 0xFF));
+                        emitter.alu32(x86_emitter::or_, FLAG_REGISTER, static_cast<unsigned int>(needed & CARRY));
+                    }
+                    else {
+                        emitter.alu32(x86_emitter::xor_, FLAG_REGISTER, static_cast<unsigned int>(needed & CARRY));
+                        emitter.alu32(x86_emitter::and_, FLAG_REGISTER,
+                            static_cast<unsigned int>(~(needed & (SUBTRACT | HALF_CARRY)) & 0xFF));
+                    }
+                    break;
+                }
+                break;
+            case 1:
+                if (y != z) {
+                    emitter.mov8(HOST_REGISTERS[y], HOST_REGISTERS[z]);
+                }
+                break;
+            default:
+                if (x == 3 && z != 6) {
+                    // JP and JR are handled as the exit of the block
+                    break;
+                }
+
+                if (y == 1 || y == 3) {
+                    emitter.bt32(FLAG_REGISTER, 4);
+                }
+
+                if (x == 2) {
+                    emitter.alu8(HOST_OPERATIONS[y], HOST_REGISTERS[7], HOST_REGISTERS[z]);
+                }
+                else {
+                    emitter.alu8(HOST_OPERATIONS[y], HOST_REGISTERS[7], immediate);
+                }
+
+                if (y == 4 || y == 5 || y == 6) {
+                    logic_flags(emitter, needed, static_cast<byte>(y == 4 ? HALF_CARRY : 0));
+                }
+                else {
+                    arithmetic_flags(emitter, needed, y == 2 || y == 3 || y == 7);
+                }
+                break;
+            }
+        }
+
+        // sets PC and leaves the cycle count in edx, for both outcomes of a conditional branch
+        void emit_exit(x86_emitter& emitter, const decoded_instruction& last)
+        {
+            const auto opcode = last.opcode;
+            const auto relative = opcode == 0x18 || (opcode & 0xE7) == 0x20;
+            const auto branch = relative || opcode == 0xC3 || (opcode & 0xE7) == 0xC2;
+            if (!branch) {
+                emitter.store16(offsetof(jit_state, program_counter), last.next);
+                emitter.mov32(reg::rdx, static_cast<unsigned int>(last.elapsed));
+                return;
+            }
+
+            const auto target = relative ? static_cast<unsigned short>(last.next + static_cast<sbyte>(last.operand)) : static_cast<unsigned short>(last.operand);
+            // both forms take 4 more cycles when taken than the duration the block was summed with
+            const auto taken_cycles = static_cast<unsigned int>(last.elapsed + 4);
+            if (opcode == 0x18 || opcode == 0xC3) {
+                emitter.mov32(reg::rcx, static_cast<unsigned int>(target));
+                emitter.mov32(reg::rdx, taken_cycles);
+            }
+            else {
+                const auto condition = opcode >> 3 & 3;
+                emitter.mov32(reg::rcx, static_cast<unsigned int>(last.next));
+                emitter.mov32(reg::rdx, static_cast<unsigned int>(last.elapsed));
+                emitter.mov32(reg::rax, static_cast<unsigned int>(target));
+                emitter.mov32(reg::rsi, taken_cycles);
+                emitter.test32(FLAG_REGISTER, condition < 2 ? ZERO : CARRY);
+                // NZ and NC are taken when the bit is clear, Z and C when it is set
+                const auto code = (condition & 1) == 0 ? x86_emitter::equal : x86_emitter::not_equal;
+                emitter.cmov32(code, reg::rcx, reg::rax);
+                emitter.cmov32(code, reg::rdx, reg::rsi);
+            }
+            emitter.store16(offsetof(jit_state, program_counter), reg::rcx);
+        }
+
+        constexpr byte REGISTER_OFFSETS[] = {
+            offsetof(jit_state, general_b), offsetof(jit_state, general_c), offsetof(jit_state, general_d),
+            offsetof(jit_state, general_e), offsetof(jit_state, general_h), offsetof(jit_state, general_l),
+            0, offsetof(jit_state, accumulator)
+        };
+    }
+
+    jit::jit() : _buffer(nullptr), _used(0), _generation(1), _compiled_blocks(0)
+    {
+        auto mapping = mmap(nullptr, BUFFER_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("cannot map the JIT code buffer");
+        }
+
+        _buffer = static_cast<byte*>(mapping);
+    }
+
+    jit::jit(const jit&) : jit()
+    {
+    }
+
+    jit::~jit()
+    {
+        munmap(_buffer, BUFFER_SIZE);
+    }
+
+    jit::native_block jit::compile(const block& source, interpreter fallback)
+    {
+        std::vector<effect> effects;
+        for (const auto& decoded : source.instructions) {
+            const auto analysed = analyse(decoded);
+            if (analysed.kind == translation::unsupported) {
+                break;
+            }
+
+            effects.push_back(analysed);
+        }
+
+        if (effects.empty()) {
+            return nullptr;
+        }
+
+        // everything is live when the block is left, and a flag is only worked out when it is read before the
+        // next instruction that writes it
+        const auto count = effects.size();
+        std::vector<byte> needed(count);
+        auto live = ALL_FLAGS;
+        for (auto index = count; index-- > 0;) {
+            needed[index] = static_cast<byte>(live & effects[index].writes);
+            live = static_cast<byte>((live & ~effects[index].writes) | effects[index].reads);
+        }
+
+        x86_emitter emitter;
+        // the state and the cpu stay in rbx and rbp across calls into the interpreter, and the odd number of
+        // pushes is evened out so that those calls see an aligned stack
+        const reg saved[] = {reg::rbx, reg::rbp, reg::r12, reg::r13, reg::r14, reg::r15};
+        for (const auto preserved : saved) {
+            emitter.push(preserved);
+        }
+        emitter.sub64(reg::rsp, 8);
+        emitter.mov64(reg::rbx, reg::rdi);
+        emitter.mov64(reg::rbp, reg::rsi);
+
+        const auto load_registers = [&emitter] {
+            for (auto index = 0; index < 8; ++index) {
+                if (index != INDIRECT) {
+                    emitter.load8(HOST_REGISTERS[index], REGISTER_OFFSETS[index]);
+                }
+            }
+            emitter.load8(FLAG_REGISTER, offsetof(jit_state, flag));
+        };
+        const auto store_registers = [&emitter] {
+            for (auto index = 0; index < 8; ++index) {
+                if (index != INDIRECT) {
+                    emitter.store8(REGISTER_OFFSETS[index], HOST_REGISTERS[index]);
+                }
+            }
+            emitter.store8(offsetof(jit_state, flag), FLAG_REGISTER);
+        };
+
+        // whether the host registers hold the SM83 ones, or the state does after a call into the interpreter
+        auto loaded = false;
+        // jumps taken when an interpreted instruction wrote into code, with the index of that instruction
+        std::vector<std::pair<std::size_t, std::size_t>> rewrites;
+        for (std::size_t index = 0; index < count; ++index) {
+            const auto& decoded = source.instructions[index];
+            if (effects[index].kind == translation::native) {
+                if (!loaded) {
+                    load_registers();
+                    loaded = true;
+                }
+                emit_instruction(emitter, decoded, needed[index]);
+                continue;
+            }
+
+            if (loaded) {
+                store_registers();
+                loaded = false;
+            }
+            emitter.mov64(reg::rdi, reg::rbp);
+            emitter.mov64(reg::rsi, reg::rbx);
+            emitter.mov64(reg::rdx, &decoded);
+            emitter.mov64(reg::rax, reinterpret_cast<const void*>(fallback));
+            emitter.call(reg::rax);
+            if (index + 1 < count) {
+                emitter.cmp8(offsetof(jit_state, rewritten), 0);
+                rewrites.emplace_back(emitter.jcc(x86_emitter::not_equal), index);
+            }
+        }
+
+        const auto& last = source.instructions[count - 1];
+        if (loaded) {
+            emit_exit(emitter, last);
+            store_registers();
+        }
+        else {
+            // the interpreter has already set PC, and its cycles come on top of everything before
+            const auto before = count > 1 ? source.instructions[count - 2].elapsed : 0;
+            emitter.mov32(reg::rdx, reg::rax);
+            emitter.alu32(x86_emitter::add, reg::rdx, static_cast<unsigned int>(before));
+        }
+
+        const auto finish = emitter.position();
+        emitter.mov32(reg::rax, reg::rdx);
+        emitter.add64(reg::rsp, 8);
+        for (auto index = sizeof(saved) / sizeof(saved[0]); index-- > 0;) {
+            emitter.pop(saved[index]);
+        }
+        emitter.ret();
+
+        for (const auto& rewrite : rewrites) {
+            emitter.patch(rewrite.first, emitter.position());
+            const auto& decoded = source.instructions[rewrite.second];
+            emitter.store16(offsetof(jit_state, program_counter), decoded.next);
+            emitter.mov32(reg::rdx, static_cast<unsigned int>(decoded.elapsed));
+            emitter.jmp(finish);
+        }
+
+        const auto& code = emitter.get_code();
+        if (code.size() > BUFFER_SIZE - _used) {
+            // start over; whatever was translated before is now stale
+            _used = 0;
+            ++_generation;
+        }
+
+        auto destination = _buffer + _used;
+        mprotect(_buffer, BUFFER_SIZE, PROT_READ | PROT_WRITE);
+        std::memcpy(destination, code.data(), code.size());
+        mprotect(_buffer, BUFFER_SIZE, PROT_READ | PROT_EXEC);
+        // keep the next translation 16-byte aligned
+        _used += (code.size() + 15) & ~std::size_t{15};
+        ++_compiled_blocks;
+
+        return reinterpret_cast<native_block>(destination);
+    }
+
+    unsigned int jit::get_generation() const
+    {
+        return _generation;
+    }
+
+    int jit::get_compiled_blocks() const
+    {
+        return _compiled_blocks;
+    }
+}
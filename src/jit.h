@@ -0,0 +1,61 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include "byte.h"
+#include "block-cache.h"
+
+namespace gameboy {
+    // register file as the translated code sees it, with F as a plain byte whichever flag representation the cpu uses
+    struct jit_state {
+        byte accumulator;
+        byte flag;
+        byte general_b;
+        byte general_c;
+        byte general_d;
+        byte general_e;
+        byte general_h;
+        byte general_l;
+        unsigned short stack_pointer;
+        unsigned short program_counter;
+        // set by an interpreted instruction that wrote into code, which ends the translated block early
+        byte rewritten;
+    };
+
+    // translates decoded blocks into x86-64 code in an mmap'd buffer. Register-to-register work and JR/JP are
+    // translated; everything else that touches memory, the stack or the interrupt state calls back into the
+    // interpreter's handler for that one instruction. The translated code keeps the SM83 registers in host
+    // registers between those calls and only works out the flags that are read before being overwritten again.
+    class jit {
+    public:
+        using native_block = int (*)(jit_state*, cpu*);
+        // runs one decoded instruction on the state and returns its cycles
+        using interpreter = int (*)(cpu*, jit_state*, const decoded_instruction*);
+
+        // blocks are translated on this run
+        static constexpr auto THRESHOLD = 16;
+        // blocks translated again after a rewrite more often than this are left to the interpreter
+        static constexpr auto REWRITE_LIMIT = 8;
+
+        jit();
+        // a copy gets its own, empty buffer
+        jit(const jit& other);
+        jit& operator=(const jit&) = delete;
+        ~jit();
+
+        // translation of source up to its first instruction that raises an error, or nullptr if that is the first
+        native_block compile(const block& source, interpreter fallback);
+        // translations stay valid until the buffer runs full and is recycled, which bumps the generation
+        unsigned int get_generation() const;
+        int get_compiled_blocks() const;
+    private:
+        static constexpr std::size_t BUFFER_SIZE = 4 << 20;
+
+        byte* _buffer;
+        std::size_t _used;
+        unsigned int _generation;
+        int _compiled_blocks;
+    };
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef LAZY_FLAGS_H
+#define LAZY_FLAGS_H
+
+#include "byte.h"
+#include "flags.h"
+
+namespace gameboy {
+    // Flag register that keeps the unmasked result of the last 8-bit operation and the xor of its
+    // operands instead of Z/N/H/C. The arithmetic result is needed anyway, so recording costs a couple
+    // of stores, and the flags are only worked out when somebody reads them:
+    //   Z = low byte of the result is zero
+    //   H = bit 4 of operand1 ^ operand2 ^ result (carry or borrow into bit 4)
+    //   C = bit 8 of the result (carry or borrow out of bit 7)
+    class lazy_flags {
+    public:
+        class reference {
+        public:
+            reference& operator=(bool value)
+            {
+                flags status = _owner;
+                status[_type] = value;
+                _owner = status;
+                return *this;
+            }
+
+            reference& operator=(const reference& other)
+            {
+                return *this = static_cast<bool>(other);
+            }
+
+            operator bool() const
+            {
+                return static_cast<const lazy_flags&>(_owner)[_type];
+            }
+        private:
+            friend class lazy_flags;
+            reference(lazy_flags& owner, flag_type type) : _owner(owner), _type(type)
+            {
+            }
+
+            lazy_flags& _owner;
+            flag_type _type;
+        };
+
+        lazy_flags() : _result(1), _operands(0), _subtract(false)
+        {
+        }
+
+        // any combination of flags can be encoded, but the unused low nibble of F reads back as zero
+        lazy_flags& operator=(const flags& value)
+        {
+            _result = (value[flag_type::zero] ? 0x000 : 0x001) | (value[flag_type::carry] ? 0x100 : 0x000);
+            _operands = value[flag_type::half_carry] ? 0x10 : 0x00;
+            _subtract = value[flag_type::subtract];
+            return *this;
+        }
+
+        lazy_flags& operator=(byte value)
+        {
+            return *this = flags{value};
+        }
+
+        bool operator[](flag_type type) const
+        {
+            switch (type) {
+            case flag_type::zero:
+                return (_result & 0xFF) == 0;
+            case flag_type::subtract:
+                return _subtract;
+            case flag_type::half_carry:
+                return ((_operands ^ _result) & 0x10) != 0;
+            case flag_type::carry:
+                return (_result & 0x100) != 0;
+            }
+
+            return false;
+        }
+
+        reference operator[](flag_type type)
+        {
+            return reference{*this, type};
+        }
+
+        operator flags() const
+        {
+            return flags{materialize()};
+        }
+
+        operator byte() const
+        {
+            return materialize();
+        }
+
+        template<bool Z, bool N, bool H, bool C>
+        void assign(const flags& value)
+        {
+            flags status = *this;
+            status.assign<Z, N, H, C>(value);
+            *this = status;
+        }
+
+        void record_add(byte operand1, byte operand2, bool carry)
+        {
+            _result = operand1 + operand2 + carry;
+            _operands = operand1 ^ operand2;
+            _subtract = false;
+        }
+
+        void record_subtract(byte operand1, byte operand2, bool carry)
+        {
+            _result = operand1 - operand2 - carry;
+            _operands = operand1 ^ operand2;
+            _subtract = true;
+        }
+
+        // INC and DEC leave the carry alone, so bit 8 of the previous result is carried over
+        void record_increment(byte operand)
+        {
+            _result = ((operand + 1) & 0xFF) | (_result & 0x100);
+            _operands = operand ^ 1;
+            _subtract = false;
+        }
+
+        void record_decrement(byte operand)
+        {
+            _result = ((operand - 1) & 0xFF) | (_result & 0x100);
+            _operands = operand ^ 1;
+            _subtract = true;
+        }
+    private:
+        byte materialize() const
+        {
+            return static_cast<byte>(((_result & 0xFF) == 0 ? 0x80 : 0x00) | (_subtract ? 0x40 : 0x00)
+                | ((_operands ^ _result) & 0x10) << 1 | (_result & 0x100) >> 4);
+        }
+
+        unsigned int _result;
+        unsigned int _operands;
+        bool _subtract;
+    };
+}
+
+#endif
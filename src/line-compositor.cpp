@@ -0,0 +1,169 @@
+#include "line-compositor.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GAMEBOY_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace gameboy {
+    namespace {
+        constexpr auto SPRITE_SHADES = 4;
+        constexpr auto PALETTE_SHADES = 4;
+
+        unsigned long long scan_scalar(const byte* ys, int line, int height)
+        {
+            auto found = 0ull;
+            for (auto index = 0; index < line_compositor::OAM_ENTRIES; ++index) {
+                const auto top = ys[index] - 16;
+                if (line >= top && line < top + height) {
+                    found |= 1ull << index;
+                }
+            }
+
+            return found;
+        }
+
+        void composite_scalar(const byte* background, const byte* sprites, const byte* attributes, const byte* table,
+            byte* output, std::size_t count)
+        {
+            for (std::size_t x = 0; x < count; ++x) {
+                const auto shown = sprites[x] != 0
+                    && ((attributes[x] & line_compositor::BEHIND_BACKGROUND) == 0 || background[x] == 0);
+                const auto palette = (attributes[x] & line_compositor::SECOND_PALETTE) != 0 ? PALETTE_SHADES : 0;
+                output[x] = shown ? table[SPRITE_SHADES + palette + sprites[x]] : table[background[x]];
+            }
+        }
+
+#ifdef GAMEBOY_X86_KERNELS
+        // line + 16 - y wrapped to a byte is below height only on the sprite's lines: above them it wraps round to
+        // more than line + 16, which is at least 16
+        __attribute__((target("sse2")))
+        unsigned long long scan_sse2(const byte* ys, int line, int height)
+        {
+            const auto bottom = _mm_set1_epi8(static_cast<char>(line + 16));
+            const auto last = _mm_set1_epi8(static_cast<char>(height - 1));
+            auto found = 0ull;
+            for (auto index = 0; index < line_compositor::OAM_ENTRIES; index += 16) {
+                const auto distance = _mm_sub_epi8(bottom, _mm_loadu_si128(reinterpret_cast<const __m128i*>(ys + index)));
+                const auto inside = _mm_cmpeq_epi8(_mm_min_epu8(distance, last), distance);
+                found |= static_cast<unsigned long long>(static_cast<unsigned>(_mm_movemask_epi8(inside))) << index;
+            }
+
+            return found;
+        }
+
+        // without a shuffle, the shades are looked up by comparing the indices against every one there is
+        __attribute__((target("sse2")))
+        void composite_sse2(const byte* background, const byte* sprites, const byte* attributes, const byte* table,
+            byte* output, std::size_t count)
+        {
+            const auto zero = _mm_setzero_si128();
+            const auto behind = _mm_set1_epi8(static_cast<char>(line_compositor::BEHIND_BACKGROUND));
+            const auto second = _mm_set1_epi8(static_cast<char>(line_compositor::SECOND_PALETTE));
+            const auto palette_shades = _mm_set1_epi8(PALETTE_SHADES);
+            const auto sprite_shades = _mm_set1_epi8(SPRITE_SHADES);
+            // SSE2 has no byte broadcast, so these are made once
+            __m128i entries[SPRITE_SHADES + 2 * PALETTE_SHADES];
+            __m128i shade_entries[SPRITE_SHADES + 2 * PALETTE_SHADES];
+            for (auto entry = 0; entry < SPRITE_SHADES + 2 * PALETTE_SHADES; ++entry) {
+                entries[entry] = _mm_set1_epi8(static_cast<char>(entry));
+                shade_entries[entry] = _mm_set1_epi8(static_cast<char>(table[entry]));
+            }
+            for (; count >= 16; count -= 16, background += 16, sprites += 16, attributes += 16, output += 16) {
+                const auto colours = _mm_loadu_si128(reinterpret_cast<const __m128i*>(background));
+                const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sprites));
+                const auto flags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(attributes));
+
+                const auto hidden = _mm_andnot_si128(_mm_cmpeq_epi8(colours, zero),
+                    _mm_cmpeq_epi8(_mm_and_si128(flags, behind), behind));
+                const auto shown = _mm_andnot_si128(_mm_or_si128(hidden, _mm_cmpeq_epi8(pixels, zero)),
+                    _mm_cmpeq_epi8(zero, zero));
+                const auto palette = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(flags, second), second), palette_shades);
+                const auto sprite = _mm_add_epi8(pixels, _mm_add_epi8(sprite_shades, palette));
+                const auto index = _mm_or_si128(_mm_and_si128(shown, sprite), _mm_andnot_si128(shown, colours));
+
+                auto shades = zero;
+                for (auto entry = 0; entry < SPRITE_SHADES + 2 * PALETTE_SHADES; ++entry) {
+                    const auto match = _mm_cmpeq_epi8(index, entries[entry]);
+                    shades = _mm_or_si128(shades, _mm_and_si128(match, shade_entries[entry]));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output), shades);
+            }
+            composite_scalar(background, sprites, attributes, table, output, count);
+        }
+
+        __attribute__((target("avx2")))
+        unsigned long long scan_avx2(const byte* ys, int line, int height)
+        {
+            const auto bottom = _mm256_set1_epi8(static_cast<char>(line + 16));
+            const auto last = _mm256_set1_epi8(static_cast<char>(height - 1));
+            auto found = 0ull;
+            for (auto index = 0; index < line_compositor::OAM_ENTRIES; index += 32) {
+                const auto distance = _mm256_sub_epi8(bottom,
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + index)));
+                const auto inside = _mm256_cmpeq_epi8(_mm256_min_epu8(distance, last), distance);
+                found |= static_cast<unsigned long long>(static_cast<unsigned>(_mm256_movemask_epi8(inside))) << index;
+            }
+
+            return found;
+        }
+
+        // composite_sse2() with the shades looked up in one shuffle, the table being in both halves
+        __attribute__((target("avx2")))
+        void composite_avx2(const byte* background, const byte* sprites, const byte* attributes, const byte* table,
+            byte* output, std::size_t count)
+        {
+            const auto zero = _mm256_setzero_si256();
+            const auto behind = _mm256_set1_epi8(static_cast<char>(line_compositor::BEHIND_BACKGROUND));
+            const auto second = _mm256_set1_epi8(static_cast<char>(line_compositor::SECOND_PALETTE));
+            const auto palette_shades = _mm256_set1_epi8(PALETTE_SHADES);
+            const auto sprite_shades = _mm256_set1_epi8(SPRITE_SHADES);
+            const auto shades = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+            for (; count >= 32; count -= 32, background += 32, sprites += 32, attributes += 32, output += 32) {
+                const auto colours = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(background));
+                const auto pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sprites));
+                const auto flags = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(attributes));
+
+                const auto hidden = _mm256_andnot_si256(_mm256_cmpeq_epi8(colours, zero),
+                    _mm256_cmpeq_epi8(_mm256_and_si256(flags, behind), behind));
+                const auto shown = _mm256_andnot_si256(_mm256_or_si256(hidden, _mm256_cmpeq_epi8(pixels, zero)),
+                    _mm256_cmpeq_epi8(zero, zero));
+                const auto palette = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(flags, second), second),
+                    palette_shades);
+                const auto sprite = _mm256_add_epi8(pixels, _mm256_add_epi8(sprite_shades, palette));
+                const auto index = _mm256_blendv_epi8(colours, sprite, shown);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), _mm256_shuffle_epi8(shades, index));
+            }
+            // the scalar tail may well be vectorised to SSE, which would pay for the upper halves left dirty
+            _mm256_zeroupper();
+            composite_scalar(background, sprites, attributes, table, output, count);
+        }
+#endif
+    }
+
+    line_compositor::line_compositor(tile_decoder::kernel type)
+        : _kernel(tile_decoder::is_supported(type) ? type : tile_decoder::kernel::scalar), _scan(&scan_scalar),
+        _composite(&composite_scalar)
+    {
+#ifdef GAMEBOY_X86_KERNELS
+        switch (_kernel) {
+        case tile_decoder::kernel::scalar:
+            break;
+        case tile_decoder::kernel::sse2:
+        case tile_decoder::kernel::bmi2:
+            _scan = &scan_sse2;
+            _composite = &composite_sse2;
+            break;
+        case tile_decoder::kernel::avx2:
+            _scan = &scan_avx2;
+            _composite = &composite_avx2;
+            break;
+        }
+#endif
+    }
+
+    tile_decoder::kernel line_compositor::get_kernel() const
+    {
+        return _kernel;
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef LINE_COMPOSITOR_H
+#define LINE_COMPOSITOR_H
+
+#include <array>
+#include <cstddef>
+#include "byte.h"
+#include "tile-decoder.h"
+
+namespace gameboy {
+    // The per-line work around the tiles: finding the OAM entries on a line, and mixing the background and sprite
+    // pixels of a line into shades. Kernels are the tile decoder's, picked at run time; BMI2 has nothing to offer
+    // here and uses the SSE2 ones. Every kernel gives the same results as the scalar one.
+    class line_compositor {
+    public:
+        static constexpr auto OAM_ENTRIES = 40;
+        // sprite attribute bits a pixel keeps
+        static constexpr byte BEHIND_BACKGROUND = 0x80;
+        static constexpr byte SECOND_PALETTE = 0x10;
+
+        // the Y of every OAM entry, and 0 after the last, which is on no line
+        using positions = std::array<byte, 64>;
+        // shades of the background colours, then of OBP0 and OBP1
+        using shades = std::array<byte, 16>;
+
+        // falls back to the scalar kernels when type is not supported
+        explicit line_compositor(tile_decoder::kernel type = tile_decoder::best());
+        tile_decoder::kernel get_kernel() const;
+
+        // bit n set when entry n overlaps line, for sprites height lines tall
+        unsigned long long scan(const positions& ys, int line, int height) const
+        {
+            return _scan(ys.data(), line, height);
+        }
+
+        // count shades from colour indices of the background and sprites, 0 where no sprite is, and the attributes
+        // of the sprite at each pixel; a sprite shows unless it is behind a background colour other than 0
+        void composite(const byte* background, const byte* sprites, const byte* attributes, const shades& table,
+            byte* output, std::size_t count) const
+        {
+            _composite(background, sprites, attributes, table.data(), output, count);
+        }
+    private:
+        tile_decoder::kernel _kernel;
+        unsigned long long (*_scan)(const byte* ys, int line, int height);
+        void (*_composite)(const byte* background, const byte* sprites, const byte* attributes, const byte* table,
+            byte* output, std::size_t count);
+    };
+}
+
+#endif
@@ -0,0 +1,172 @@
+#include "line-renderer.h"
+#include <algorithm>
+
+namespace gameboy {
+    namespace {
+        // LCDC
+        constexpr byte BACKGROUND_ENABLE = 0x01;
+        constexpr byte OBJECT_ENABLE = 0x02;
+        constexpr byte TALL_OBJECTS = 0x04;
+        constexpr byte BACKGROUND_MAP = 0x08;
+        constexpr byte UNSIGNED_TILES = 0x10;
+        constexpr byte WINDOW_ENABLE = 0x20;
+        constexpr byte WINDOW_MAP = 0x40;
+
+        // sprite attributes, besides the ones line_compositor looks at
+        constexpr byte FLIP_Y = 0x40;
+        constexpr byte FLIP_X = 0x20;
+
+        // where tile 0 is when tile numbers are signed
+        constexpr auto SIGNED_TILES = (0x9000 - line_renderer::VRAM) / line_renderer::BLOCK_SIZE;
+        constexpr auto LOW_MAP = 0x9800;
+        constexpr auto HIGH_MAP = 0x9C00;
+        // the window's left edge is WX - 7
+        constexpr auto WINDOW_OFFSET = 7;
+    }
+
+    line_renderer::line_renderer(tile_decoder::kernel decoding) : _decoder(decoding), _compositor(decoding), _vram{},
+        _stale{}, _tiles{}, _flipped_tiles{}, _frame{}, _palettes{}, _shades{}, _output(nullptr)
+    {
+    }
+
+    bool line_renderer::shows_window(const line_state& state)
+    {
+        return (state.control & (BACKGROUND_ENABLE | WINDOW_ENABLE)) == (BACKGROUND_ENABLE | WINDOW_ENABLE)
+            && state.line >= state.window_y && state.window_x - WINDOW_OFFSET < WIDTH;
+    }
+
+    void line_renderer::write_block(int address, const byte* data)
+    {
+        const auto offset = address - VRAM;
+        std::copy_n(data, BLOCK_SIZE, _vram.begin() + offset);
+        if (offset / BLOCK_SIZE < TILES) {
+            _stale[static_cast<std::size_t>(offset / BLOCK_SIZE)] = true;
+        }
+    }
+
+    void line_renderer::render(const line_state& state)
+    {
+        // colour indices of the background and window; the background is fetched a tile wider to scroll within it
+        std::array<byte, WIDTH + 8> fetched;
+        std::array<byte, WIDTH> indices{};
+        if ((state.control & BACKGROUND_ENABLE) != 0) {
+            const auto row = (state.line + state.scroll_y) & 0xFF;
+            fetch_tiles(state, (state.control & BACKGROUND_MAP) != 0 ? HIGH_MAP : LOW_MAP, row, state.scroll_x / 8,
+                WIDTH / 8 + 1, fetched.data());
+            std::copy_n(fetched.begin() + (state.scroll_x & 7), WIDTH, indices.begin());
+
+            if (shows_window(state)) {
+                // a window partly off the left edge is fetched from its first tile all the same
+                const auto left = state.window_x - WINDOW_OFFSET;
+                const auto start = std::max(left, 0);
+                const auto skipped = start - left;
+                fetch_tiles(state, (state.control & WINDOW_MAP) != 0 ? HIGH_MAP : LOW_MAP, state.window_line, 0,
+                    (WIDTH - start + skipped + 7) / 8, fetched.data());
+                std::copy_n(fetched.begin() + skipped, WIDTH - start, indices.begin() + start);
+            }
+        }
+
+        // colour indices of the sprite showing at each pixel and its attributes, 0 where none does
+        std::array<byte, WIDTH> sprite_indices{};
+        std::array<byte, WIDTH> attributes{};
+        if ((state.control & OBJECT_ENABLE) != 0) {
+            // the sprite further left wins where they overlap, and then the one first in OAM; a sprite behind the
+            // background still hides the ones after it
+            std::array<const sprite*, LINE_SPRITES> ordered;
+            const auto last = std::transform(state.sprites.begin(), state.sprites.begin() + state.sprite_count,
+                ordered.begin(), [](const sprite& selected) { return &selected; });
+            std::stable_sort(ordered.begin(), last, [](const sprite* first, const sprite* second) {
+                return first->x < second->x;
+            });
+
+            const auto height = (state.control & TALL_OBJECTS) != 0 ? 16 : 8;
+            for (auto current = ordered.begin(); current != last; ++current) {
+                const auto& selected = **current;
+                auto row = state.line + 16 - selected.y;
+                if ((selected.attributes & FLIP_Y) != 0) {
+                    row = height - 1 - row;
+                }
+                const auto tile = (height == 16 ? selected.tile & 0xFE : selected.tile) + row / 8;
+                const auto pixels = get_row(tile, row % 8, (selected.attributes & FLIP_X) != 0);
+                for (auto column = 0; column < 8; ++column) {
+                    // off the left edge wraps round to past the right one
+                    const auto x = static_cast<std::size_t>(selected.x - 8 + column);
+                    if (x < WIDTH && pixels[column] != 0 && sprite_indices[x] == 0) {
+                        sprite_indices[x] = pixels[column];
+                        attributes[x] = selected.attributes;
+                    }
+                }
+            }
+        }
+
+        const auto output = _frame.data() + state.line * WIDTH;
+        _compositor.composite(indices.data(), sprite_indices.data(), attributes.data(), get_shades(state), output, WIDTH);
+        if (_output != nullptr) {
+            _output->write_line(state.line, output);
+            if (state.line == HEIGHT - 1) {
+                _output->swap();
+            }
+        }
+    }
+
+    void line_renderer::set_output(framebuffer* output)
+    {
+        _output = output;
+    }
+
+    const line_renderer::frame& line_renderer::get_frame() const
+    {
+        return _frame;
+    }
+
+    const tile_decoder& line_renderer::get_decoder() const
+    {
+        return _decoder;
+    }
+
+    const line_compositor& line_renderer::get_compositor() const
+    {
+        return _compositor;
+    }
+
+    const line_compositor::shades& line_renderer::get_shades(const line_state& state)
+    {
+        const std::array<byte, 3> palettes{{state.background_palette, state.object_palettes[0], state.object_palettes[1]}};
+        // the shades start out all 0, which is right for palettes all 0
+        if (palettes != _palettes) {
+            _palettes = palettes;
+            for (std::size_t entry = 0; entry < palettes.size() * 4; ++entry) {
+                _shades[entry] = static_cast<byte>(palettes[entry / 4] >> (entry % 4 * 2) & 3);
+            }
+        }
+
+        return _shades;
+    }
+
+    void line_renderer::fetch_tiles(const line_state& state, int map, int row, int column, int count, byte* pixels)
+    {
+        const auto line = map - VRAM + (row / 8 % 32) * 32;
+        for (auto index = 0; index < count; ++index, pixels += 8) {
+            const auto number = _vram[static_cast<std::size_t>(line + ((column + index) & 31))];
+            // signed numbers count from the middle of the tiles
+            const auto tile = (state.control & UNSIGNED_TILES) != 0 ? number : SIGNED_TILES + static_cast<sbyte>(number);
+            std::copy_n(get_row(tile, row & 7, false), 8, pixels);
+        }
+    }
+
+    const byte* line_renderer::get_row(int index, int row, bool flipped)
+    {
+        const auto tile = static_cast<std::size_t>(index);
+        auto& decoded = _tiles[tile];
+        auto& mirrored = _flipped_tiles[tile];
+        if (_stale[tile]) {
+            _stale[tile] = false;
+            _decoder.decode(&_vram[tile * BLOCK_SIZE], decoded.data(), 8);
+            for (auto line = decoded.begin(), reversed = mirrored.begin(); line != decoded.end(); line += 8, reversed += 8) {
+                std::reverse_copy(line, line + 8, reversed);
+            }
+        }
+
+        return (flipped ? mirrored : decoded).data() + row * 8;
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef LINE_RENDERER_H
+#define LINE_RENDERER_H
+
+#include <array>
+#include "byte.h"
+#include "framebuffer.h"
+#include "line-compositor.h"
+#include "tile-decoder.h"
+
+namespace gameboy {
+    // Draws the lines of the original Game Boy's LCD from a copy of VRAM of its own and a snapshot of the registers
+    // and sprites each line is drawn with, so that it needs nothing from the bus and can run on another thread. Tiles
+    // are kept decoded, plain and flipped, and only decoded again after a write into their 16 bytes, so drawing a
+    // line mostly copies rows of colour indices. Sprites go to line buffers of their own, and the line_compositor mixes
+    // them with the background.
+    class line_renderer {
+    public:
+        static constexpr auto WIDTH = 160;
+        static constexpr auto HEIGHT = 144;
+        // sprites drawn on one line at most
+        static constexpr auto LINE_SPRITES = 10;
+        // tile data, from 0x8000 to 0x97FF
+        static constexpr auto TILES = 384;
+        static constexpr auto VRAM = 0x8000;
+        static constexpr auto VRAM_SIZE = 0x2000;
+        // what VRAM is copied in, a tile's worth
+        static constexpr auto BLOCK_SIZE = 16;
+
+        struct sprite {
+            byte y;
+            byte x;
+            byte tile;
+            byte attributes;
+        };
+
+        // the registers a line is drawn with, and what it takes from the rest of the frame
+        struct line_state {
+            int line;
+            // line of the window the line shows, if it shows it
+            int window_line;
+            byte control;
+            byte scroll_y;
+            byte scroll_x;
+            byte background_palette;
+            std::array<byte, 2> object_palettes;
+            byte window_y;
+            byte window_x;
+            // the first ones in OAM overlapping the line
+            int sprite_count;
+            std::array<sprite, LINE_SPRITES> sprites;
+        };
+
+        // shades from 0 for white to 3 for black, a line after another
+        using frame = std::array<byte, WIDTH * HEIGHT>;
+
+        explicit line_renderer(tile_decoder::kernel decoding = tile_decoder::best());
+
+        // whether the line shows the window, which is what moves the window on a line
+        static bool shows_window(const line_state& state);
+
+        // BLOCK_SIZE bytes of VRAM from address on, a multiple of BLOCK_SIZE
+        void write_block(int address, const byte* data);
+        void render(const line_state& state);
+        // where lines also go as host pixels, the last one on screen swapping the buffers; nullptr for nowhere
+        void set_output(framebuffer* output);
+        const frame& get_frame() const;
+        const tile_decoder& get_decoder() const;
+        const line_compositor& get_compositor() const;
+    private:
+        // the colour indices of a tile, a row after another
+        using tile = std::array<byte, 64>;
+
+        // the shades of the palettes, made again when one of them changes
+        const line_compositor::shades& get_shades(const line_state& state);
+        // count tiles of row, the line within map, from column on, as colour indices
+        void fetch_tiles(const line_state& state, int map, int row, int column, int count, byte* pixels);
+        // row of tile number index, decoded again first if the tile was written to since it last was
+        const byte* get_row(int index, int row, bool flipped);
+
+        tile_decoder _decoder;
+        line_compositor _compositor;
+        std::array<byte, VRAM_SIZE> _vram;
+        // tiles written to since they were decoded
+        std::array<bool, TILES> _stale;
+        std::array<tile, TILES> _tiles;
+        // the same mirrored, for sprites flipped horizontally
+        std::array<tile, TILES> _flipped_tiles;
+        frame _frame;
+        // BGP, OBP0 and OBP1 the shades are for
+        std::array<byte, 3> _palettes;
+        line_compositor::shades _shades;
+        framebuffer* _output;
+    };
+}
+
+#endif
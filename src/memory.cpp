@@ -1,13 +1,485 @@
 #include "memory.h"
+#include <algorithm>
+#include <utility>
 
 namespace gameboy {
-    unsigned char memory::get_byte(int address) const
+    namespace {
+        constexpr auto ROM_PAGES = 0x80;
+        constexpr auto BANK_PAGES = cartridge::ROM_BANK_SIZE / memory::PAGE_SIZE;
+        constexpr auto VIDEO_RAM_PAGE = 0x80;
+        constexpr auto EXTERNAL_RAM_PAGE = 0xA0;
+        constexpr auto WORK_RAM_PAGE = 0xC0;
+        constexpr auto ECHO_PAGE = 0xE0;
+        constexpr auto ECHO_END_PAGE = 0xFE;
+        // MBC3 maps the clock registers over cartridge RAM with RAM bank numbers 0x08-0x0C
+        constexpr auto RTC_SELECT = 0x08;
+    }
+
+    memory::memory() : _data(ADDRESS_SPACE), _read_pages{}, _write_pages{}, _page_banks{}, _handlers{}, _io_handlers{}, _high_ram(nullptr),
+        _code_pages{}, _register_code(false),
+        _tracked_pages{}, _watched_pages{}, _written{},
+        _page_versions{}, _code_writes(0), _timed_reads(0), _rom_bank(1), _ram_bank(0), _ram_enabled(false), _advanced_banking(false), _rtc{},
+        _rtc_latched{}, _rtc_latch(0xFF)
+    {
+        remap(0, PAGE_COUNT - 1);
+    }
+
+    memory::memory(const memory& other)
+    {
+        *this = other;
+    }
+
+    memory& memory::operator=(const memory& other)
+    {
+        if (this == &other) {
+            return *this;
+        }
+
+        _data = other._data;
+        _page_banks = other._page_banks;
+        _handlers = {};
+        _io_handlers = {};
+        _code_pages = other._code_pages;
+        _register_code = other._register_code;
+        _tracked_pages = other._tracked_pages;
+        _watched_pages = other._watched_pages;
+        _written = other._written;
+        _page_versions = other._page_versions;
+        _code_writes = other._code_writes;
+        _timed_reads = other._timed_reads;
+        _scheduler = other._scheduler;
+        for (auto kind = 0; kind < static_cast<int>(scheduler::event::count); ++kind) {
+            _scheduler.set_handler(static_cast<scheduler::event>(kind), nullptr);
+        }
+        _cartridge = other._cartridge;
+        _external_ram = other._external_ram;
+        _rom_bank = other._rom_bank;
+        _ram_bank = other._ram_bank;
+        _ram_enabled = other._ram_enabled;
+        _advanced_banking = other._advanced_banking;
+        _rtc = other._rtc;
+        _rtc_latched = other._rtc_latched;
+        _rtc_latch = other._rtc_latch;
+
+        // the same mapping, but into this memory's RAM; cartridge ROM is shared
+        for (auto page = 0; page < PAGE_COUNT; ++page) {
+            const auto read = relocate(other, other._read_pages[page]);
+            _read_pages[page] = read != nullptr ? read : other._read_pages[page];
+            _write_pages[page] = relocate(other, other._write_pages[page]);
+        }
+        _high_ram = relocate(other, other._high_ram);
+        // pages the original hands to a device are plain memory here
+        for (auto page = 0; page < PAGE_COUNT; ++page) {
+            if (other._handlers[page] != nullptr) {
+                remap(page, page);
+            }
+        }
+
+        return *this;
+    }
+
+    void memory::insert(std::shared_ptr<const cartridge> inserted)
+    {
+        if (!_cartridge) {
+            // keep what the console's own RAM holds, and drop the rest
+            std::vector<byte> console(CONSOLE_RAM);
+            std::copy(_data.begin() + 0x8000, _data.begin() + 0xA000, console.begin());
+            std::copy(_data.begin() + 0xC000, _data.begin() + 0xE000, console.begin() + 0x2000);
+            std::copy(_data.begin() + 0xFE00, _data.end(), console.begin() + 0x4000);
+            _data.swap(console);
+        }
+
+        _cartridge = std::move(inserted);
+        _external_ram.assign(_cartridge->get_ram_size(), 0);
+        _rom_bank = 1;
+        _ram_bank = 0;
+        _ram_enabled = false;
+        _advanced_banking = false;
+        _rtc = {};
+        _rtc_latched = {};
+        _rtc_latch = 0xFF;
+
+        // nothing decoded from what was mapped before holds any more
+        for (auto page = 0; page < PAGE_COUNT; ++page) {
+            _code_pages[page] = false;
+            _watched_pages[page] = _tracked_pages[page];
+            ++_page_versions[page];
+        }
+        ++_code_writes;
+
+        remap(0, PAGE_COUNT - 1);
+    }
+
+    void memory::set_handler(int page, handler* target)
+    {
+        _handlers[page] = target;
+        remap(page, page);
+    }
+
+    void memory::set_io_handler(int address, handler* target)
+    {
+        _io_handlers[address % PAGE_SIZE] = target;
+    }
+
+    void memory::request_interrupt(byte mask)
+    {
+        write_io(INTERRUPT_FLAG, static_cast<byte>(read_io(INTERRUPT_FLAG) | mask));
+    }
+
+    byte memory::peek_byte(int address) const
+    {
+        const auto page = _read_pages[address / PAGE_SIZE];
+        if (page != nullptr) {
+            return page[address % PAGE_SIZE];
+        }
+
+        // the RAM under a device, or the I/O page
+        const auto offset = get_offset(address / PAGE_SIZE);
+        return offset >= 0 ? _data[static_cast<std::size_t>(offset + address % PAGE_SIZE)] : byte{0xFF};
+    }
+
+    byte memory::read_handled(int address) const
+    {
+        const auto target = _handlers[address / PAGE_SIZE];
+        if (target != nullptr) {
+            _timed_reads += target->is_timed(address);
+            return target->read(address);
+        }
+        if (address / PAGE_SIZE == IO_PAGE) {
+            return read_io(address);
+        }
+
+        if (_cartridge->get_controller() == cartridge::controller::mbc3 && _ram_enabled && _ram_bank >= RTC_SELECT
+            && _ram_bank < RTC_SELECT + RTC_REGISTERS) {
+            return _rtc_latched[static_cast<std::size_t>(_ram_bank - RTC_SELECT)];
+        }
+
+        // cartridge RAM that is switched off or missing
+        return 0xFF;
+    }
+
+    void memory::write_handled(int address, byte value)
+    {
+        const auto page = address / PAGE_SIZE;
+        const auto target = _handlers[page];
+        if (target != nullptr) {
+            target->write(address, value);
+            if (_watched_pages[page]) {
+                write_watched(address);
+            }
+        }
+        else if (page == IO_PAGE) {
+            write_io(address, value);
+            if (_watched_pages[page]) {
+                write_watched(address);
+            }
+        }
+        else if (page < ROM_PAGES) {
+            write_controller(address, value);
+        }
+        else if (_cartridge->get_controller() == cartridge::controller::mbc3 && _ram_enabled
+            && _ram_bank >= RTC_SELECT && _ram_bank < RTC_SELECT + RTC_REGISTERS) {
+            _rtc[static_cast<std::size_t>(_ram_bank - RTC_SELECT)] = value;
+        }
+    }
+
+    byte memory::read_io(int address) const
+    {
+        const auto target = _io_handlers[address % PAGE_SIZE];
+        if (target != nullptr) {
+            _timed_reads += target->is_timed(address);
+            return target->read(address);
+        }
+
+        // the page is the last one kept, with or without a cartridge
+        const auto value = _data[_data.size() - PAGE_SIZE + address % PAGE_SIZE];
+        // the upper three bits of IF do not exist and read as 1
+        return address == INTERRUPT_FLAG ? static_cast<byte>(value | 0xE0) : value;
+    }
+
+    void memory::write_io(int address, byte value)
+    {
+        const auto target = _io_handlers[address % PAGE_SIZE];
+        if (target != nullptr) {
+            target->write(address, value);
+            return;
+        }
+
+        _data[_data.size() - PAGE_SIZE + address % PAGE_SIZE] = value;
+        // an interrupt may have become due, which the cpu looks at right after the current instruction
+        if (address == INTERRUPT_FLAG || address == INTERRUPT_ENABLE) {
+            _scheduler.schedule(scheduler::event::interrupt, _scheduler.get_now());
+        }
+    }
+
+    void memory::write_controller(int address, byte value)
     {
-        return _data[address];
+        const auto ram_enable = (value & 0x0F) == 0x0A;
+        switch (_cartridge->get_controller()) {
+        case cartridge::controller::none:
+            return;
+        case cartridge::controller::mbc1:
+            if (address < 0x2000) {
+                _ram_enabled = ram_enable;
+            }
+            else if (address < 0x4000) {
+                _rom_bank = value & 0x1F;
+            }
+            else if (address < 0x6000) {
+                _ram_bank = value & 0x03;
+            }
+            else {
+                _advanced_banking = (value & 0x01) != 0;
+            }
+            break;
+        case cartridge::controller::mbc3:
+            if (address < 0x2000) {
+                _ram_enabled = ram_enable;
+            }
+            else if (address < 0x4000) {
+                _rom_bank = value & 0x7F;
+            }
+            else if (address < 0x6000) {
+                _ram_bank = value;
+            }
+            else {
+                // writing 0 then 1 copies the clock into the registers reads see
+                if (_rtc_latch == 0x00 && value == 0x01) {
+                    _rtc_latched = _rtc;
+                }
+                _rtc_latch = value;
+                return;
+            }
+            break;
+        case cartridge::controller::mbc5:
+            if (address < 0x2000) {
+                _ram_enabled = ram_enable;
+            }
+            else if (address < 0x3000) {
+                _rom_bank = (_rom_bank & 0x100) | value;
+            }
+            else if (address < 0x4000) {
+                _rom_bank = (_rom_bank & 0xFF) | (value & 0x01) << 8;
+            }
+            else if (address < 0x6000) {
+                _ram_bank = value & 0x0F;
+            }
+            break;
+        }
+
+        remap(0, ROM_PAGES - 1);
+        remap(EXTERNAL_RAM_PAGE, WORK_RAM_PAGE - 1);
+    }
+
+    void memory::mark_code(int page)
+    {
+        _code_pages[page] = true;
+        _watched_pages[page] = true;
+        const auto alias = get_alias(page);
+        if (alias >= 0) {
+            _code_pages[alias] = true;
+            _watched_pages[alias] = true;
+        }
+    }
+
+    void memory::mark_register_code()
+    {
+        mark_code(IO_PAGE);
+        _register_code = true;
+    }
+
+    void memory::track_writes(int page)
+    {
+        _tracked_pages[page] = true;
+        _watched_pages[page] = true;
+        for (auto block = page * PAGE_SIZE / WRITE_BLOCK; block < (page + 1) * PAGE_SIZE / WRITE_BLOCK; ++block) {
+            _written[static_cast<std::size_t>(block / 64)] |= 1ull << (block % 64);
+        }
+    }
+
+    unsigned int memory::get_page_version(int page) const
+    {
+        return _page_versions[page];
     }
 
-    void memory::set_byte(int address, byte value)
+    void memory::write_code(int page)
     {
-        _data[address] = value;
+        _code_pages[page] = false;
+        _watched_pages[page] = _tracked_pages[page];
+        ++_page_versions[page];
+        if (page == IO_PAGE) {
+            _register_code = false;
+        }
+        const auto alias = get_alias(page);
+        if (alias >= 0) {
+            _code_pages[alias] = false;
+            _watched_pages[alias] = _tracked_pages[alias];
+            ++_page_versions[alias];
+        }
+        ++_code_writes;
+    }
+
+    void memory::write_watched(int address)
+    {
+        const auto page = address / PAGE_SIZE;
+        if (_tracked_pages[page]) {
+            const auto block = address / WRITE_BLOCK;
+            _written[static_cast<std::size_t>(block / 64)] |= 1ull << (block % 64);
+        }
+        // code on the I/O page is normally in HRAM, which a write to a register leaves alone
+        if (_code_pages[page]
+            && (page != IO_PAGE || _register_code || (address >= HIGH_RAM && address < INTERRUPT_ENABLE))) {
+            write_code(page);
+        }
+    }
+
+    int memory::get_alias(int page) const
+    {
+        if (!_cartridge) {
+            return -1;
+        }
+        if (page >= WORK_RAM_PAGE && page < WORK_RAM_PAGE + ECHO_END_PAGE - ECHO_PAGE) {
+            return page + ECHO_PAGE - WORK_RAM_PAGE;
+        }
+        if (page >= ECHO_PAGE && page < ECHO_END_PAGE) {
+            return page - ECHO_PAGE + WORK_RAM_PAGE;
+        }
+
+        return -1;
+    }
+
+    void memory::remap(int first, int last)
+    {
+        for (auto page = first; page <= last; ++page) {
+            const auto offset = get_offset(page);
+            const auto ram = offset >= 0 ? &_data[static_cast<std::size_t>(offset)] : nullptr;
+            if (page == IO_PAGE) {
+                _high_ram = _handlers[page] == nullptr ? ram : nullptr;
+            }
+            if (_handlers[page] != nullptr || page == IO_PAGE) {
+                map(page, nullptr, nullptr, 0);
+            }
+            else if (page < ROM_PAGES && _cartridge) {
+                const auto bank = get_rom_bank(page >= BANK_PAGES);
+                map(page, _cartridge->get_rom_bank(bank) + page % BANK_PAGES * PAGE_SIZE, nullptr, bank);
+            }
+            else if (page >= EXTERNAL_RAM_PAGE && page < WORK_RAM_PAGE && _cartridge) {
+                const auto bank = get_ram_bank();
+                if (bank >= 0) {
+                    const auto position = (static_cast<std::size_t>(bank) * cartridge::RAM_BANK_SIZE
+                        + static_cast<std::size_t>((page - EXTERNAL_RAM_PAGE) * PAGE_SIZE)) % _external_ram.size();
+                    map(page, &_external_ram[position], &_external_ram[position], 0);
+                }
+                else {
+                    map(page, nullptr, nullptr, 0);
+                }
+            }
+            else {
+                map(page, ram, ram, 0);
+            }
+        }
+    }
+
+    void memory::map(int page, const byte* read, byte* write, int bank)
+    {
+        const auto changed = read != _read_pages[page] || bank != _page_banks[page];
+        _read_pages[page] = read;
+        _write_pages[page] = write;
+        _page_banks[page] = bank;
+
+        // code decoded from the page is gone; for cartridge ROM it stays cached under its own bank
+        if (changed && _code_pages[page]) {
+            if (_cartridge && page < ROM_PAGES) {
+                ++_code_writes;
+            }
+            else {
+                write_code(page);
+            }
+        }
+    }
+
+    int memory::get_rom_bank(bool upper) const
+    {
+        auto bank = 0;
+        switch (_cartridge->get_controller()) {
+        case cartridge::controller::none:
+            bank = upper ? 1 : 0;
+            break;
+        case cartridge::controller::mbc1: {
+            // a bank number of 0 in the low five bits reads as 1, which makes 0x20, 0x40 and 0x60 unreachable
+            const auto low = (_rom_bank & 0x1F) == 0 ? 1 : _rom_bank & 0x1F;
+            bank = upper ? _ram_bank << 5 | low : _advanced_banking ? _ram_bank << 5 : 0;
+            break;
+        }
+        case cartridge::controller::mbc3:
+            bank = upper ? ((_rom_bank & 0x7F) == 0 ? 1 : _rom_bank & 0x7F) : 0;
+            break;
+        case cartridge::controller::mbc5:
+            bank = upper ? _rom_bank : 0;
+            break;
+        }
+
+        return bank % _cartridge->get_rom_banks();
+    }
+
+    int memory::get_ram_bank() const
+    {
+        if (_external_ram.empty()) {
+            return -1;
+        }
+
+        switch (_cartridge->get_controller()) {
+        case cartridge::controller::none:
+            return 0;
+        case cartridge::controller::mbc1:
+            return _ram_enabled ? (_advanced_banking ? _ram_bank : 0) : -1;
+        case cartridge::controller::mbc3:
+            return _ram_enabled && _ram_bank < RTC_SELECT ? _ram_bank : -1;
+        case cartridge::controller::mbc5:
+            return _ram_enabled ? _ram_bank : -1;
+        }
+
+        return -1;
+    }
+
+    int memory::get_offset(int page) const
+    {
+        if (!_cartridge) {
+            return page * PAGE_SIZE;
+        }
+
+        // echo RAM shows work RAM
+        const auto shown = page >= ECHO_PAGE && page < ECHO_END_PAGE ? page - ECHO_PAGE + WORK_RAM_PAGE : page;
+        if (shown >= VIDEO_RAM_PAGE && shown < EXTERNAL_RAM_PAGE) {
+            return (shown - VIDEO_RAM_PAGE) * PAGE_SIZE;
+        }
+        if (shown >= WORK_RAM_PAGE && shown < ECHO_PAGE) {
+            return 0x2000 + (shown - WORK_RAM_PAGE) * PAGE_SIZE;
+        }
+        if (shown >= ECHO_END_PAGE) {
+            return 0x4000 + (shown - ECHO_END_PAGE) * PAGE_SIZE;
+        }
+
+        return -1;
+    }
+
+    std::size_t memory::get_footprint() const
+    {
+        return sizeof(memory) + _data.capacity() + _external_ram.capacity();
+    }
+
+    byte* memory::relocate(const memory& other, const byte* pointer)
+    {
+        const auto data = other._data.data();
+        if (pointer >= data && pointer < data + other._data.size()) {
+            return _data.data() + (pointer - data);
+        }
+
+        const auto external = other._external_ram.data();
+        if (!other._external_ram.empty() && pointer >= external && pointer < external + other._external_ram.size()) {
+            return _external_ram.data() + (pointer - external);
+        }
+
+        return nullptr;
     }
-}
\ No newline at end of file
+}
@@ -2,17 +2,223 @@
 #define MEMORY_H
 
 #include <array>
+#include <cstddef>
 #include <limits>
+#include <memory>
+#include <vector>
 #include "byte.h"
+#include "cartridge.h"
+#include "scheduler.h"
 
 namespace gameboy {
+    // the 64 KiB address space through a table of 256-byte pages, with handlers for whatever is not plain memory
     class memory {
     public:
-        unsigned char get_byte(int address) const;
-        void set_byte(int address, byte value);
+        static constexpr auto PAGE_SIZE = 0x100;
+        static constexpr auto PAGE_COUNT = 0x100;
+        // registers below HRAM, and IE at its end
+        static constexpr auto IO_PAGE = 0xFF;
+        static constexpr auto INTERRUPT_FLAG = 0xFF0F;
+        static constexpr auto HIGH_RAM = 0xFF80;
+        static constexpr auto INTERRUPT_ENABLE = 0xFFFF;
+        // bits of IF and IE, in order of priority
+        static constexpr byte VBLANK_INTERRUPT = 0x01;
+        static constexpr byte STAT_INTERRUPT = 0x02;
+        static constexpr byte TIMER_INTERRUPT = 0x04;
+        static constexpr byte SERIAL_INTERRUPT = 0x08;
+        static constexpr byte JOYPAD_INTERRUPT = 0x10;
+        // what track_writes() tells apart, a tile's worth
+        static constexpr auto WRITE_BLOCK = 16;
+
+        // takes over every access to the pages it is registered for
+        class handler {
+        public:
+            virtual ~handler() = default;
+            virtual byte read(int address) = 0;
+            virtual void write(int address, byte value) = 0;
+            // whether address reads differently as time passes without an event in between, like a register the
+            // device works out from the clock; the CPU never skips a loop that polls one
+            virtual bool is_timed(int) const
+            {
+                return false;
+            }
+        };
+
+        // 64 KiB of plain RAM until a cartridge is inserted
+        memory();
+        // copies get the contents, registers and pending events and share the cartridge ROM, but start out without
+        // handlers, in memory or in the scheduler, so that they never drive the devices of the original
+        memory(const memory& other);
+        memory& operator=(const memory& other);
+
+        // maps the cartridge's ROM and RAM behind the bank controller its header names, and echo RAM over
+        // 0xE000-0xFDFF; the cartridge RAM is zeroed, and from then on memory only keeps the RAM inside the console
+        void insert(std::shared_ptr<const cartridge> inserted);
+        // nullptr hands the page back to memory
+        void set_handler(int page, handler* target);
+        // takes over a single register of the I/O page, 0xFF00-0xFF7F; a handler for the whole page comes first
+        void set_io_handler(int address, handler* target);
+        // sets bits in IF, for devices
+        void request_interrupt(byte mask);
+
+        scheduler& get_scheduler()
+        {
+            return _scheduler;
+        }
+
+        const scheduler& get_scheduler() const
+        {
+            return _scheduler;
+        }
+
+        unsigned char get_byte(int address) const
+        {
+            const auto page = _read_pages[address / PAGE_SIZE];
+            if (page != nullptr) {
+                return page[address % PAGE_SIZE];
+            }
+
+            return is_high_ram(address) ? _high_ram[address % PAGE_SIZE] : read_handled(address);
+        }
+
+        // what memory itself holds at address, without asking a handler: registers a device keeps read as last
+        // written to memory, and pages with nothing behind them as 0xFF
+        byte peek_byte(int address) const;
+
+        void set_byte(int address, byte value)
+        {
+            const auto page = address / PAGE_SIZE;
+            auto target = _write_pages[page];
+            if (target == nullptr) {
+                if (!is_high_ram(address)) {
+                    write_handled(address, value);
+                    return;
+                }
+                target = _high_ram;
+            }
+
+            target[address % PAGE_SIZE] = value;
+            if (_watched_pages[page]) {
+                write_watched(address);
+            }
+        }
+
+        // the ROM bank a page of cartridge ROM shows, and 0 for every other page; cached decodes are kept per bank
+        int get_page_bank(int page) const
+        {
+            return _page_banks[page];
+        }
+
+        // pages marked as code get a new version on their next write, which is how cached decodes notice
+        void mark_code(int page);
+        // code decoded from the I/O registers rather than HRAM, odd as it is, makes writes to them count as code writes
+        // too; otherwise only writes to HRAM do on that page
+        void mark_register_code();
+        // tracked pages note which WRITE_BLOCK bytes of them are written to, for a device keeping something worked out
+        // from their contents; every block starts out written
+        void track_writes(int page);
+        // whether the block at address, a multiple of WRITE_BLOCK, was written since the last call for it
+        bool take_write(int address)
+        {
+            const auto block = address / WRITE_BLOCK;
+            auto& word = _written[static_cast<std::size_t>(block / 64)];
+            const auto bit = 1ull << (block % 64);
+            const auto written = (word & bit) != 0;
+            word &= ~bit;
+            return written;
+        }
+        // take_write() for the 64 blocks from address on, a multiple of 64 * WRITE_BLOCK, as the bits of the result
+        unsigned long long take_writes(int address)
+        {
+            auto& word = _written[static_cast<std::size_t>(address / WRITE_BLOCK / 64)];
+            const auto written = word;
+            word = 0;
+            return written;
+        }
+        unsigned int get_page_version(int page) const;
+        // number of writes so far that hit a page marked as code, bank switches under it included, plus the
+        // events scheduled ahead of the earliest one; either way, code running towards the next event has to stop
+        unsigned int get_code_writes() const
+        {
+            return _code_writes + _scheduler.get_preemptions();
+        }
+
+        // number of reads so far from registers whose handler says they are timed
+        unsigned int get_timed_reads() const
+        {
+            return _timed_reads;
+        }
+
+        // bytes this instance takes up, leaving out the cartridge ROM it shares
+        std::size_t get_footprint() const;
     private:
-        std::array<byte, std::numeric_limits<unsigned short>::max() - std::numeric_limits<unsigned short>::min() + 1> _data;
+        static constexpr auto ADDRESS_SPACE = std::numeric_limits<unsigned short>::max() + 1;
+        // VRAM, WRAM and 0xFE00-0xFFFF, one after the other
+        static constexpr auto CONSOLE_RAM = 0x4200;
+        static constexpr auto RTC_REGISTERS = 5;
+
+        // 0xFF80-0xFFFE, which shares the I/O page but has no registers in it, while no handler takes the whole page
+        bool is_high_ram(int address) const
+        {
+            return address >= HIGH_RAM && address < INTERRUPT_ENABLE && _high_ram != nullptr;
+        }
+        byte read_handled(int address) const;
+        void write_handled(int address, byte value);
+        void write_controller(int address, byte value);
+        byte read_io(int address) const;
+        void write_io(int address, byte value);
+        void write_code(int page);
+        // a write into a page marked as code or tracked
+        void write_watched(int address);
+        // the page holding the same bytes through echo RAM, or -1
+        int get_alias(int page) const;
+
+        // points the pages at whatever the controller selects, or at their handlers
+        void remap(int first, int last);
+        void map(int page, const byte* read, byte* write, int bank);
+        // the banks the controller selects for 0x4000-0x7FFF or 0x0000-0x3FFF, and for cartridge RAM, where -1
+        // means it cannot be accessed directly
+        int get_rom_bank(bool upper) const;
+        int get_ram_bank() const;
+        // where the page is kept in _data, or -1 for pages a cartridge provides
+        int get_offset(int page) const;
+        // the place in this memory's RAM that pointer has in other's, or nullptr when it points into ROM
+        byte* relocate(const memory& other, const byte* pointer);
+
+        // the whole address space until a cartridge is inserted, CONSOLE_RAM after
+        std::vector<byte> _data;
+        std::array<const byte*, PAGE_COUNT> _read_pages;
+        std::array<byte*, PAGE_COUNT> _write_pages;
+        std::array<int, PAGE_COUNT> _page_banks;
+        std::array<handler*, PAGE_COUNT> _handlers;
+        std::array<handler*, PAGE_SIZE> _io_handlers;
+        // where the I/O page is kept, or nullptr while a handler takes the whole page
+        byte* _high_ram;
+        std::array<bool, PAGE_COUNT> _code_pages;
+        bool _register_code;
+        std::array<bool, PAGE_COUNT> _tracked_pages;
+        // either of the two, which is all a write has to look at
+        std::array<bool, PAGE_COUNT> _watched_pages;
+        // a bit for each block of tracked pages
+        std::array<unsigned long long, ADDRESS_SPACE / WRITE_BLOCK / 64> _written;
+        std::array<unsigned int, PAGE_COUNT> _page_versions;
+        unsigned int _code_writes;
+        mutable unsigned int _timed_reads;
+        scheduler _scheduler;
+
+        std::shared_ptr<const cartridge> _cartridge;
+        std::vector<byte> _external_ram;
+        // the bank registers as written, before the controller masks and combines them
+        int _rom_bank;
+        int _ram_bank;
+        bool _ram_enabled;
+        // MBC1: whether the upper two bits also select the RAM bank and the bank over 0x0000-0x3FFF
+        bool _advanced_banking;
+        // MBC3: the clock does not run, but its registers can be written, latched and read back
+        std::array<byte, RTC_REGISTERS> _rtc;
+        std::array<byte, RTC_REGISTERS> _rtc_latched;
+        byte _rtc_latch;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,88 @@
+#include "opcode-profile.h"
+#include <algorithm>
+#include "cpu.h"
+
+namespace gameboy {
+    opcode_profile::opcode_profile() : _next(-1)
+    {
+    }
+
+    int opcode_profile::read_instruction(const memory& mem, unsigned short address)
+    {
+        const auto opcode = static_cast<byte>(mem.get_byte(address));
+        return opcode == 0xCB ? 0x100 | static_cast<byte>(mem.get_byte((address + 1) & 0xFFFF)) : opcode;
+    }
+
+    void opcode_profile::record(const memory& mem, unsigned short address)
+    {
+        record(read_instruction(mem, address), address);
+    }
+
+    void opcode_profile::record(int instruction, unsigned short address)
+    {
+        if (address != _next) {
+            _window.clear();
+        }
+
+        const auto& info = cpu::get_opcode_info(static_cast<byte>(instruction > 0xFF ? 0xCB : instruction));
+        if (_window.size() == MAX_LENGTH) {
+            _window.erase(_window.begin());
+        }
+        _window.push_back(instruction);
+
+        // every run ending here
+        auto instructions = 0ull;
+        for (std::size_t length = 1; length <= _window.size(); ++length) {
+            instructions |= static_cast<unsigned long long>(_window[_window.size() - length]) << 9 * (length - 1);
+            ++_counts[1ull << 9 * length | instructions];
+        }
+
+        if (info.ends_block) {
+            _window.clear();
+        }
+        _next = (address + info.length) & 0xFFFF;
+    }
+
+    unsigned long long opcode_profile::get_count(const sequence& instructions) const
+    {
+        const auto found = _counts.find(key(instructions));
+        return found == _counts.end() ? 0 : found->second;
+    }
+
+    std::vector<std::pair<opcode_profile::sequence, unsigned long long>> opcode_profile::get_top(std::size_t length,
+        std::size_t count) const
+    {
+        std::vector<std::pair<sequence, unsigned long long>> top;
+        for (const auto& entry : _counts) {
+            if (entry.first >> (9 * length) != 1) {
+                continue;
+            }
+
+            sequence instructions(length);
+            for (std::size_t index = 0; index < length; ++index) {
+                instructions[index] = static_cast<int>(entry.first >> (9 * (length - 1 - index)) & 0x1FF);
+            }
+            top.emplace_back(std::move(instructions), entry.second);
+        }
+
+        std::sort(top.begin(), top.end(), [](const std::pair<sequence, unsigned long long>& left,
+            const std::pair<sequence, unsigned long long>& right) {
+            return left.second != right.second ? left.second > right.second : left.first < right.first;
+        });
+        if (top.size() > count) {
+            top.resize(count);
+        }
+
+        return top;
+    }
+
+    unsigned long long opcode_profile::key(const sequence& instructions)
+    {
+        auto result = 1ull;
+        for (const auto instruction : instructions) {
+            result = result << 9 | static_cast<unsigned long long>(instruction);
+        }
+
+        return result;
+    }
+}
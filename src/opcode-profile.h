@@ -0,0 +1,43 @@
+#ifndef OPCODE_PROFILE_H
+#define OPCODE_PROFILE_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "memory.h"
+
+namespace gameboy {
+    // counts how often each run of consecutive instructions executes, to choose the sequences cpu fuses. Like a
+    // fused sequence, a run never continues past an instruction that ends a block, nor across a jump or interrupt.
+    class opcode_profile {
+    public:
+        static constexpr auto MAX_LENGTH = 4;
+
+        // an instruction as counted: its opcode, or 0x100 | the prefixed opcode for 0xCB
+        using sequence = std::vector<int>;
+
+        // the instruction at address, as counted
+        static int read_instruction(const memory& mem, unsigned short address);
+
+        opcode_profile();
+        // the instruction about to execute at address
+        void record(const memory& mem, unsigned short address);
+        // instruction, read from address before it executed
+        void record(int instruction, unsigned short address);
+        unsigned long long get_count(const sequence& instructions) const;
+        // runs of the given length, most frequent first
+        std::vector<std::pair<sequence, unsigned long long>> get_top(std::size_t length, std::size_t count) const;
+    private:
+        // 9 bits an instruction below a leading 1, which gives away the length
+        static unsigned long long key(const sequence& instructions);
+
+        std::unordered_map<unsigned long long, unsigned long long> _counts;
+        // the run so far, oldest first
+        sequence _window;
+        // where the run carries on if nothing jumps
+        int _next;
+    };
+}
+
+#endif
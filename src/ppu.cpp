@@ -0,0 +1,396 @@
+#include "ppu.h"
+#include <algorithm>
+#include <chrono>
+#include <initializer_list>
+
+namespace gameboy {
+    namespace {
+        // LCDC
+        constexpr byte BACKGROUND_ENABLE = 0x01;
+        constexpr byte OBJECT_ENABLE = 0x02;
+        constexpr byte TALL_OBJECTS = 0x04;
+        constexpr byte WINDOW_ENABLE = 0x20;
+        constexpr byte DISPLAY_ENABLE = 0x80;
+
+        // STAT, with the mode in the low two bits
+        constexpr byte MATCH = 0x04;
+        constexpr byte HBLANK_SOURCE = 0x08;
+        constexpr byte VBLANK_SOURCE = 0x10;
+        constexpr byte SCAN_SOURCE = 0x20;
+        constexpr byte MATCH_SOURCE = 0x40;
+        constexpr byte SOURCES = 0x78;
+        constexpr byte UNUSED = 0x80;
+
+        constexpr auto HBLANK = 0;
+        constexpr auto VBLANK = 1;
+        constexpr auto SCAN = 2;
+        constexpr auto TRANSFER = 3;
+
+        constexpr auto OAM = 0xFE00;
+        // the window's left edge is WX - 7
+        constexpr auto WINDOW_OFFSET = 7;
+        // mode 3 is paused this long for the window, and sprites pause it for between 6 and 11 cycles depending on
+        // where they fall against the background tiles being fetched
+        constexpr auto WINDOW_PENALTY = 6;
+        constexpr auto SPRITE_PENALTY = 6;
+    }
+
+    ppu::ppu(memory& bus, tile_decoder::kernel decoding) : _bus(bus), _control(0x91), _status(0),
+        _scroll_y(0), _scroll_x(0), _line(0), _line_compare(0), _background_palette(0xFC), _object_palettes{{0xFF, 0xFF}},
+        _window_y(0), _window_x(0), _mode(HBLANK), _interrupt_line(false), _window_line(0), _rendering(true),
+        _render_next(true), _sprites{}, _sprite_count(0), _frames(0), _renderer(decoding), _sent(0), _done(0)
+    {
+        for (auto address = LCD_CONTROL; address <= WINDOW_X; ++address) {
+            // OAM DMA is not the PPU's
+            if (address != LINE_COMPARE + 1) {
+                _bus.set_io_handler(address, this);
+            }
+        }
+        for (auto page = line_renderer::VRAM / memory::PAGE_SIZE;
+            page < (line_renderer::VRAM + line_renderer::VRAM_SIZE) / memory::PAGE_SIZE; ++page) {
+            _bus.track_writes(page);
+        }
+        _bus.get_scheduler().set_handler(scheduler::event::video_line, this);
+        _bus.get_scheduler().set_handler(scheduler::event::video_mode, this);
+        start_line(0, _bus.get_scheduler().get_now());
+    }
+
+    ppu::~ppu()
+    {
+        enable_threading(false);
+        for (auto address = LCD_CONTROL; address <= WINDOW_X; ++address) {
+            if (address != LINE_COMPARE + 1) {
+                _bus.set_io_handler(address, nullptr);
+            }
+        }
+        auto& events = _bus.get_scheduler();
+        for (const auto kind : {scheduler::event::video_line, scheduler::event::video_mode}) {
+            events.set_handler(kind, nullptr);
+            events.cancel(kind);
+        }
+    }
+
+    byte ppu::read(int address)
+    {
+        switch (address) {
+        case LCD_CONTROL:
+            return _control;
+        case LCD_STATUS:
+            return static_cast<byte>(UNUSED | _status | (_line == _line_compare ? MATCH : 0) | _mode);
+        case SCROLL_Y:
+            return _scroll_y;
+        case SCROLL_X:
+            return _scroll_x;
+        case LINE:
+            return static_cast<byte>(_line);
+        case LINE_COMPARE:
+            return _line_compare;
+        case BACKGROUND_PALETTE:
+            return _background_palette;
+        case OBJECT_PALETTE_0:
+        case OBJECT_PALETTE_1:
+            return _object_palettes[static_cast<std::size_t>(address - OBJECT_PALETTE_0)];
+        case WINDOW_Y:
+            return _window_y;
+        default:
+            return _window_x;
+        }
+    }
+
+    void ppu::write(int address, byte value)
+    {
+        switch (address) {
+        case LCD_CONTROL: {
+            const auto was_enabled = enabled();
+            _control = value;
+            if (was_enabled && !enabled()) {
+                // LY stays at 0 in HBlank until the display comes back on
+                auto& events = _bus.get_scheduler();
+                events.cancel(scheduler::event::video_line);
+                events.cancel(scheduler::event::video_mode);
+                _line = 0;
+                set_mode(HBLANK);
+            }
+            else if (!was_enabled && enabled()) {
+                start_line(0, _bus.get_scheduler().get_now());
+            }
+            return;
+        }
+        case LCD_STATUS:
+            _status = static_cast<byte>(value & SOURCES);
+            break;
+        case SCROLL_Y:
+            _scroll_y = value;
+            return;
+        case SCROLL_X:
+            _scroll_x = value;
+            return;
+        case LINE:
+            // read only
+            return;
+        case LINE_COMPARE:
+            _line_compare = value;
+            break;
+        case BACKGROUND_PALETTE:
+            _background_palette = value;
+            return;
+        case OBJECT_PALETTE_0:
+        case OBJECT_PALETTE_1:
+            _object_palettes[static_cast<std::size_t>(address - OBJECT_PALETTE_0)] = value;
+            return;
+        case WINDOW_Y:
+            _window_y = value;
+            return;
+        default:
+            _window_x = value;
+            return;
+        }
+
+        update_interrupt();
+    }
+
+    void ppu::run(scheduler::event kind, unsigned long long timestamp)
+    {
+        if (kind == scheduler::event::video_line) {
+            start_line((_line + 1) % LINES, timestamp);
+        }
+        else if (_mode == SCAN) {
+            start_transfer(timestamp);
+        }
+        else {
+            if (_rendering) {
+                render_line(_line);
+            }
+            set_mode(HBLANK);
+        }
+    }
+
+    const ppu::frame& ppu::get_frame() const
+    {
+        wait_for_lines();
+        return _renderer.get_frame();
+    }
+
+    unsigned long long ppu::get_frames() const
+    {
+        return _frames;
+    }
+
+    const tile_decoder& ppu::get_decoder() const
+    {
+        return _renderer.get_decoder();
+    }
+
+    void ppu::set_rendering(bool rendering)
+    {
+        _render_next = rendering;
+    }
+
+    bool ppu::is_rendering() const
+    {
+        return _rendering;
+    }
+
+    void ppu::enable_threading(bool enabled)
+    {
+        if (enabled == _worker.joinable()) {
+            return;
+        }
+
+        if (enabled) {
+            _worker = std::thread{&ppu::draw_lines, this};
+        }
+        else {
+            command stop;
+            stop.type = command::kind::stop;
+            send(stop);
+            _worker.join();
+        }
+    }
+
+    void ppu::set_framebuffer(framebuffer* output)
+    {
+        // the thread only looks at the renderer again for what is sent after this
+        wait_for_lines();
+        _renderer.set_output(output);
+    }
+
+    void ppu::render_line(int line)
+    {
+        send_writes();
+        command next;
+        next.type = command::kind::line;
+        auto& state = next.state;
+        state = {line, _window_line, _control, _scroll_y, _scroll_x, _background_palette, _object_palettes, _window_y,
+            _window_x, _sprite_count, _sprites};
+        if (line_renderer::shows_window(state)) {
+            ++_window_line;
+        }
+        send(next);
+    }
+
+    bool ppu::enabled() const
+    {
+        return (_control & DISPLAY_ENABLE) != 0;
+    }
+
+    void ppu::start_line(int line, unsigned long long timestamp)
+    {
+        auto& events = _bus.get_scheduler();
+        _line = line;
+        events.schedule(scheduler::event::video_line, timestamp + LINE_CYCLES);
+        if (line < HEIGHT) {
+            if (line == 0) {
+                _window_line = 0;
+                _rendering = _render_next;
+            }
+            events.schedule(scheduler::event::video_mode, timestamp + SCAN_CYCLES);
+            set_mode(SCAN);
+        }
+        else if (line == HEIGHT) {
+            ++_frames;
+            _bus.request_interrupt(memory::VBLANK_INTERRUPT);
+            set_mode(VBLANK);
+        }
+        else {
+            update_interrupt();
+        }
+    }
+
+    void ppu::start_transfer(unsigned long long timestamp)
+    {
+        select_sprites();
+        _bus.get_scheduler().schedule(scheduler::event::video_mode,
+            timestamp + static_cast<unsigned long long>(get_transfer_cycles()));
+        set_mode(TRANSFER);
+    }
+
+    void ppu::set_mode(int mode)
+    {
+        _mode = mode;
+        update_interrupt();
+    }
+
+    void ppu::update_interrupt()
+    {
+        const auto line = enabled() && (((_status & MATCH_SOURCE) != 0 && _line == _line_compare)
+            || ((_status & HBLANK_SOURCE) != 0 && _mode == HBLANK)
+            || ((_status & VBLANK_SOURCE) != 0 && _mode == VBLANK)
+            || ((_status & SCAN_SOURCE) != 0 && _mode == SCAN));
+        if (line && !_interrupt_line) {
+            _bus.request_interrupt(memory::STAT_INTERRUPT);
+        }
+        _interrupt_line = line;
+    }
+
+    // the first ten in OAM that overlap the line, whether they are on screen horizontally or not
+    void ppu::select_sprites()
+    {
+        line_compositor::positions ys{};
+        for (auto index = 0; index < line_compositor::OAM_ENTRIES; ++index) {
+            ys[static_cast<std::size_t>(index)] = _bus.get_byte(OAM + index * 4);
+        }
+
+        const auto height = (_control & TALL_OBJECTS) != 0 ? 16 : 8;
+        _sprite_count = 0;
+        for (auto found = _renderer.get_compositor().scan(ys, _line, height); found != 0 && _sprite_count < LINE_SPRITES;
+            found &= found - 1) {
+            const auto address = OAM + __builtin_ctzll(found) * 4;
+            _sprites[static_cast<std::size_t>(_sprite_count++)] = {_bus.get_byte(address), _bus.get_byte(address + 1),
+                _bus.get_byte(address + 2), _bus.get_byte(address + 3)};
+        }
+    }
+
+    int ppu::get_transfer_cycles() const
+    {
+        auto cycles = TRANSFER_CYCLES + (_scroll_x & 7);
+        if ((_control & (BACKGROUND_ENABLE | WINDOW_ENABLE)) == (BACKGROUND_ENABLE | WINDOW_ENABLE) && _line >= _window_y
+            && _window_x - WINDOW_OFFSET < WIDTH) {
+            cycles += WINDOW_PENALTY;
+        }
+        if ((_control & OBJECT_ENABLE) != 0) {
+            for (auto index = 0; index < _sprite_count; ++index) {
+                // the usual estimate: up to 5 more when the sprite starts early in a background tile
+                const auto offset = (_sprites[static_cast<std::size_t>(index)].x + _scroll_x) & 7;
+                cycles += SPRITE_PENALTY + std::max(0, 5 - offset);
+            }
+        }
+
+        return cycles;
+    }
+
+    void ppu::send_writes()
+    {
+        constexpr auto BLOCKS = 64 * memory::WRITE_BLOCK;
+        command next;
+        next.type = command::kind::block;
+        for (auto address = line_renderer::VRAM; address < line_renderer::VRAM + line_renderer::VRAM_SIZE; address += BLOCKS) {
+            for (auto written = _bus.take_writes(address); written != 0; written &= written - 1) {
+                next.address = address + __builtin_ctzll(written) * memory::WRITE_BLOCK;
+                for (auto offset = 0; offset < line_renderer::BLOCK_SIZE; ++offset) {
+                    next.data[static_cast<std::size_t>(offset)] = _bus.get_byte(next.address + offset);
+                }
+                send(next);
+            }
+        }
+    }
+
+    void ppu::send(const command& next)
+    {
+        if (!_worker.joinable()) {
+            carry_out(next);
+            return;
+        }
+
+        while (!_commands.try_push(next)) {
+            std::this_thread::yield();
+        }
+        if (next.type != command::kind::stop) {
+            ++_sent;
+        }
+    }
+
+    void ppu::carry_out(const command& next)
+    {
+        if (next.type == command::kind::block) {
+            _renderer.write_block(next.address, next.data.data());
+        }
+        else {
+            _renderer.render(next.state);
+        }
+    }
+
+    void ppu::wait_for_lines() const
+    {
+        while (_done.load(std::memory_order_acquire) != _sent) {
+            std::this_thread::yield();
+        }
+    }
+
+    void ppu::draw_lines()
+    {
+        command next;
+        auto done = _done.load(std::memory_order_relaxed);
+        auto idle = 0;
+        for (;;) {
+            if (!_commands.try_pop(next)) {
+                // a while spent on yielding to the emulation catching up, and then on not holding a core when it is
+                // paused
+                if (++idle < 1000) {
+                    std::this_thread::yield();
+                }
+                else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+                continue;
+            }
+
+            idle = 0;
+            if (next.type == command::kind::stop) {
+                return;
+            }
+            carry_out(next);
+            _done.store(++done, std::memory_order_release);
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef PPU_H
+#define PPU_H
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include "byte.h"
+#include "line-renderer.h"
+#include "memory.h"
+#include "scheduler.h"
+#include "spsc-ring.h"
+#include "tile-decoder.h"
+
+namespace gameboy {
+    // the original Game Boy's LCD controller, moving LY and STAT on only at events and drawing lines as mode 3 ends
+    class ppu : public memory::handler, public scheduler::handler {
+    public:
+        static constexpr auto LCD_CONTROL = 0xFF40;
+        static constexpr auto LCD_STATUS = 0xFF41;
+        static constexpr auto SCROLL_Y = 0xFF42;
+        static constexpr auto SCROLL_X = 0xFF43;
+        static constexpr auto LINE = 0xFF44;
+        static constexpr auto LINE_COMPARE = 0xFF45;
+        static constexpr auto BACKGROUND_PALETTE = 0xFF47;
+        static constexpr auto OBJECT_PALETTE_0 = 0xFF48;
+        static constexpr auto OBJECT_PALETTE_1 = 0xFF49;
+        static constexpr auto WINDOW_Y = 0xFF4A;
+        static constexpr auto WINDOW_X = 0xFF4B;
+
+        static constexpr auto WIDTH = line_renderer::WIDTH;
+        static constexpr auto HEIGHT = line_renderer::HEIGHT;
+        static constexpr auto LINES = 154;
+        static constexpr auto LINE_CYCLES = 456;
+        static constexpr auto FRAME_CYCLES = LINES * LINE_CYCLES;
+        // mode 2 always takes this long, and mode 3 at least the other
+        static constexpr auto SCAN_CYCLES = 80;
+        static constexpr auto TRANSFER_CYCLES = 172;
+        static constexpr auto LINE_SPRITES = line_renderer::LINE_SPRITES;
+
+        using frame = line_renderer::frame;
+
+        // registers itself with the bus and its scheduler for as long as it lives, with the registers as the boot
+        // ROM leaves them and line 0 starting now
+        ppu(memory& bus, tile_decoder::kernel decoding = tile_decoder::best());
+        ~ppu() override;
+        ppu(const ppu&) = delete;
+        ppu& operator=(const ppu&) = delete;
+
+        byte read(int address) override;
+        void write(int address, byte value) override;
+        void run(scheduler::event kind, unsigned long long timestamp) override;
+
+        // complete from the start of VBlank until line 0 is drawn again; with threading, this waits for the lines
+        // sent so far to be drawn
+        const frame& get_frame() const;
+        // VBlanks so far
+        unsigned long long get_frames() const;
+        const tile_decoder& get_decoder() const;
+        // draws line with the registers and sprites as they are now, which is what the end of mode 3 does
+        void render_line(int line);
+        // whether frames from the next one on are drawn; the ones that are not keep all of their timing and
+        // interrupts, and get_frame() keeps the last frame drawn
+        void set_rendering(bool rendering);
+        // whether the current frame is being drawn
+        bool is_rendering() const;
+        // draws lines on a thread of its own, for the same frames, while this goes on with the next ones
+        void enable_threading(bool enabled);
+        // draws lines into output too, as host pixels, from the next one on; nullptr to stop
+        void set_framebuffer(framebuffer* output);
+    private:
+        // what goes to the renderer, a block of VRAM or a line to draw
+        struct command {
+            enum class kind {
+                block,
+                line,
+                // the thread drawing lines has to return
+                stop
+            };
+
+            kind type;
+            int address;
+            std::array<byte, line_renderer::BLOCK_SIZE> data;
+            line_renderer::line_state state;
+        };
+
+        bool enabled() const;
+        void start_line(int line, unsigned long long timestamp);
+        // mode 3 starting: picks the line's sprites from OAM and works out when the mode ends
+        void start_transfer(unsigned long long timestamp);
+        void set_mode(int mode);
+        // raises the STAT interrupt when one of the conditions it is enabled for starts to hold
+        void update_interrupt();
+        void select_sprites();
+        int get_transfer_cycles() const;
+        // the VRAM blocks written since the last line, for the renderer
+        void send_writes();
+        void send(const command& next);
+        void carry_out(const command& next);
+        // the thread drawing lines
+        void draw_lines();
+        // until the thread drawing lines has done everything sent to it
+        void wait_for_lines() const;
+
+        memory& _bus;
+        byte _control;
+        // only the interrupt enable bits; the rest is worked out when read
+        byte _status;
+        byte _scroll_y;
+        byte _scroll_x;
+        int _line;
+        byte _line_compare;
+        byte _background_palette;
+        std::array<byte, 2> _object_palettes;
+        byte _window_y;
+        byte _window_x;
+        int _mode;
+        // the OR of the STAT interrupt conditions, which only requests an interrupt going from false to true
+        bool _interrupt_line;
+        // window lines drawn so far this frame, which is the line of the window the next one shows
+        int _window_line;
+        // set_rendering() as of the start of the frame, and as it will be for the next one
+        bool _rendering;
+        bool _render_next;
+        std::array<line_renderer::sprite, LINE_SPRITES> _sprites;
+        int _sprite_count;
+        unsigned long long _frames;
+        // only used by the thread drawing lines while there is one, but for its compositor's OAM scans
+        line_renderer _renderer;
+        spsc_ring<command, 1024> _commands;
+        std::thread _worker;
+        // commands sent to the thread, and those it has carried out
+        unsigned long long _sent;
+        std::atomic<unsigned long long> _done;
+    };
+}
+
+#endif
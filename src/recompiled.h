@@ -0,0 +1,23 @@
+#ifndef RECOMPILED_H
+#define RECOMPILED_H
+
+namespace gameboy {
+    class cpu;
+
+    // a block translated ahead of time by gameboy-recompile; running it has the same effect as cpu::run_block()
+    // on the block decoded at the same address
+    struct recompiled_block {
+        unsigned short address;
+        // cycles of every instruction but the last, which is the only one allowed to branch
+        int cycles;
+        // pages the block was read from; a write into either makes the cpu fall back to the interpreter
+        int first_page;
+        int last_page;
+        // ROM banks mapped over those pages when the ROM was walked; with any other bank there, it is other code
+        int first_bank;
+        int last_bank;
+        int (*run)(cpu&);
+    };
+}
+
+#endif
@@ -0,0 +1,199 @@
+#include "recompiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include "cpu.h"
+
+namespace gameboy {
+    namespace {
+        bool writes_memory(const static_instruction& decoded)
+        {
+            return decoded.opcode == 0xCB ? cpu::get_prefixed_info(static_cast<byte>(decoded.operand)).writes
+                : cpu::get_opcode_info(decoded.opcode).writes;
+        }
+    }
+
+    recompiler::recompiler(const memory& rom) : _rom(rom)
+    {
+        _pending.push_back(0x0100);
+        for (auto vector = 0x00; vector <= 0x60; vector += 0x08) {
+            _pending.push_back(static_cast<unsigned short>(vector));
+        }
+    }
+
+    void recompiler::add_entry(unsigned short address)
+    {
+        _pending.push_back(address);
+    }
+
+    void recompiler::walk()
+    {
+        while (!_pending.empty()) {
+            const auto address = _pending.back();
+            _pending.pop_back();
+            if (address < ROM_END && _blocks.find(address) == _blocks.end()) {
+                decode(address);
+            }
+        }
+    }
+
+    const std::map<unsigned short, static_block>& recompiler::get_blocks() const
+    {
+        return _blocks;
+    }
+
+    void recompiler::decode(unsigned short address)
+    {
+        static_block target{address, {}, 0};
+        auto program_counter = static_cast<int>(address);
+        auto elapsed = 0;
+        for (;;) {
+            const auto opcode = static_cast<byte>(_rom.get_byte(program_counter));
+            const auto& info = cpu::get_opcode_info(opcode);
+            // an instruction running off the end of ROM is left to the interpreter
+            if (program_counter + info.length > ROM_END) {
+                break;
+            }
+
+            static_instruction decoded{opcode, 0, static_cast<unsigned short>(program_counter + info.length)};
+            if (info.length == 2) {
+                decoded.operand = _rom.get_byte(program_counter + 1);
+            }
+            else if (info.length == 3) {
+                decoded.operand = static_cast<unsigned short>(make_address(_rom.get_byte(program_counter + 2),
+                    _rom.get_byte(program_counter + 1)));
+            }
+
+            target.cycles = elapsed;
+            elapsed += opcode == 0xCB ? cpu::get_prefixed_info(static_cast<byte>(decoded.operand)).duration : info.duration;
+            target.instructions.push_back(decoded);
+            if (info.ends_block) {
+                break;
+            }
+
+            program_counter = decoded.next;
+            if (target.instructions.size() == BLOCK_LIMIT) {
+                _pending.push_back(decoded.next);
+                break;
+            }
+        }
+
+        if (target.instructions.empty()) {
+            return;
+        }
+
+        const auto& last = target.instructions.back();
+        const auto opcode = last.opcode;
+        if (!cpu::get_opcode_info(opcode).ends_block) {
+            // cut at the limit or the end of ROM
+            _blocks.emplace(address, std::move(target));
+            return;
+        }
+
+        const auto relative = static_cast<unsigned short>(last.next + static_cast<sbyte>(last.operand));
+        if (opcode == 0x18 || opcode == 0xC3) {
+            // JR e, JP nn
+            _pending.push_back(opcode == 0x18 ? relative : last.operand);
+        }
+        else if ((opcode & 0xE7) == 0x20) {
+            // JR cc, e
+            _pending.push_back(relative);
+            _pending.push_back(last.next);
+        }
+        else if ((opcode & 0xE7) == 0xC2 || (opcode & 0xE7) == 0xC4 || opcode == 0xCD) {
+            // JP cc, nn and CALL, which returns to the following instruction
+            _pending.push_back(last.operand);
+            _pending.push_back(last.next);
+        }
+        else if ((opcode & 0xC7) == 0xC7) {
+            // RST
+            _pending.push_back(static_cast<unsigned short>(opcode & 0x38));
+            _pending.push_back(last.next);
+        }
+        else if (opcode != 0xC9 && opcode != 0xD9 && opcode != 0xE9) {
+            // RET cc, EI, DI and the like carry on with the next instruction; RET, RETI and JP (HL) go who knows where
+            _pending.push_back(last.next);
+        }
+
+        _blocks.emplace(address, std::move(target));
+    }
+
+    void recompiler::write(std::ostream& output, const std::string& name) const
+    {
+        const auto hex = [](unsigned int value, int width) {
+            std::ostringstream text;
+            text << "0x" << std::uppercase << std::hex << std::setw(width) << std::setfill('0') << value;
+            return text.str();
+        };
+        const auto function = [&hex](unsigned short address) {
+            return "block_" + hex(address, 4).substr(2);
+        };
+
+        output << "// generated by gameboy-recompile, do not edit\n"
+            << "#include <cstddef>\n"
+            << "#include \"cpu-handlers.h\"\n"
+            << "#include \"recompiled.h\"\n\n"
+            << "namespace gameboy {\n"
+            << "    namespace {\n";
+        for (const auto& entry : _blocks) {
+            const auto& current = entry.second;
+            output << "        int " << function(current.address) << "(cpu& target)\n"
+                << "        {\n";
+            const auto checked = std::any_of(current.instructions.begin(), current.instructions.end() - 1, writes_memory);
+            if (checked) {
+                output << "            const auto writes = target.get_code_writes();\n";
+            }
+            auto elapsed = 0;
+            for (std::size_t index = 0; index < current.instructions.size(); ++index) {
+                const auto& decoded = current.instructions[index];
+                const auto call = decoded.opcode == 0xCB
+                    ? "target.run_static_prefixed<" + hex(decoded.operand, 2) + ">(" + hex(decoded.next, 4) + ")"
+                    : "target.run_static<" + hex(decoded.opcode, 2) + ">(" + hex(decoded.operand, 4) + ", "
+                        + hex(decoded.next, 4) + ")";
+                if (index + 1 < current.instructions.size()) {
+                    output << "            " << call << ";\n";
+                    elapsed += decoded.opcode == 0xCB ? cpu::get_prefixed_info(static_cast<byte>(decoded.operand)).duration
+                        : cpu::get_opcode_info(decoded.opcode).duration;
+                    // a write into code or one that moves an event ahead stops the block right after it
+                    if (writes_memory(decoded)) {
+                        output << "            if (target.get_code_writes() != writes) {\n"
+                            << "                return " << elapsed << ";\n"
+                            << "            }\n";
+                    }
+                }
+                else {
+                    output << "            return " << current.cycles << " + " << call << ";\n";
+                }
+            }
+            output << "        }\n\n";
+        }
+        output << "    }\n\n";
+
+        // an empty array would not compile, so there is always at least a placeholder entry
+        output << "    extern const recompiled_block " << name << "[" << std::max<std::size_t>(_blocks.size(), 1) << "] = {\n";
+        for (const auto& entry : _blocks) {
+            const auto& current = entry.second;
+            const auto last_page = (current.instructions.back().next - 1) / memory::PAGE_SIZE;
+            const auto first_page = current.address / memory::PAGE_SIZE;
+            output << "        {" << hex(current.address, 4) << ", " << current.cycles << ", " << first_page << ", "
+                << last_page << ", " << _rom.get_page_bank(first_page) << ", " << _rom.get_page_bank(last_page) << ", &"
+                << function(current.address) << "},\n";
+        }
+        output << "    };\n\n"
+            << "    extern const std::size_t " << name << "_count = " << _blocks.size() << ";\n"
+            << "    extern const unsigned int " << name << "_checksum = " << hex(checksum(_rom), 8) << ";\n"
+            << "}\n";
+    }
+
+    // FNV-1a
+    unsigned int recompiler::checksum(const memory& rom)
+    {
+        auto hash = 2166136261u;
+        for (auto address = 0; address < ROM_END; ++address) {
+            hash = (hash ^ rom.get_byte(address)) * 16777619u;
+        }
+
+        return hash;
+    }
+}
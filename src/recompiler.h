@@ -0,0 +1,60 @@
+#ifndef RECOMPILER_H
+#define RECOMPILER_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "memory.h"
+
+namespace gameboy {
+    // one instruction as read from the ROM, for the generated code to run with everything known up front
+    struct static_instruction {
+        byte opcode;
+        // the immediate operand, or the prefixed opcode for 0xCB
+        unsigned short operand;
+        unsigned short next;
+    };
+
+    // like the block cache's, a block ends at the first instruction that can leave it; only that one may branch
+    struct static_block {
+        unsigned short address;
+        std::vector<static_instruction> instructions;
+        // cycles of every instruction but the last
+        int cycles;
+    };
+
+    // walks the ROM from its entry points along every statically known jump, call and fall-through, and writes
+    // the blocks it finds out as a C++ translation unit for gameboy-recompile. Like run_block(), the generated code
+    // stops after an instruction that wrote into code or scheduled an event. Code only reached through JP (HL),
+    // RET to a pushed address or code outside ROM is left to the interpreter at run time, and so are the ROM banks
+    // other than the ones mapped while walking.
+    class recompiler {
+    public:
+        // everything below is ROM; RAM can change under the generated code
+        static constexpr auto ROM_END = 0x8000;
+
+        // starts out with the cartridge entry point, the RST targets and the interrupt vectors
+        recompiler(const memory& rom);
+        // extra entry points known from elsewhere, such as jump tables
+        void add_entry(unsigned short address);
+        void walk();
+        const std::map<unsigned short, static_block>& get_blocks() const;
+
+        // defines `const recompiled_block <name>[]`, `<name>_count` and `<name>_checksum`
+        void write(std::ostream& output, const std::string& name) const;
+        // of the ROM area, so that the generated code is only loaded over the ROM it came from
+        static unsigned int checksum(const memory& rom);
+    private:
+        static constexpr auto BLOCK_LIMIT = 64;
+
+        // decodes the block at address and queues whatever it can continue at
+        void decode(unsigned short address);
+
+        const memory& _rom;
+        std::vector<unsigned short> _pending;
+        std::map<unsigned short, static_block> _blocks;
+    };
+}
+
+#endif
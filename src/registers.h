@@ -4,30 +4,28 @@
 #include "byte.h"
 #include "word.h"
 #include "flags.h"
+#include "lazy-flags.h"
 
 namespace gameboy {
     int make_address(byte high, byte low);
 
+#ifdef GAMEBOY_LAZY_FLAGS
+    using flag_register = lazy_flags;
+#else
+    using flag_register = flags;
+#endif
+
+    // plain values only, so the register file can be copied and compared as a whole
     struct registers {
     public:
         registers();
         byte accumulator; // used for small value calculation
-        flags flag;
-        byte& general_b;
-        byte& general_c;
-        unsigned short& general_bc;
-        byte& general_d;
-        byte& general_e;
-        unsigned short& general_de;
-        byte& general_h;
-        byte& general_l;
-        unsigned short& general_hl;
+        flag_register flag;
+        word general_bc; // B is the high byte, C the low one
+        word general_de;
+        word general_hl;
         unsigned short stack_pointer;
         unsigned short program_counter;
-    private:
-        word _general_bc;
-        word _general_de;
-        word _general_hl;
     };
 }
 
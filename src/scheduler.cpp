@@ -0,0 +1,113 @@
+#include "scheduler.h"
+#include <utility>
+
+namespace gameboy {
+    constexpr unsigned long long scheduler::NEVER;
+
+    scheduler::scheduler() : _heap{}, _size(0), _handlers{}, _next(NEVER), _now(0), _preemptions(0)
+    {
+        _timestamps.fill(NEVER);
+        _positions.fill(-1);
+    }
+
+    void scheduler::set_handler(event kind, handler* target)
+    {
+        _handlers[static_cast<std::size_t>(kind)] = target;
+    }
+
+    void scheduler::schedule(event kind, unsigned long long timestamp)
+    {
+        const auto index = static_cast<int>(kind);
+        if (timestamp < _next) {
+            ++_preemptions;
+        }
+
+        if (_positions[index] >= 0) {
+            remove(index);
+        }
+        _timestamps[index] = timestamp;
+        _heap[_size] = index;
+        _positions[index] = _size;
+        sift_up(_size++);
+        _next = _timestamps[_heap[0]];
+    }
+
+    void scheduler::cancel(event kind)
+    {
+        const auto index = static_cast<int>(kind);
+        if (_positions[index] >= 0) {
+            remove(index);
+            _next = _size > 0 ? _timestamps[_heap[0]] : NEVER;
+        }
+    }
+
+    unsigned long long scheduler::get_timestamp(event kind) const
+    {
+        return _timestamps[static_cast<std::size_t>(kind)];
+    }
+
+    void scheduler::run_due()
+    {
+        while (_next <= _now) {
+            const auto index = _heap[0];
+            const auto timestamp = _timestamps[index];
+            remove(index);
+            _next = _size > 0 ? _timestamps[_heap[0]] : NEVER;
+
+            const auto target = _handlers[index];
+            if (target != nullptr) {
+                target->run(static_cast<event>(index), timestamp);
+            }
+        }
+    }
+
+    bool scheduler::earlier(int first, int second) const
+    {
+        return _timestamps[first] != _timestamps[second] ? _timestamps[first] < _timestamps[second] : first < second;
+    }
+
+    void scheduler::swap(int first, int second)
+    {
+        std::swap(_heap[first], _heap[second]);
+        _positions[_heap[first]] = first;
+        _positions[_heap[second]] = second;
+    }
+
+    void scheduler::sift_up(int index)
+    {
+        while (index > 0 && earlier(_heap[index], _heap[(index - 1) / 2])) {
+            swap(index, (index - 1) / 2);
+            index = (index - 1) / 2;
+        }
+    }
+
+    void scheduler::sift_down(int index)
+    {
+        for (;;) {
+            auto smallest = index;
+            for (const auto child : {2 * index + 1, 2 * index + 2}) {
+                if (child < _size && earlier(_heap[child], _heap[smallest])) {
+                    smallest = child;
+                }
+            }
+            if (smallest == index) {
+                return;
+            }
+
+            swap(index, smallest);
+            index = smallest;
+        }
+    }
+
+    void scheduler::remove(int kind)
+    {
+        const auto position = _positions[kind];
+        swap(position, --_size);
+        _positions[kind] = -1;
+        _timestamps[kind] = NEVER;
+        if (position < _size) {
+            sift_up(position);
+            sift_down(_positions[_heap[position]]);
+        }
+    }
+}
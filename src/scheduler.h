@@ -0,0 +1,83 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <array>
+#include <limits>
+
+namespace gameboy {
+    // at most one pending event of each kind, timestamped in cycles since power-on and run earliest first
+    class scheduler {
+    public:
+        enum class event {
+            // the cpu looking at IF, IE and IME again
+            interrupt,
+            timer,
+            video_line,
+            video_mode,
+            serial,
+            count
+        };
+
+        class handler {
+        public:
+            virtual ~handler() = default;
+            // timestamp is when the event was due, which can be before the current time
+            virtual void run(event kind, unsigned long long timestamp) = 0;
+        };
+
+        static constexpr auto NEVER = std::numeric_limits<unsigned long long>::max();
+
+        scheduler();
+        // events of a kind without a handler only wake the cpu up
+        void set_handler(event kind, handler* target);
+        // replaces whatever the kind had pending
+        void schedule(event kind, unsigned long long timestamp);
+        void cancel(event kind);
+        // NEVER when nothing is pending
+        unsigned long long get_timestamp(event kind) const;
+        // runs every event due by the current time, earliest first, including ones their handlers schedule
+        void run_due();
+
+        unsigned long long get_next() const
+        {
+            return _next;
+        }
+
+        unsigned long long get_now() const
+        {
+            return _now;
+        }
+
+        void set_now(unsigned long long now)
+        {
+            _now = now;
+        }
+
+        // times an event was scheduled ahead of the earliest one, which code running towards that one stops for
+        unsigned int get_preemptions() const
+        {
+            return _preemptions;
+        }
+    private:
+        static constexpr auto EVENT_COUNT = static_cast<int>(event::count);
+
+        // ties go to the kind declared first, so that the order never depends on the order of scheduling
+        bool earlier(int first, int second) const;
+        void swap(int first, int second);
+        void sift_up(int index);
+        void sift_down(int index);
+        void remove(int kind);
+
+        std::array<unsigned long long, EVENT_COUNT> _timestamps;
+        // the pending kinds as a binary heap, and where each kind is in it or -1
+        std::array<int, EVENT_COUNT> _heap;
+        std::array<int, EVENT_COUNT> _positions;
+        int _size;
+        std::array<handler*, EVENT_COUNT> _handlers;
+        unsigned long long _next;
+        unsigned long long _now;
+        unsigned int _preemptions;
+    };
+}
+
+#endif
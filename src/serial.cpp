@@ -0,0 +1,67 @@
+#include "serial.h"
+
+namespace gameboy {
+    namespace {
+        constexpr byte TRANSFER = 0x80;
+        constexpr byte INTERNAL_CLOCK = 0x01;
+        // the bits of SC in between do not exist
+        constexpr byte UNUSED = 0x7E;
+    }
+
+    serial::serial(memory& bus) : _bus(bus), _data(0), _control(0), _bits(0)
+    {
+        _bus.set_io_handler(SERIAL_DATA, this);
+        _bus.set_io_handler(SERIAL_CONTROL, this);
+        _bus.get_scheduler().set_handler(scheduler::event::serial, this);
+    }
+
+    serial::~serial()
+    {
+        _bus.set_io_handler(SERIAL_DATA, nullptr);
+        _bus.set_io_handler(SERIAL_CONTROL, nullptr);
+        _bus.get_scheduler().set_handler(scheduler::event::serial, nullptr);
+        _bus.get_scheduler().cancel(scheduler::event::serial);
+    }
+
+    byte serial::read(int address)
+    {
+        return address == SERIAL_DATA ? _data : static_cast<byte>(_control | UNUSED);
+    }
+
+    void serial::write(int address, byte value)
+    {
+        auto& events = _bus.get_scheduler();
+        if (address == SERIAL_DATA) {
+            _data = value;
+            return;
+        }
+
+        _control = static_cast<byte>(value & ~UNUSED);
+        if ((_control & (TRANSFER | INTERNAL_CLOCK)) == (TRANSFER | INTERNAL_CLOCK)) {
+            _bits = 0;
+            _output += static_cast<char>(_data);
+            events.schedule(scheduler::event::serial, events.get_now() + BIT_CYCLES);
+        }
+        else {
+            // on the external clock nothing ever comes
+            events.cancel(scheduler::event::serial);
+        }
+    }
+
+    void serial::run(scheduler::event, unsigned long long timestamp)
+    {
+        _data = static_cast<byte>(_data << 1 | 1);
+        if (++_bits < 8) {
+            _bus.get_scheduler().schedule(scheduler::event::serial, timestamp + BIT_CYCLES);
+            return;
+        }
+
+        _control = static_cast<byte>(_control & ~TRANSFER);
+        _bus.request_interrupt(memory::SERIAL_INTERRUPT);
+    }
+
+    const std::string& serial::get_output() const
+    {
+        return _output;
+    }
+}
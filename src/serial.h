@@ -0,0 +1,39 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <string>
+#include "byte.h"
+#include "memory.h"
+#include "scheduler.h"
+
+namespace gameboy {
+    // SB and SC with no link cable plugged in. A transfer on the internal clock shifts the byte out a bit at a
+    // time at 8192 Hz, with ones coming in, and raises the serial interrupt after the eighth. Test ROMs print their
+    // results this way, so the bytes sent are kept.
+    class serial : public memory::handler, public scheduler::handler {
+    public:
+        static constexpr auto SERIAL_DATA = 0xFF01;
+        static constexpr auto SERIAL_CONTROL = 0xFF02;
+        static constexpr auto BIT_CYCLES = 512;
+
+        // registers itself with the bus and its scheduler for as long as it lives
+        serial(memory& bus);
+        ~serial() override;
+        serial(const serial&) = delete;
+        serial& operator=(const serial&) = delete;
+
+        byte read(int address) override;
+        void write(int address, byte value) override;
+        void run(scheduler::event kind, unsigned long long timestamp) override;
+
+        const std::string& get_output() const;
+    private:
+        memory& _bus;
+        byte _data;
+        byte _control;
+        int _bits;
+        std::string _output;
+    };
+}
+
+#endif
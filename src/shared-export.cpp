@@ -0,0 +1,212 @@
+#include "shared-export.h"
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#if defined(__unix__) || defined(__APPLE__)
+#define GAMEBOY_SHARED_MEMORY
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gameboy {
+    namespace {
+        // every part starts on a cache line of its own
+        constexpr std::size_t ALIGNMENT = 64;
+        // times a reader looks at the sequence before giving up on the writer
+        constexpr auto READ_ATTEMPTS = 100000;
+
+        std::size_t align(std::size_t offset)
+        {
+            return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+    }
+
+    constexpr std::uint32_t shared_export::MAGIC;
+    constexpr std::uint32_t shared_export::VERSION;
+
+    shared_export::view::view(const std::string& name) : _base(nullptr), _size(0)
+    {
+#ifdef GAMEBOY_SHARED_MEMORY
+        const auto descriptor = shm_open(name.c_str(), O_RDONLY, 0);
+        if (descriptor < 0) {
+            throw std::runtime_error("cannot open shared memory " + name);
+        }
+
+        struct stat status;
+        const auto size = fstat(descriptor, &status) == 0 ? static_cast<std::size_t>(status.st_size) : 0;
+        const auto mapping = size >= sizeof(header) ? mmap(nullptr, size, PROT_READ, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+        close(descriptor);
+        if (mapping == MAP_FAILED) {
+            throw std::runtime_error("cannot map shared memory " + name);
+        }
+
+        _base = static_cast<const byte*>(mapping);
+        _size = size;
+        if (get_header().magic.load(std::memory_order_acquire) != MAGIC || get_header().version != VERSION
+            || get_header().size != size) {
+            munmap(mapping, size);
+            throw std::runtime_error(name + " is not an export of this version");
+        }
+#else
+        throw std::runtime_error("no shared memory to open " + name + " in");
+#endif
+    }
+
+    shared_export::view::~view()
+    {
+#ifdef GAMEBOY_SHARED_MEMORY
+        munmap(const_cast<byte*>(_base), _size);
+#endif
+    }
+
+    const shared_export::header& shared_export::view::get_header() const
+    {
+        return *reinterpret_cast<const header*>(_base);
+    }
+
+    const byte* shared_export::view::get_frame() const
+    {
+        return _base + get_header().frame_offset;
+    }
+
+    const shared_export::register_file& shared_export::view::get_registers() const
+    {
+        return *reinterpret_cast<const register_file*>(_base + get_header().registers_offset);
+    }
+
+    const byte* shared_export::view::get_region(int index) const
+    {
+        return _base + get_header().regions[static_cast<std::size_t>(index)].offset;
+    }
+
+    bool shared_export::view::begin_read(std::uint64_t& sequence) const
+    {
+        // a publish takes microseconds, so this is far longer than any the writer finishes
+        for (auto attempt = 0; attempt < READ_ATTEMPTS; ++attempt) {
+            sequence = get_header().sequence.load(std::memory_order_acquire);
+            if (sequence % 2 == 0) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+
+        return false;
+    }
+
+    bool shared_export::view::end_read(std::uint64_t sequence) const
+    {
+        // whatever was read before this stays before it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return get_header().sequence.load(std::memory_order_relaxed) == sequence;
+    }
+
+    shared_export::shared_export(const std::string& name, const std::vector<std::pair<int, int>>& regions)
+        : _name(name), _base(nullptr), _size(0)
+    {
+        if (regions.size() > MAX_REGIONS) {
+            throw std::runtime_error("too many regions to export");
+        }
+
+        auto offset = align(sizeof(header));
+        const auto frame_offset = offset;
+        offset = align(offset + ppu::WIDTH * ppu::HEIGHT);
+        const auto registers_offset = offset;
+        offset = align(offset + sizeof(register_file));
+        std::array<region, MAX_REGIONS> placed{};
+        for (std::size_t index = 0; index < regions.size(); ++index) {
+            const auto address = regions[index].first, size = regions[index].second;
+            if (address < 0 || size < 0 || address + size > 0x10000) {
+                throw std::runtime_error("region to export outside the address space");
+            }
+            if (size > 0 && address < memory::HIGH_RAM && address + size > memory::IO_PAGE * memory::PAGE_SIZE) {
+                throw std::runtime_error("cannot export the I/O registers");
+            }
+            placed[index] = {static_cast<std::uint32_t>(address), static_cast<std::uint32_t>(size),
+                static_cast<std::uint32_t>(offset)};
+            offset = align(offset + static_cast<std::size_t>(size));
+        }
+
+#ifdef GAMEBOY_SHARED_MEMORY
+        const auto descriptor = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if (descriptor < 0) {
+            // another emulator's, or one left behind by a process that was killed, which is for the user to remove
+            throw std::runtime_error(errno == EEXIST ? "shared memory " + name + " already exists"
+                : "cannot create shared memory " + name);
+        }
+
+        const auto mapping = ftruncate(descriptor, static_cast<off_t>(offset)) == 0
+            ? mmap(nullptr, offset, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0) : MAP_FAILED;
+        close(descriptor);
+        if (mapping == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            throw std::runtime_error("cannot map shared memory " + name);
+        }
+
+        _base = static_cast<byte*>(mapping);
+        _size = offset;
+#else
+        throw std::runtime_error("no shared memory to create " + name + " in");
+#endif
+
+        // the rest of a new segment is zeroes already
+        auto& created = *new (_base) header;
+        created.version = VERSION;
+        created.sequence.store(0, std::memory_order_relaxed);
+        created.snapshots = 0;
+        created.size = static_cast<std::uint32_t>(_size);
+        created.width = ppu::WIDTH;
+        created.height = ppu::HEIGHT;
+        created.frame_offset = static_cast<std::uint32_t>(frame_offset);
+        created.registers_offset = static_cast<std::uint32_t>(registers_offset);
+        created.region_count = static_cast<std::uint32_t>(regions.size());
+        created.regions = placed;
+        created.magic.store(MAGIC, std::memory_order_release);
+    }
+
+    shared_export::~shared_export()
+    {
+#ifdef GAMEBOY_SHARED_MEMORY
+        munmap(_base, _size);
+        shm_unlink(_name.c_str());
+#endif
+    }
+
+    const std::string& shared_export::get_name() const
+    {
+        return _name;
+    }
+
+    void shared_export::publish(const registers& state, const memory& bus, const ppu::frame& frame)
+    {
+        auto& target = get_header();
+        const auto sequence = target.sequence.load(std::memory_order_relaxed);
+        target.sequence.store(sequence + 1, std::memory_order_relaxed);
+        // and what is written after this stays after it
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::memcpy(_base + target.frame_offset, frame.data(), frame.size());
+        const register_file values{state.accumulator, static_cast<byte>(state.flag), state.general_bc.bytes.high,
+            state.general_bc.bytes.low, state.general_de.bytes.high, state.general_de.bytes.low, state.general_hl.bytes.high,
+            state.general_hl.bytes.low, state.stack_pointer, state.program_counter};
+        std::memcpy(_base + target.registers_offset, &values, sizeof(values));
+        for (std::size_t index = 0; index < target.region_count; ++index) {
+            const auto& placed = target.regions[index];
+            const auto output = _base + placed.offset;
+            for (std::uint32_t offset = 0; offset < placed.size; ++offset) {
+                output[offset] = bus.peek_byte(static_cast<int>(placed.address + offset));
+            }
+        }
+        ++target.snapshots;
+
+        target.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    shared_export::header& shared_export::get_header() const
+    {
+        return *reinterpret_cast<header*>(_base);
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef SHARED_EXPORT_H
+#define SHARED_EXPORT_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte.h"
+#include "memory.h"
+#include "ppu.h"
+#include "registers.h"
+
+namespace gameboy {
+    // A POSIX shared memory segment other processes on the machine map to read an emulator's last frame, registers
+    // and chosen parts of memory in place, with no copies and no system calls once mapped. A header at the start
+    // says where everything is. Its sequence number is odd while publish() writes a snapshot and goes up by two
+    // for every one. A reader takes the sequence with view::begin_read(), reads, and keeps what it read only when
+    // view::end_read() finds the sequence unchanged.
+    class shared_export {
+    public:
+        static constexpr std::uint32_t MAGIC = 0x58534247;
+        static constexpr std::uint32_t VERSION = 1;
+        static constexpr auto MAX_REGIONS = 8;
+
+        // the registers as readers see them, whichever way this build keeps them
+        struct register_file {
+            std::uint8_t a;
+            std::uint8_t f;
+            std::uint8_t b;
+            std::uint8_t c;
+            std::uint8_t d;
+            std::uint8_t e;
+            std::uint8_t h;
+            std::uint8_t l;
+            std::uint16_t sp;
+            std::uint16_t pc;
+        };
+
+        struct region {
+            std::uint32_t address;
+            std::uint32_t size;
+            // from the start of the segment, as are the other offsets
+            std::uint32_t offset;
+        };
+
+        struct header {
+            // stored last, so that a reader finding it finds the rest of the header filled in
+            std::atomic<std::uint32_t> magic;
+            std::uint32_t version;
+            std::atomic<std::uint64_t> sequence;
+            // snapshots published
+            std::uint64_t snapshots;
+            std::uint32_t size;
+            std::uint32_t width;
+            std::uint32_t height;
+            // width * height shades from 0 for white to 3 for black
+            std::uint32_t frame_offset;
+            std::uint32_t registers_offset;
+            std::uint32_t region_count;
+            std::array<region, MAX_REGIONS> regions;
+        };
+
+        // another process's export, mapped read-only
+        class view {
+        public:
+            // throws std::runtime_error when there is no export by that name or it is not one
+            explicit view(const std::string& name);
+            ~view();
+            view(const view&) = delete;
+            view& operator=(const view&) = delete;
+
+            const header& get_header() const;
+            const byte* get_frame() const;
+            const register_file& get_registers() const;
+            const byte* get_region(int index) const;
+
+            // the sequence of the last complete snapshot into sequence, once any being written is; false when
+            // one stays half written, as when the writer died in the middle of it
+            bool begin_read(std::uint64_t& sequence) const;
+            // whether what was read since begin_read() gave sequence all came from that snapshot
+            bool end_read(std::uint64_t sequence) const;
+        private:
+            const byte* _base;
+            std::size_t _size;
+        };
+
+        // creates the segment as name, which starts with a slash; regions are pairs of address and size,
+        // MAX_REGIONS at most, and stay out of the I/O registers, whose devices keep values memory does not hold;
+        // throws std::runtime_error when it cannot, or when the name is taken already
+        shared_export(const std::string& name, const std::vector<std::pair<int, int>>& regions);
+        // and removes the name, readers keeping what they mapped
+        ~shared_export();
+        shared_export(const shared_export&) = delete;
+        shared_export& operator=(const shared_export&) = delete;
+
+        const std::string& get_name() const;
+        // the regions as peek_byte() has them, so that publishing never disturbs a device
+        void publish(const registers& state, const memory& bus, const ppu::frame& frame);
+    private:
+        header& get_header() const;
+
+        std::string _name;
+        byte* _base;
+        std::size_t _size;
+    };
+}
+
+#endif
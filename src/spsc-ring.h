@@ -0,0 +1,69 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace gameboy {
+    // A bounded queue between exactly one thread pushing and one popping, without locks. Each side only ever writes
+    // its own index and keeps the last one it saw of the other, so the two only share a cache line when the queue is
+    // close to full or empty.
+    template <typename T, std::size_t Capacity>
+    class spsc_ring {
+        static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "the capacity has to be a power of two");
+    public:
+        spsc_ring() : _items(Capacity), _tail(0), _head_seen(0), _head(0), _tail_seen(0)
+        {
+        }
+
+        spsc_ring(const spsc_ring&) = delete;
+        spsc_ring& operator=(const spsc_ring&) = delete;
+
+        // false when full; only ever called by the producer
+        bool try_push(const T& value)
+        {
+            const auto tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _head_seen == Capacity) {
+                _head_seen = _head.load(std::memory_order_acquire);
+                if (tail - _head_seen == Capacity) {
+                    return false;
+                }
+            }
+
+            _items[tail & (Capacity - 1)] = value;
+            _tail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // false when empty; only ever called by the consumer
+        bool try_pop(T& value)
+        {
+            const auto head = _head.load(std::memory_order_relaxed);
+            if (head == _tail_seen) {
+                _tail_seen = _tail.load(std::memory_order_acquire);
+                if (head == _tail_seen) {
+                    return false;
+                }
+            }
+
+            value = _items[head & (Capacity - 1)];
+            _head.store(head + 1, std::memory_order_release);
+            return true;
+        }
+    private:
+        static constexpr std::size_t LINE_SIZE = 64;
+
+        std::vector<T> _items;
+        // the producer's
+        std::atomic<std::size_t> _tail;
+        std::size_t _head_seen;
+        char _producer_padding[LINE_SIZE - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+        // the consumer's
+        std::atomic<std::size_t> _head;
+        std::size_t _tail_seen;
+        char _consumer_padding[LINE_SIZE - sizeof(std::atomic<std::size_t>) - sizeof(std::size_t)];
+    };
+}
+
+#endif
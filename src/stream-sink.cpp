@@ -0,0 +1,115 @@
+#include "stream-sink.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace gameboy {
+    namespace {
+        constexpr char FRAME_MARKER[] = "FRAME\n";
+        // the framebuffer's default colours, white to black
+        constexpr std::array<byte, 4> LUMA{{0xFF, 0xAA, 0x55, 0x00}};
+
+        // little endian whatever the host is
+        void put_little(byte* output, std::uint32_t value, int size)
+        {
+            for (auto index = 0; index < size; ++index) {
+                output[index] = static_cast<byte>(value >> (index * 8));
+            }
+        }
+    }
+
+    constexpr std::size_t wav_sink::HEADER_SIZE;
+
+    y4m_sink::y4m_sink(const std::string& path, stream_writer::overflow policy)
+        : _record(sizeof(FRAME_MARKER) - 1 + ppu::WIDTH * ppu::HEIGHT), _frames(0), _writer(path, policy)
+    {
+        std::copy_n(FRAME_MARKER, sizeof(FRAME_MARKER) - 1, _record.begin());
+        const auto header = "YUV4MPEG2 W" + std::to_string(ppu::WIDTH) + " H" + std::to_string(ppu::HEIGHT) + " F"
+            + std::to_string(RATE_NUMERATOR) + ":" + std::to_string(RATE_DENOMINATOR) + " Ip A1:1 Cmono\n";
+        _writer.write(reinterpret_cast<const byte*>(header.data()), header.size());
+    }
+
+    bool y4m_sink::write_frame(const ppu::frame& frame)
+    {
+        std::transform(frame.begin(), frame.end(), _record.begin() + sizeof(FRAME_MARKER) - 1,
+            [](byte shade) { return LUMA[shade]; });
+        if (!_writer.write(_record.data(), _record.size())) {
+            return false;
+        }
+
+        ++_frames;
+        return true;
+    }
+
+    unsigned long long y4m_sink::get_frames() const
+    {
+        return _frames;
+    }
+
+    stream_writer& y4m_sink::get_writer()
+    {
+        return _writer;
+    }
+
+    wav_sink::wav_sink(const std::string& path, int sample_rate, int channels, stream_writer::overflow policy)
+        : _data_size(0), _writer(path, policy)
+    {
+        const auto block_align = static_cast<std::uint32_t>(channels * 2);
+        std::array<byte, HEADER_SIZE> header;
+        std::memcpy(&header[0], "RIFF", 4);
+        put_little(&header[4], 0xFFFFFFFF, 4);
+        std::memcpy(&header[8], "WAVEfmt ", 8);
+        put_little(&header[16], 16, 4);
+        // PCM
+        put_little(&header[20], 1, 2);
+        put_little(&header[22], static_cast<std::uint32_t>(channels), 2);
+        put_little(&header[24], static_cast<std::uint32_t>(sample_rate), 4);
+        put_little(&header[28], static_cast<std::uint32_t>(sample_rate) * block_align, 4);
+        put_little(&header[32], block_align, 2);
+        put_little(&header[34], 16, 2);
+        std::memcpy(&header[36], "data", 4);
+        put_little(&header[40], 0xFFFFFFFF, 4);
+        _writer.write(header.data(), header.size());
+    }
+
+    wav_sink::~wav_sink()
+    {
+        _writer.finish();
+        if (_data_size + HEADER_SIZE - 8 <= 0xFFFFFFFF) {
+            std::array<byte, 4> size;
+            put_little(size.data(), static_cast<std::uint32_t>(_data_size + HEADER_SIZE - 8), 4);
+            // a pipe keeps the sizes it was given
+            if (_writer.rewrite(4, size.data(), size.size())) {
+                put_little(size.data(), static_cast<std::uint32_t>(_data_size), 4);
+                _writer.rewrite(40, size.data(), size.size());
+            }
+        }
+    }
+
+    bool wav_sink::write_samples(const std::int16_t* samples, std::size_t count)
+    {
+        auto kept = true;
+        while (count > 0) {
+            const auto part = std::min(count, stream_writer::CHUNK_SIZE / 2);
+            _record.resize(part * 2);
+            for (std::size_t index = 0; index < part; ++index) {
+                put_little(&_record[index * 2], static_cast<std::uint16_t>(samples[index]), 2);
+            }
+            if (_writer.write(_record.data(), _record.size())) {
+                _data_size += _record.size();
+            }
+            else {
+                kept = false;
+            }
+            samples += part;
+            count -= part;
+        }
+
+        return kept;
+    }
+
+    stream_writer& wav_sink::get_writer()
+    {
+        return _writer;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef STREAM_SINK_H
+#define STREAM_SINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "byte.h"
+#include "ppu.h"
+#include "stream-writer.h"
+
+namespace gameboy {
+    // Every frame given, as raw greyscale YUV4MPEG2 at the LCD's own rate, which ffmpeg and most players take as it
+    // is, through a stream_writer.
+    class y4m_sink {
+    public:
+        // the frame rate as a fraction, 4194304 / 70224 reduced
+        static constexpr auto RATE_NUMERATOR = 262144;
+        static constexpr auto RATE_DENOMINATOR = 4389;
+
+        // throws std::runtime_error when path cannot be opened
+        explicit y4m_sink(const std::string& path, stream_writer::overflow policy = stream_writer::overflow::drop);
+
+        // false when it was dropped
+        bool write_frame(const ppu::frame& frame);
+        // frames written out or waiting to be
+        unsigned long long get_frames() const;
+        stream_writer& get_writer();
+    private:
+        // FRAME and the luma plane, written as one record
+        std::vector<byte> _record;
+        unsigned long long _frames;
+        stream_writer _writer;
+    };
+
+    // 16 bit PCM samples as WAV. The sizes in the header are left at their largest while streaming, which readers
+    // take as going on until the end, and filled in when done if the file can seek.
+    class wav_sink {
+    public:
+        static constexpr std::size_t HEADER_SIZE = 44;
+
+        // throws std::runtime_error when path cannot be opened
+        wav_sink(const std::string& path, int sample_rate, int channels,
+            stream_writer::overflow policy = stream_writer::overflow::drop);
+        // finishes the writer, and fills in the sizes
+        ~wav_sink();
+        wav_sink(const wav_sink&) = delete;
+        wav_sink& operator=(const wav_sink&) = delete;
+
+        // count samples, the channels interleaved; false when some were dropped
+        bool write_samples(const std::int16_t* samples, std::size_t count);
+        stream_writer& get_writer();
+    private:
+        std::vector<byte> _record;
+        // bytes of samples written out or waiting to be
+        unsigned long long _data_size;
+        stream_writer _writer;
+    };
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include "stream-writer.h"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace gameboy {
+    constexpr std::size_t stream_writer::CHUNK_SIZE;
+    constexpr std::size_t stream_writer::CHUNKS;
+    constexpr std::uint32_t stream_writer::NO_CHUNK;
+
+    stream_writer::stream_writer(const std::string& path, overflow policy) : _file(std::fopen(path.c_str(), "wb")),
+        _policy(policy), _chunks(CHUNKS), _current(NO_CHUNK), _submitted(0), _completed(0), _written(0),
+        _failed(false), _dropped(0)
+    {
+        if (_file == nullptr) {
+            throw std::runtime_error("cannot open " + path + " to write to");
+        }
+
+        for (std::uint32_t index = 0; index < CHUNKS; ++index) {
+            _chunks[index].data.resize(CHUNK_SIZE);
+            _chunks[index].size = 0;
+            _free.try_push(index);
+        }
+        _thread = std::thread{&stream_writer::write_chunks, this};
+    }
+
+    stream_writer::~stream_writer()
+    {
+        finish();
+        std::fclose(_file);
+    }
+
+    bool stream_writer::write(const byte* data, std::size_t size)
+    {
+        if (size > CHUNK_SIZE) {
+            ++_dropped;
+            return false;
+        }
+        if (_current != NO_CHUNK && _chunks[_current].size + size > CHUNK_SIZE) {
+            submit();
+        }
+        if (_current == NO_CHUNK && !take_chunk()) {
+            ++_dropped;
+            return false;
+        }
+
+        auto& target = _chunks[_current];
+        std::memcpy(target.data.data() + target.size, data, size);
+        target.size += size;
+        return true;
+    }
+
+    void stream_writer::flush()
+    {
+        if (_current != NO_CHUNK && _chunks[_current].size > 0) {
+            submit();
+        }
+        while (_completed.load(std::memory_order_acquire) != _submitted) {
+            std::this_thread::yield();
+        }
+    }
+
+    void stream_writer::finish()
+    {
+        if (!_thread.joinable()) {
+            return;
+        }
+
+        flush();
+        _full.try_push(NO_CHUNK);
+        _thread.join();
+    }
+
+    bool stream_writer::rewrite(long offset, const byte* data, std::size_t size)
+    {
+        return std::fseek(_file, offset, SEEK_SET) == 0 && std::fwrite(data, 1, size, _file) == size
+            && std::fseek(_file, 0, SEEK_END) == 0;
+    }
+
+    unsigned long long stream_writer::get_written() const
+    {
+        return _written.load(std::memory_order_relaxed);
+    }
+
+    unsigned long long stream_writer::get_dropped() const
+    {
+        return _dropped;
+    }
+
+    bool stream_writer::has_failed() const
+    {
+        return _failed.load(std::memory_order_relaxed);
+    }
+
+    void stream_writer::write_chunks()
+    {
+        std::uint32_t next;
+        auto idle = 0;
+        for (;;) {
+            if (!_full.try_pop(next)) {
+                // yielding for a while and then sleeping, as the PPU's thread does
+                if (++idle < 1000) {
+                    std::this_thread::yield();
+                }
+                else {
+                    std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+                continue;
+            }
+
+            idle = 0;
+            if (next == NO_CHUNK) {
+                return;
+            }
+
+            auto& written = _chunks[next];
+            if (!_failed.load(std::memory_order_relaxed)) {
+                // a chunk is far bigger than the stream's buffer, so most of it goes straight out, and the rest
+                // is not left behind
+                if (std::fwrite(written.data.data(), 1, written.size, _file) == written.size && std::fflush(_file) == 0) {
+                    _written.fetch_add(written.size, std::memory_order_relaxed);
+                }
+                else {
+                    _failed.store(true, std::memory_order_relaxed);
+                }
+            }
+            written.size = 0;
+            // the rings hold every chunk there is, so there is always room
+            _free.try_push(next);
+            _completed.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void stream_writer::submit()
+    {
+        _full.try_push(_current);
+        _current = NO_CHUNK;
+        ++_submitted;
+    }
+
+    bool stream_writer::take_chunk()
+    {
+        while (!_free.try_pop(_current)) {
+            if (_policy == overflow::drop) {
+                _current = NO_CHUNK;
+                return false;
+            }
+            std::this_thread::yield();
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef STREAM_WRITER_H
+#define STREAM_WRITER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "byte.h"
+#include "spsc-ring.h"
+
+namespace gameboy {
+    // a file or pipe written in large chunks by a thread of its own; records wait or are dropped when none is free
+    class stream_writer {
+    public:
+        static constexpr std::size_t CHUNK_SIZE = 256 * 1024;
+        // some seconds of video
+        static constexpr std::size_t CHUNKS = 32;
+
+        enum class overflow {
+            wait,
+            drop
+        };
+
+        // path can be a named pipe as well, or /dev/stdout; throws std::runtime_error when it cannot be opened
+        stream_writer(const std::string& path, overflow policy);
+        // finish()es
+        ~stream_writer();
+        stream_writer(const stream_writer&) = delete;
+        stream_writer& operator=(const stream_writer&) = delete;
+
+        // a record kept whole; false when dropped, which one longer than CHUNK_SIZE always is
+        bool write(const byte* data, std::size_t size);
+        // waits until everything recorded so far is written
+        void flush();
+        // flushes, and stops the thread; the file stays open for rewrite()
+        void finish();
+        // size bytes at offset from the start of the file, once finished; false when it cannot seek, as with a pipe
+        bool rewrite(long offset, const byte* data, std::size_t size);
+
+        // bytes written out so far
+        unsigned long long get_written() const;
+        // records dropped so far
+        unsigned long long get_dropped() const;
+        // whether a write failed, after which the rest is thrown away
+        bool has_failed() const;
+    private:
+        using chunk_ring = spsc_ring<std::uint32_t, 64>;
+        static_assert(CHUNKS < 64, "every chunk has to fit in either ring along with a stop");
+
+        static constexpr std::uint32_t NO_CHUNK = 0xFFFFFFFF;
+
+        struct chunk {
+            std::vector<byte> data;
+            std::size_t size;
+        };
+
+        // the thread's loop, writing what is submitted until it is sent NO_CHUNK
+        void write_chunks();
+        void submit();
+        bool take_chunk();
+
+        std::FILE* _file;
+        overflow _policy;
+        std::vector<chunk> _chunks;
+        // chunks to write, and chunks written and free again
+        chunk_ring _full;
+        chunk_ring _free;
+        // the one being filled, or NO_CHUNK
+        std::uint32_t _current;
+        // chunks submitted, and chunks the thread is done with
+        unsigned long long _submitted;
+        std::atomic<unsigned long long> _completed;
+        std::atomic<unsigned long long> _written;
+        std::atomic<bool> _failed;
+        unsigned long long _dropped;
+        std::thread _thread;
+    };
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "tile-decoder.h"
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GAMEBOY_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace gameboy {
+    namespace {
+        void decode_scalar(const byte* rows, byte* pixels, std::size_t count)
+        {
+            for (; count > 0; --count, rows += 2, pixels += 8) {
+                const auto low = rows[0], high = rows[1];
+                for (auto bit = 0; bit < 8; ++bit) {
+                    pixels[bit] = static_cast<byte>((low >> (7 - bit) & 1) | (high >> (7 - bit) & 1) << 1);
+                }
+            }
+        }
+
+#ifdef GAMEBOY_X86_KERNELS
+        // each pixel's bit, from the leftmost one on, for both rows in a register
+        __attribute__((target("sse2")))
+        void decode_sse2(const byte* rows, byte* pixels, std::size_t count)
+        {
+            const auto bits = _mm_setr_epi8(-128, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                -128, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+            const auto one = _mm_set1_epi8(1);
+            for (; count >= 2; count -= 2, rows += 4, pixels += 16) {
+                int value;
+                std::memcpy(&value, rows, sizeof(value));
+                // low0 high0 low1 high1, each byte spread to 4 and then to 8 copies
+                auto spread = _mm_cvtsi32_si128(value);
+                spread = _mm_unpacklo_epi8(spread, spread);
+                spread = _mm_unpacklo_epi16(spread, spread);
+                const auto first = _mm_unpacklo_epi32(spread, spread);
+                const auto second = _mm_unpackhi_epi32(spread, spread);
+                const auto low = _mm_unpacklo_epi64(first, second);
+                const auto high = _mm_unpackhi_epi64(first, second);
+
+                const auto low_set = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(low, bits), bits), one);
+                const auto high_set = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(high, bits), bits), one);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), _mm_or_si128(low_set, _mm_add_epi8(high_set, high_set)));
+            }
+            decode_scalar(rows, pixels, count);
+        }
+
+        // deposits the bits of each plane in the low bits of 8 bytes, which then only need reversing
+        __attribute__((target("bmi2")))
+        void decode_bmi2(const byte* rows, byte* pixels, std::size_t count)
+        {
+            for (; count > 0; --count, rows += 2, pixels += 8) {
+                const auto spread = _pdep_u64(rows[0], 0x0101010101010101ull) | _pdep_u64(rows[1], 0x0202020202020202ull);
+                const auto ordered = __builtin_bswap64(spread);
+                std::memcpy(pixels, &ordered, sizeof(ordered));
+            }
+        }
+
+        // decode_sse2() on four rows; the shuffles work within each half, which both hold all eight bytes
+        __attribute__((target("avx2")))
+        void decode_avx2(const byte* rows, byte* pixels, std::size_t count)
+        {
+            const auto bits = _mm256_setr_epi8(-128, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                -128, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, -128, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                -128, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+            const auto lows = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2,
+                4, 4, 4, 4, 4, 4, 4, 4, 6, 6, 6, 6, 6, 6, 6, 6);
+            const auto highs = _mm256_setr_epi8(1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3, 3, 3,
+                5, 5, 5, 5, 5, 5, 5, 5, 7, 7, 7, 7, 7, 7, 7, 7);
+            const auto one = _mm256_set1_epi8(1);
+            for (; count >= 4; count -= 4, rows += 8, pixels += 32) {
+                long long value;
+                std::memcpy(&value, rows, sizeof(value));
+                const auto spread = _mm256_set1_epi64x(value);
+                const auto low = _mm256_shuffle_epi8(spread, lows);
+                const auto high = _mm256_shuffle_epi8(spread, highs);
+
+                const auto low_set = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(low, bits), bits), one);
+                const auto high_set = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_and_si256(high, bits), bits), one);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels),
+                    _mm256_or_si256(low_set, _mm256_add_epi8(high_set, high_set)));
+            }
+            // the compiler leaves this out before the tail call, and SSE code run with the upper halves dirty pays
+            // for it on every instruction
+            _mm256_zeroupper();
+            decode_sse2(rows, pixels, count);
+        }
+#endif
+    }
+
+    tile_decoder::kernel tile_decoder::best()
+    {
+        for (const auto type : {kernel::avx2, kernel::sse2, kernel::bmi2}) {
+            if (is_supported(type)) {
+                return type;
+            }
+        }
+
+        return kernel::scalar;
+    }
+
+    bool tile_decoder::is_supported(kernel type)
+    {
+#ifdef GAMEBOY_X86_KERNELS
+        __builtin_cpu_init();
+        switch (type) {
+        case kernel::scalar:
+            return true;
+        case kernel::sse2:
+            return __builtin_cpu_supports("sse2");
+        case kernel::bmi2:
+            return __builtin_cpu_supports("bmi2");
+        case kernel::avx2:
+            return __builtin_cpu_supports("avx2");
+        }
+
+        return false;
+#else
+        return type == kernel::scalar;
+#endif
+    }
+
+    const char* tile_decoder::get_name(kernel type)
+    {
+        switch (type) {
+        case kernel::scalar:
+            return "scalar";
+        case kernel::sse2:
+            return "SSE2";
+        case kernel::bmi2:
+            return "BMI2";
+        case kernel::avx2:
+            return "AVX2";
+        }
+
+        return "unknown";
+    }
+
+    tile_decoder::tile_decoder(kernel type) : _kernel(is_supported(type) ? type : kernel::scalar), _decode(&decode_scalar)
+    {
+#ifdef GAMEBOY_X86_KERNELS
+        switch (_kernel) {
+        case kernel::scalar:
+            break;
+        case kernel::sse2:
+            _decode = &decode_sse2;
+            break;
+        case kernel::bmi2:
+            _decode = &decode_bmi2;
+            break;
+        case kernel::avx2:
+            _decode = &decode_avx2;
+            break;
+        }
+#endif
+    }
+
+    tile_decoder::kernel tile_decoder::get_kernel() const
+    {
+        return _kernel;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef TILE_DECODER_H
+#define TILE_DECODER_H
+
+#include <cstddef>
+#include "byte.h"
+
+namespace gameboy {
+    // Tile rows are planar 2bpp: two bytes per row of 8 pixels, the first with bit 0 of each pixel's colour index and
+    // the second with bit 1, leftmost pixel in bit 7. The decoder turns rows into one colour index byte per pixel,
+    // with a kernel picked at run time from what the processor supports; every kernel gives the same bytes.
+    class tile_decoder {
+    public:
+        enum class kernel {
+            // a byte at a time, on any processor
+            scalar,
+            // 16 pixels at a time in SSE2 registers
+            sse2,
+            // 8 pixels at a time with PDEP
+            bmi2,
+            // 32 pixels at a time in AVX2 registers
+            avx2
+        };
+
+        // the fastest kernel the processor running this supports
+        static kernel best();
+        static bool is_supported(kernel type);
+        static const char* get_name(kernel type);
+
+        // falls back to the scalar kernel when type is not supported
+        explicit tile_decoder(kernel type = best());
+        kernel get_kernel() const;
+
+        // count rows, two bytes each, to 8 * count colour indices
+        void decode(const byte* rows, byte* pixels, std::size_t count) const
+        {
+            _decode(rows, pixels, count);
+        }
+    private:
+        kernel _kernel;
+        void (*_decode)(const byte* rows, byte* pixels, std::size_t count);
+    };
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "timer.h"
+
+namespace gameboy {
+    namespace {
+        constexpr byte ENABLE = 0x04;
+        // the bits of TAC above the enable bit do not exist
+        constexpr byte UNUSED = 0xF8;
+        // counter bits TIMA follows for each TAC rate, as the length of their period
+        constexpr unsigned long long PERIODS[] = {1024, 16, 64, 256};
+    }
+
+    timer::timer(memory& bus) : _bus(bus), _reset(bus.get_scheduler().get_now()), _counter(0), _edges(0), _modulo(0),
+        _control(0)
+    {
+        for (const auto address : {DIVIDER, COUNTER, MODULO, CONTROL}) {
+            _bus.set_io_handler(address, this);
+        }
+        _bus.get_scheduler().set_handler(scheduler::event::timer, this);
+    }
+
+    timer::~timer()
+    {
+        for (const auto address : {DIVIDER, COUNTER, MODULO, CONTROL}) {
+            _bus.set_io_handler(address, nullptr);
+        }
+        _bus.get_scheduler().set_handler(scheduler::event::timer, nullptr);
+        _bus.get_scheduler().cancel(scheduler::event::timer);
+    }
+
+    byte timer::read(int address)
+    {
+        const auto now = _bus.get_scheduler().get_now();
+        switch (address) {
+        case DIVIDER:
+            return static_cast<byte>((now - _reset) >> 8);
+        case COUNTER:
+            catch_up(now);
+            return _counter;
+        case MODULO:
+            return _modulo;
+        default:
+            return static_cast<byte>(_control | UNUSED);
+        }
+    }
+
+    void timer::write(int address, byte value)
+    {
+        const auto now = _bus.get_scheduler().get_now();
+        catch_up(now);
+        const auto selected = enabled() && ((now - _reset) & get_period() / 2) != 0;
+        switch (address) {
+        case DIVIDER:
+            // the counter goes to 0, which is a falling edge if the selected bit was set
+            if (selected) {
+                increment();
+            }
+            _reset = now;
+            _edges = 0;
+            break;
+        case COUNTER:
+            _counter = value;
+            break;
+        case MODULO:
+            _modulo = value;
+            return;
+        default:
+            _control = static_cast<byte>(value & ~UNUSED);
+            // TIMA sees the selected bit ANDed with the enable bit, so switching either can make an edge
+            if (selected && !(enabled() && ((now - _reset) & get_period() / 2) != 0)) {
+                increment();
+            }
+            _edges = get_edges(now);
+            break;
+        }
+
+        reschedule();
+    }
+
+    bool timer::is_timed(int address) const
+    {
+        return address == DIVIDER || (address == COUNTER && enabled());
+    }
+
+    void timer::run(scheduler::event, unsigned long long timestamp)
+    {
+        // the edge that takes TIMA past 0xFF
+        catch_up(timestamp - 1);
+        _edges = get_edges(timestamp);
+        overflow();
+        reschedule();
+    }
+
+    bool timer::enabled() const
+    {
+        return (_control & ENABLE) != 0;
+    }
+
+    unsigned long long timer::get_period() const
+    {
+        return PERIODS[_control & 0x03];
+    }
+
+    unsigned long long timer::get_edges(unsigned long long time) const
+    {
+        return (time - _reset) / get_period();
+    }
+
+    void timer::catch_up(unsigned long long time)
+    {
+        if (!enabled()) {
+            return;
+        }
+
+        const auto edges = get_edges(time);
+        _counter = static_cast<byte>(_counter + (edges - _edges));
+        _edges = edges;
+    }
+
+    void timer::increment()
+    {
+        if (_counter == 0xFF) {
+            overflow();
+        }
+        else {
+            ++_counter;
+        }
+    }
+
+    void timer::overflow()
+    {
+        _counter = _modulo;
+        _bus.request_interrupt(memory::TIMER_INTERRUPT);
+    }
+
+    void timer::reschedule()
+    {
+        auto& events = _bus.get_scheduler();
+        if (!enabled()) {
+            events.cancel(scheduler::event::timer);
+            return;
+        }
+
+        // the edge that takes TIMA from 0xFF to 0x100
+        const auto overflow_edge = _edges + (0x100 - _counter);
+        events.schedule(scheduler::event::timer, _reset + overflow_edge * get_period());
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "byte.h"
+#include "memory.h"
+#include "scheduler.h"
+
+namespace gameboy {
+    // DIV, TIMA, TMA and TAC without ticking. DIV is the top of a 16-bit counter running since its last reset,
+    // and TIMA counts the falling edges of the counter bit TAC selects, so both are worked out from the
+    // scheduler's clock when read. The only event is the next TIMA overflow, which reloads TMA and requests the
+    // timer interrupt; writes catch the registers up to the current time first and then move that event.
+    // Registers are sampled when the instruction accessing them starts.
+    class timer : public memory::handler, public scheduler::handler {
+    public:
+        static constexpr auto DIVIDER = 0xFF04;
+        static constexpr auto COUNTER = 0xFF05;
+        static constexpr auto MODULO = 0xFF06;
+        static constexpr auto CONTROL = 0xFF07;
+
+        // registers itself with the bus and its scheduler for as long as it lives, with the counter starting now
+        timer(memory& bus);
+        ~timer() override;
+        timer(const timer&) = delete;
+        timer& operator=(const timer&) = delete;
+
+        byte read(int address) override;
+        void write(int address, byte value) override;
+        // DIV always, and TIMA while it counts
+        bool is_timed(int address) const override;
+        void run(scheduler::event kind, unsigned long long timestamp) override;
+    private:
+        bool enabled() const;
+        // cycles between TIMA increments for the rate TAC selects: 1024, 16, 64 or 256
+        unsigned long long get_period() const;
+        // falling edges of the selected counter bit from the last reset of DIV up to time
+        unsigned long long get_edges(unsigned long long time) const;
+        // brings TIMA up to time, which is never past the next overflow
+        void catch_up(unsigned long long time);
+        // one increment outside the regular edges, when a write turns the selected bit from 1 to 0
+        void increment();
+        void overflow();
+        void reschedule();
+
+        memory& _bus;
+        // when the counter was last reset to 0
+        unsigned long long _reset;
+        byte _counter;
+        // edges already counted into _counter
+        unsigned long long _edges;
+        byte _modulo;
+        byte _control;
+    };
+}
+
+#endif
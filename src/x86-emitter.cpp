@@ -0,0 +1,337 @@
+#include "x86-emitter.h"
+#include <cstdint>
+
+namespace gameboy {
+    const std::vector<byte>& x86_emitter::get_code() const
+    {
+        return _code;
+    }
+
+    // 8-bit forms always carry a REX prefix, so that 4-7 name spl..dil rather than ah..bh
+    void x86_emitter::alu8(operation op, reg destination, reg source)
+    {
+        rex(false, source, destination, true);
+        emit(static_cast<byte>(op << 3));
+        modrm(3, source, destination);
+    }
+
+    void x86_emitter::alu8(operation op, reg destination, byte immediate)
+    {
+        rex(false, 0, destination, true);
+        emit(0x80);
+        modrm(3, op, destination);
+        emit(immediate);
+    }
+
+    void x86_emitter::test8(reg destination, byte immediate)
+    {
+        rex(false, 0, destination, true);
+        emit(0xF6);
+        modrm(3, 0, destination);
+        emit(immediate);
+    }
+
+    void x86_emitter::mov8(reg destination, reg source)
+    {
+        rex(false, source, destination, true);
+        emit(0x88);
+        modrm(3, source, destination);
+    }
+
+    void x86_emitter::mov8(reg destination, byte immediate)
+    {
+        rex(false, 0, destination, true);
+        emit(static_cast<byte>(0xB0 + (destination & 7)));
+        emit(immediate);
+    }
+
+    void x86_emitter::inc8(reg destination)
+    {
+        rex(false, 0, destination, true);
+        emit(0xFE);
+        modrm(3, 0, destination);
+    }
+
+    void x86_emitter::dec8(reg destination)
+    {
+        rex(false, 0, destination, true);
+        emit(0xFE);
+        modrm(3, 1, destination);
+    }
+
+    void x86_emitter::not8(reg destination)
+    {
+        rex(false, 0, destination, true);
+        emit(0xF6);
+        modrm(3, 2, destination);
+    }
+
+    void x86_emitter::setcc(condition code, reg destination)
+    {
+        rex(false, 0, destination, true);
+        emit(0x0F);
+        emit(static_cast<byte>(0x90 + code));
+        modrm(3, 0, destination);
+    }
+
+    void x86_emitter::alu32(operation op, reg destination, reg source)
+    {
+        rex(false, source, destination, false);
+        emit(static_cast<byte>(op << 3 | 1));
+        modrm(3, source, destination);
+    }
+
+    void x86_emitter::alu32(operation op, reg destination, unsigned int immediate)
+    {
+        rex(false, 0, destination, false);
+        emit(0x81);
+        modrm(3, op, destination);
+        emit32(immediate);
+    }
+
+    void x86_emitter::mov32(reg destination, reg source)
+    {
+        rex(false, source, destination, false);
+        emit(0x89);
+        modrm(3, source, destination);
+    }
+
+    void x86_emitter::mov32(reg destination, unsigned int immediate)
+    {
+        rex(false, 0, destination, false);
+        emit(static_cast<byte>(0xB8 + (destination & 7)));
+        emit32(immediate);
+    }
+
+    void x86_emitter::movzx8(reg destination, reg source)
+    {
+        rex(false, destination, source, true);
+        emit(0x0F);
+        emit(0xB6);
+        modrm(3, destination, source);
+    }
+
+    void x86_emitter::shl32(reg destination, byte count)
+    {
+        rex(false, 0, destination, false);
+        emit(0xC1);
+        modrm(3, 4, destination);
+        emit(count);
+    }
+
+    void x86_emitter::shr32(reg destination, byte count)
+    {
+        rex(false, 0, destination, false);
+        emit(0xC1);
+        modrm(3, 5, destination);
+        emit(count);
+    }
+
+    void x86_emitter::bt32(reg destination, byte bit)
+    {
+        rex(false, 0, destination, false);
+        emit(0x0F);
+        emit(0xBA);
+        modrm(3, 4, destination);
+        emit(bit);
+    }
+
+    void x86_emitter::test32(reg destination, unsigned int immediate)
+    {
+        rex(false, 0, destination, false);
+        emit(0xF7);
+        modrm(3, 0, destination);
+        emit32(immediate);
+    }
+
+    void x86_emitter::cmov32(condition code, reg destination, reg source)
+    {
+        rex(false, destination, source, false);
+        emit(0x0F);
+        emit(static_cast<byte>(0x40 + code));
+        modrm(3, destination, source);
+    }
+
+    void x86_emitter::load8(reg destination, byte displacement)
+    {
+        rex(false, destination, rbx, false);
+        emit(0x0F);
+        emit(0xB6);
+        modrm(1, destination, rbx);
+        emit(displacement);
+    }
+
+    void x86_emitter::store8(byte displacement, reg source)
+    {
+        rex(false, source, rbx, true);
+        emit(0x88);
+        modrm(1, source, rbx);
+        emit(displacement);
+    }
+
+    void x86_emitter::store16(byte displacement, reg source)
+    {
+        emit(0x66);
+        rex(false, source, rbx, false);
+        emit(0x89);
+        modrm(1, source, rbx);
+        emit(displacement);
+    }
+
+    void x86_emitter::store16(byte displacement, unsigned short immediate)
+    {
+        emit(0x66);
+        emit(0xC7);
+        modrm(1, 0, rbx);
+        emit(displacement);
+        emit(static_cast<byte>(immediate));
+        emit(static_cast<byte>(immediate >> 8));
+    }
+
+    void x86_emitter::inc16(byte displacement)
+    {
+        emit(0x66);
+        emit(0xFF);
+        modrm(1, 0, rbx);
+        emit(displacement);
+    }
+
+    void x86_emitter::dec16(byte displacement)
+    {
+        emit(0x66);
+        emit(0xFF);
+        modrm(1, 1, rbx);
+        emit(displacement);
+    }
+
+    void x86_emitter::cmp8(byte displacement, byte immediate)
+    {
+        emit(0x80);
+        modrm(1, 7, rbx);
+        emit(displacement);
+        emit(immediate);
+    }
+
+    void x86_emitter::mov64(reg destination, reg source)
+    {
+        rex(true, source, destination, false);
+        emit(0x89);
+        modrm(3, source, destination);
+    }
+
+    void x86_emitter::mov64(reg destination, const void* immediate)
+    {
+        rex(true, 0, destination, false);
+        emit(static_cast<byte>(0xB8 + (destination & 7)));
+        const auto value = reinterpret_cast<std::uintptr_t>(immediate);
+        emit32(static_cast<unsigned int>(value));
+        emit32(static_cast<unsigned int>(value >> 32));
+    }
+
+    void x86_emitter::add64(reg destination, byte immediate)
+    {
+        rex(true, 0, destination, false);
+        emit(0x83);
+        modrm(3, 0, destination);
+        emit(immediate);
+    }
+
+    void x86_emitter::sub64(reg destination, byte immediate)
+    {
+        rex(true, 0, destination, false);
+        emit(0x83);
+        modrm(3, 5, destination);
+        emit(immediate);
+    }
+
+    void x86_emitter::call(reg target)
+    {
+        rex(false, 0, target, false);
+        emit(0xFF);
+        modrm(3, 2, target);
+    }
+
+    std::size_t x86_emitter::jcc(condition code)
+    {
+        emit(0x0F);
+        emit(static_cast<byte>(0x80 + code));
+        emit32(0);
+        return _code.size() - 4;
+    }
+
+    std::size_t x86_emitter::jmp()
+    {
+        emit(0xE9);
+        emit32(0);
+        return _code.size() - 4;
+    }
+
+    void x86_emitter::jmp(std::size_t target)
+    {
+        patch(jmp(), target);
+    }
+
+    void x86_emitter::patch(std::size_t displacement, std::size_t target)
+    {
+        // relative to the end of the jump, which is where the displacement ends
+        const auto relative = static_cast<unsigned int>(target - (displacement + 4));
+        for (auto shift = 0; shift < 32; shift += 8) {
+            _code[displacement + static_cast<std::size_t>(shift / 8)] = static_cast<byte>(relative >> shift);
+        }
+    }
+
+    std::size_t x86_emitter::position() const
+    {
+        return _code.size();
+    }
+
+    void x86_emitter::load_flags()
+    {
+        emit(0x9F);
+        emit(0x0F);
+        emit(0xB6);
+        emit(0xC4);
+    }
+
+    void x86_emitter::push(reg source)
+    {
+        rex(false, 0, source, false);
+        emit(static_cast<byte>(0x50 + (source & 7)));
+    }
+
+    void x86_emitter::pop(reg destination)
+    {
+        rex(false, 0, destination, false);
+        emit(static_cast<byte>(0x58 + (destination & 7)));
+    }
+
+    void x86_emitter::ret()
+    {
+        emit(0xC3);
+    }
+
+    void x86_emitter::rex(bool wide, int reg_field, int rm_field, bool force)
+    {
+        const auto prefix = 0x40 | (wide ? 0x08 : 0) | (reg_field & 8) >> 1 | (rm_field & 8) >> 3;
+        if (force || prefix != 0x40) {
+            emit(static_cast<byte>(prefix));
+        }
+    }
+
+    void x86_emitter::modrm(int mod, int reg_field, int rm_field)
+    {
+        emit(static_cast<byte>(mod << 6 | (reg_field & 7) << 3 | (rm_field & 7)));
+    }
+
+    void x86_emitter::emit(byte value)
+    {
+        _code.push_back(value);
+    }
+
+    void x86_emitter::emit32(unsigned int value)
+    {
+        for (auto shift = 0; shift < 32; shift += 8) {
+            emit(static_cast<byte>(value >> shift));
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef X86_EMITTER_H
+#define X86_EMITTER_H
+
+#include <cstddef>
+#include <vector>
+#include "byte.h"
+
+namespace gameboy {
+    // just enough of the x86-64 encoding for the JIT: register numbers are the hardware ones (rax = 0 ... r15 = 15),
+    // memory operands are always [rbx + disp8]
+    class x86_emitter {
+    public:
+        enum reg {
+            rax = 0, rcx = 1, rdx = 2, rbx = 3, rsp = 4, rbp = 5, rsi = 6, rdi = 7,
+            r8 = 8, r9 = 9, r10 = 10, r11 = 11, r12 = 12, r13 = 13, r14 = 14, r15 = 15
+        };
+
+        // group 1 operations in their encoding order
+        enum operation {
+            add = 0, or_ = 1, adc = 2, sbb = 3, and_ = 4, sub = 5, xor_ = 6, cmp = 7
+        };
+
+        // condition codes as used by SETcc and CMOVcc
+        enum condition {
+            below = 0x2, not_below = 0x3, equal = 0x4, not_equal = 0x5
+        };
+
+        const std::vector<byte>& get_code() const;
+
+        void alu8(operation op, reg destination, reg source);
+        void alu8(operation op, reg destination, byte immediate);
+        void test8(reg destination, byte immediate);
+        void mov8(reg destination, reg source);
+        void mov8(reg destination, byte immediate);
+        void inc8(reg destination);
+        void dec8(reg destination);
+        void not8(reg destination);
+        void setcc(condition code, reg destination);
+
+        void alu32(operation op, reg destination, reg source);
+        void alu32(operation op, reg destination, unsigned int immediate);
+        void mov32(reg destination, reg source);
+        void mov32(reg destination, unsigned int immediate);
+        void movzx8(reg destination, reg source);
+        void shl32(reg destination, byte count);
+        void shr32(reg destination, byte count);
+        void bt32(reg destination, byte bit);
+        void test32(reg destination, unsigned int immediate);
+        void cmov32(condition code, reg destination, reg source);
+
+        // movzx destination, byte [rbx + displacement] and mov byte [rbx + displacement], source
+        void load8(reg destination, byte displacement);
+        void store8(byte displacement, reg source);
+        void store16(byte displacement, reg source);
+        void store16(byte displacement, unsigned short immediate);
+        void inc16(byte displacement);
+        void dec16(byte displacement);
+        void cmp8(byte displacement, byte immediate);
+
+        void mov64(reg destination, reg source);
+        void mov64(reg destination, const void* immediate);
+        void add64(reg destination, byte immediate);
+        void sub64(reg destination, byte immediate);
+        void call(reg target);
+
+        // forward jumps leave a 32-bit displacement to be filled in by patch() once the target is known
+        std::size_t jcc(condition code);
+        std::size_t jmp();
+        void jmp(std::size_t target);
+        void patch(std::size_t displacement, std::size_t target);
+        std::size_t position() const;
+
+        // lahf followed by movzx eax, ah: SF ZF - AF - PF - CF end up in bits 7..0 of eax
+        void load_flags();
+        void push(reg source);
+        void pop(reg destination);
+        void ret();
+    private:
+        void rex(bool wide, int reg_field, int rm_field, bool force);
+        void modrm(int mod, int reg_field, int rm_field);
+        void emit(byte value);
+        void emit32(unsigned int value);
+
+        std::vector<byte> _code;
+    };
+}
+
+#endif
@@ -1,10 +1,12 @@
 #include "alu-test.h"
 #include <array>
+#include <bitset>
 #include <chrono>
 #include <future>
 #include <iostream>
 #include <limits>
 #include <typeinfo>
+#include <utility>
 
 namespace gameboy {
     template<typename T, typename U>
@@ -27,7 +29,8 @@ namespace gameboy {
                     != std::bitset<bit_count>(op1 ^ op2 ^ output2)[bit_count - 4];
                 const auto cf_failed = output1.status[flag_type::carry]
                     != std::bitset<bit_count + 1>(op1 ^ op2 ^ (op1 + op2))[bit_count];
-                failed += value_failed || zf_failed || nf_failed || hf_failed || cf_failed;
+                const auto backend_failed = !addition_backends_match(op1, op2);
+                failed += value_failed || zf_failed || nf_failed || hf_failed || cf_failed || backend_failed;
             }
         }
 
@@ -56,7 +59,8 @@ namespace gameboy {
                     != std::bitset<bit_count>(op1 ^ op2 ^ output2)[bit_count - 4];
                 const auto cf_failed = output1.status[flag_type::carry]
                     != std::bitset<bit_count + 1>(op1 ^ op2 ^ (op1 - op2))[bit_count];
-                failed += value_failed || zf_failed || nf_failed || hf_failed || cf_failed;
+                const auto backend_failed = !subtraction_backends_match(op1, op2);
+                failed += value_failed || zf_failed || nf_failed || hf_failed || cf_failed || backend_failed;
             }
         }
 
@@ -130,11 +134,53 @@ namespace gameboy {
             }
         }
 
+#ifdef GAMEBOY_ALU_TABLES
+        for (auto status = 0; status < 16; ++status) {
+            for (auto number = 0; number < 256; ++number) {
+                const flags flag{static_cast<byte>(status << 4)};
+                const auto arithmetic = _alu.daa(static_cast<byte>(number), flag);
+                const auto table = _alu_table.daa(static_cast<byte>(number), flag);
+                failed += arithmetic.result != table.result || arithmetic.status != table.status;
+            }
+        }
+#endif
+
         std::cout << "Test Decimal Adjustment: failed = " << failed << std::endl;
 
         return failed == 0;
     }
 
+#ifdef GAMEBOY_ALU_TABLES
+    bool alu_test::addition_backends_match(byte operand1, byte operand2) const
+    {
+        // the tests walk half of the operand matrix without carry, so cover the mirrored half and ADC here
+        auto matched = true;
+        for (auto carry = 0; carry < 2; ++carry) {
+            for (const auto& operands : {std::make_pair(operand1, operand2), std::make_pair(operand2, operand1)}) {
+                const auto arithmetic = _alu.add(operands.first, operands.second, carry != 0);
+                const auto table = _alu_table.add(operands.first, operands.second, carry != 0);
+                matched &= arithmetic.result == table.result && arithmetic.status == table.status;
+            }
+        }
+
+        return matched;
+    }
+
+    bool alu_test::subtraction_backends_match(byte operand1, byte operand2) const
+    {
+        auto matched = true;
+        for (auto carry = 0; carry < 2; ++carry) {
+            for (const auto& operands : {std::make_pair(operand1, operand2), std::make_pair(operand2, operand1)}) {
+                const auto arithmetic = _alu.subtract(operands.first, operands.second, carry != 0);
+                const auto table = _alu_table.subtract(operands.first, operands.second, carry != 0);
+                matched &= arithmetic.result == table.result && arithmetic.status == table.status;
+            }
+        }
+
+        return matched;
+    }
+#endif
+
     template bool alu_test::test_addition<byte, byte>() const;
     template bool alu_test::test_addition<byte, sbyte>() const;
     template bool alu_test::test_addition<sbyte, sbyte>() const;
@@ -2,6 +2,9 @@
 #define ALU_TEST_H
 
 #include "alu.h"
+#ifdef GAMEBOY_ALU_TABLES
+#include "alu-table.h"
+#endif
 
 namespace gameboy {
     class alu_test {
@@ -15,7 +18,28 @@ namespace gameboy {
 
         bool test_daa() const;
     private:
+        // only the unsigned 8-bit paths have a table backend to compare against, when it is built
+        template<typename T, typename U>
+        bool addition_backends_match(T, U) const
+        {
+            return true;
+        }
+
+        template<typename T, typename U>
+        bool subtraction_backends_match(T, U) const
+        {
+            return true;
+        }
+
+#ifdef GAMEBOY_ALU_TABLES
+        bool addition_backends_match(byte operand1, byte operand2) const;
+        bool subtraction_backends_match(byte operand1, byte operand2) const;
+#endif
+
         gameboy::alu _alu;
+#ifdef GAMEBOY_ALU_TABLES
+        gameboy::alu_table _alu_table;
+#endif
     };
 }
 
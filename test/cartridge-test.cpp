@@ -0,0 +1,86 @@
+#include "cartridge-test.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include "cartridge.h"
+#include "memory.h"
+#include "test-helpers.h"
+
+namespace gameboy {
+    bool cartridge_test::test_loading() const
+    {
+        const std::string path = "gameboy-test-cartridge.gb";
+        const auto rejected = [&path](const std::vector<byte>& contents) {
+            if (!write_file(path, contents)) {
+                return false;
+            }
+            try {
+                cartridge::load(path);
+            }
+            catch (const std::runtime_error&) {
+                return true;
+            }
+            return false;
+        };
+
+        auto failed = 0;
+        failed += !write_file(path, make_rom(0x01, 0x01, 0x00, 4));
+        const auto shared = cartridge::load(path);
+        failed += shared->get_rom_banks() != 4 || shared->get_controller() != cartridge::controller::mbc1;
+        failed += !shared->has_valid_global_checksum();
+#if defined(__unix__) || defined(__APPLE__)
+        failed += !shared->is_mapped();
+#endif
+
+        // every memory reads the one image, and owns no more than the console's own RAM
+        std::vector<memory> instances(64);
+        for (auto& instance : instances) {
+            instance.insert(shared);
+            instance.set_byte(0x2000, 0x03);
+            failed += instance.get_byte(0x5000) != 3 || instance.get_footprint() > 0x8000;
+        }
+        failed += shared.use_count() != static_cast<long>(instances.size()) + 1;
+
+        // a part bank needs padding, so it is read in instead
+        auto odd = make_rom(0x00, 0x00, 0x00, 2);
+        odd.resize(odd.size() + 0x100);
+        failed += !write_file(path, odd);
+        const auto padded = cartridge::load(path);
+        failed += padded->is_mapped() || padded->get_rom_banks() != 3;
+
+        // nothing checks the global checksum, so it only gets reported
+        auto corrupted = make_rom(0x00, 0x00, 0x00, 2);
+        corrupted[0x7FFF] ^= 0xFF;
+        failed += !write_file(path, corrupted);
+        failed += cartridge::load(path)->has_valid_global_checksum();
+
+        auto bad_header = make_rom(0x00, 0x00, 0x00, 2);
+        bad_header[0x0134] = 'X';
+        failed += !rejected(bad_header);
+        // 128 KiB claimed, 64 KiB there
+        failed += !rejected(make_rom(0x01, 0x02, 0x00, 4));
+        // MBC2
+        failed += !rejected(make_rom(0x05, 0x00, 0x00, 2));
+
+        std::remove(path.c_str());
+        try {
+            cartridge::load(path);
+            ++failed;
+        }
+        catch (const std::runtime_error&) {
+        }
+
+        std::cout << "Test Cartridge Loading: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool cartridge_test::write_file(const std::string& path, const std::vector<byte>& contents)
+    {
+        std::ofstream output{path, std::ios::binary};
+        output.write(reinterpret_cast<const char*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+        return static_cast<bool>(output);
+    }
+}
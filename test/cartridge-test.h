@@ -0,0 +1,18 @@
+#ifndef CARTRIDGE_TEST_H
+#define CARTRIDGE_TEST_H
+
+#include <string>
+#include <vector>
+#include "byte.h"
+
+namespace gameboy {
+    class cartridge_test {
+    public:
+        // ROM files are mapped rather than copied, shared between memories, and refused when the header is wrong
+        bool test_loading() const;
+    private:
+        static bool write_file(const std::string& path, const std::vector<byte>& contents);
+    };
+}
+
+#endif
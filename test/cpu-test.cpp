@@ -1,7 +1,459 @@
 #include "cpu-test.h"
+#include <array>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include "cpu-handlers.h"
+#include "ppu.h"
+#include "test-helpers.h"
 
 namespace gameboy {
+    namespace {
+        using static_handler = int (cpu::*)(unsigned short, unsigned short);
+        using static_prefixed_handler = int (cpu::*)(unsigned short);
+
+        template<int... Opcodes>
+        std::array<static_handler, sizeof...(Opcodes)> get_static_handlers(std::integer_sequence<int, Opcodes...>)
+        {
+            return {{&cpu::run_static<Opcodes>...}};
+        }
+
+        template<int... Opcodes>
+        std::array<static_prefixed_handler, sizeof...(Opcodes)> get_static_prefixed_handlers(
+            std::integer_sequence<int, Opcodes...>)
+        {
+            return {{&cpu::run_static_prefixed<Opcodes>...}};
+        }
+    }
+
     cpu_test::cpu_test(memory& mem) : _cpu(mem)
     {
     }
-}
\ No newline at end of file
+
+    bool cpu_test::test_run_frame() const
+    {
+        constexpr auto lower_bound = std::numeric_limits<unsigned short>::min() + 0;
+        constexpr auto upper_bound = std::numeric_limits<unsigned short>::max() + 1;
+
+        // LD B, 0x06 over and over: 8 cycles per instruction never divides a frame evenly
+        memory program;
+        for (auto address = lower_bound; address < upper_bound; ++address) {
+            program.set_byte(address, '\x06');
+        }
+
+        // LD SP, 0x0808, and then LD (0x0808), SP over and over, which writes back the bytes it is made of: 20
+        // cycles per instruction never divides a frame evenly
+        memory frames;
+        for (auto address = lower_bound; address < upper_bound; ++address) {
+            frames.set_byte(address, 0x08);
+        }
+        frames.set_byte(0x0000, 0x31);
+
+        auto failed = 0;
+        cpu frame_cpu{frames};
+        auto time = 12ull;
+        for (auto frame = 1ull; frame <= 4; ++frame) {
+            // the overshoot carries over, so the instruction count per frame changes
+            const auto end = frame * cpu::CYCLES_PER_FRAME;
+            while (time < end) {
+                time += 20;
+            }
+            failed += frame_cpu.run_frame() != static_cast<int>(time - end);
+        }
+
+        // a frame is the LCD's, so JR -2 ends every one on the last line, after one more VBlank, however many run
+        memory screen;
+        screen.set_byte(0x0000, 0x18);
+        screen.set_byte(0x0001, 0xFE);
+        ppu video{screen};
+        cpu screen_cpu{screen};
+        for (auto frame = 1ull; frame <= 30; ++frame) {
+            failed += screen_cpu.run_frame() != 0;
+            failed += video.get_frames() != frame || screen.get_byte(ppu::LINE) != ppu::LINES - 1;
+        }
+
+        cpu budget_cpu{program};
+        failed += budget_cpu.run_until(100) != 4;
+        failed += budget_cpu.run_until(100) != 4;
+        failed += budget_cpu.run_until(101) != 3;
+
+        std::cout << "Test Run Frame: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool cpu_test::test_durations() const
+    {
+        memory mem;
+        cpu target{mem};
+        auto failed = 0;
+
+        // what the handlers return on plain memory, with operands pointing into WRAM
+        const auto handlers = get_static_handlers(std::make_integer_sequence<int, 0x100>{});
+        for (auto opcode = 0; opcode < 0x100; ++opcode) {
+            const auto& info = cpu::get_opcode_info(static_cast<byte>(opcode));
+            // control flow has a duration of its own for a branch taken, and the rest of what ends a block changes
+            // the interrupt state or throws; 0xCB is the prefixed page below
+            if (info.ends_block || opcode == 0xCB) {
+                continue;
+            }
+            failed += (target.*handlers[static_cast<std::size_t>(opcode)])(0xC000, 0x0100) != info.duration;
+        }
+
+        // the register and (HL) forms alike
+        const auto prefixed = get_static_prefixed_handlers(std::make_integer_sequence<int, 0x100>{});
+        for (auto opcode = 0; opcode < 0x100; ++opcode) {
+            const auto& info = cpu::get_prefixed_info(static_cast<byte>(opcode));
+            failed += (target.*prefixed[static_cast<std::size_t>(opcode)])(0x0100) != info.duration;
+        }
+
+        std::cout << "Test Durations: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool cpu_test::test_control_flow() const
+    {
+        memory program;
+        for (auto address = 0; address < 0x10000; ++address) {
+            program.set_byte(address, '\x00');
+        }
+
+        // LD SP, 0xFFFE; LD A, 5; LD B, 0; loop: INC B; DEC A; JR NZ, loop; CALL 0x0020; JP 0x0100
+        const byte main[] = {0x31, 0xFE, 0xFF, 0x3E, 0x05, 0x06, 0x00, 0x04, 0x3D, 0x20, 0xFC, 0xCD, 0x20, 0x00, 0xC3, 0x00, 0x01};
+        // LD C, 0x2A; RET
+        const byte subroutine[] = {0x0E, 0x2A, 0xC9};
+        // JR -2
+        const byte halt_loop[] = {0x18, 0xFE};
+        for (auto index = 0; index < static_cast<int>(sizeof(main)); ++index) {
+            program.set_byte(index, main[index]);
+        }
+        for (auto index = 0; index < static_cast<int>(sizeof(subroutine)); ++index) {
+            program.set_byte(0x20 + index, subroutine[index]);
+        }
+        for (auto index = 0; index < static_cast<int>(sizeof(halt_loop)); ++index) {
+            program.set_byte(0x100 + index, halt_loop[index]);
+        }
+
+        cpu flow_cpu{program};
+        for (auto step = 0; step < 30; ++step) {
+            flow_cpu.fetch_and_execute();
+        }
+
+        const auto& registers = flow_cpu.get_registers();
+        auto failed = 0;
+        failed += registers.accumulator != 0x00;
+        failed += registers.general_bc.bytes.high != 0x05;
+        failed += registers.general_bc.bytes.low != 0x2A;
+        failed += registers.program_counter != 0x0100;
+        failed += registers.stack_pointer != 0xFFFE;
+        failed += !registers.flag[flag_type::zero];
+
+        std::cout << "Test Control Flow: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool cpu_test::test_high_page() const
+    {
+        memory program;
+        // LD A, 0x42; LD C, 0x80; LD (C), A; LD A, 0; LD A, (C); LDH (0x81), A; LD HL, SP-1
+        const byte code[] = {0x3E, 0x42, 0x0E, 0x80, 0xE2, 0x3E, 0x00, 0xF2, 0xE0, 0x81, 0xF8, 0xFF};
+        for (auto index = 0; index < static_cast<int>(sizeof(code)); ++index) {
+            program.set_byte(index, code[index]);
+        }
+
+        cpu high_cpu{program};
+        for (auto step = 0; step < 7; ++step) {
+            high_cpu.fetch_and_execute();
+        }
+
+        const auto& registers = high_cpu.get_registers();
+        auto failed = 0;
+        failed += program.get_byte(0xFF80) != 0x42;
+        failed += program.get_byte(0xFF81) != 0x42;
+        failed += registers.accumulator != 0x42;
+        // SP starts at 0, so SP-1 wraps without any carry out of the low byte
+        failed += registers.general_hl.value != 0xFFFF;
+        failed += registers.flag[flag_type::zero] || registers.flag[flag_type::carry] || registers.flag[flag_type::half_carry];
+
+        std::cout << "Test High Page: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool cpu_test::test_prefixed() const
+    {
+        auto failed = 0;
+
+        // every CB opcode on A, for every value and both carry states, against a straightforward model
+        for (auto opcode = 0x07; opcode < 0x100; opcode += 8) {
+            for (auto value = 0; value < 0x100; ++value) {
+                for (auto carry = 0; carry < 2; ++carry) {
+                    // LD A, value; SCF; CCF or NOP; CB opcode
+                    memory program;
+                    const byte code[] = {0x3E, static_cast<byte>(value), 0x37, static_cast<byte>(carry ? 0x00 : 0x3F), 0xCB, static_cast<byte>(opcode)};
+                    for (auto index = 0; index < static_cast<int>(sizeof(code)); ++index) {
+                        program.set_byte(index, code[index]);
+                    }
+
+                    // the set-up takes 16 cycles, so the CB instruction is the one crossing cycle 17
+                    cpu prefixed_cpu{program};
+                    const auto cycles = prefixed_cpu.run_until(17) + 1;
+
+                    const auto operation = opcode >> 3 & 7;
+                    const auto bit = 1 << operation;
+                    auto result = value;
+                    auto zero = false, half_carry = false, carry_out = carry != 0;
+                    switch (opcode >> 6) {
+                    case 0:
+                        switch (operation) {
+                        case 0:
+                            result = (value << 1 | value >> 7) & 0xFF;
+                            carry_out = (value & 0x80) != 0;
+                            break;
+                        case 1:
+                            result = (value >> 1 | value << 7) & 0xFF;
+                            carry_out = (value & 0x01) != 0;
+                            break;
+                        case 2:
+                            result = (value << 1 | carry) & 0xFF;
+                            carry_out = (value & 0x80) != 0;
+                            break;
+                        case 3:
+                            result = value >> 1 | carry << 7;
+                            carry_out = (value & 0x01) != 0;
+                            break;
+                        case 4:
+                            result = value << 1 & 0xFF;
+                            carry_out = (value & 0x80) != 0;
+                            break;
+                        case 5:
+                            result = value >> 1 | (value & 0x80);
+                            carry_out = (value & 0x01) != 0;
+                            break;
+                        case 6:
+                            result = (value << 4 | value >> 4) & 0xFF;
+                            carry_out = false;
+                            break;
+                        default:
+                            result = value >> 1;
+                            carry_out = (value & 0x01) != 0;
+                            break;
+                        }
+                        zero = result == 0;
+                        break;
+                    case 1:
+                        zero = (value & bit) == 0;
+                        half_carry = true;
+                        break;
+                    case 2:
+                        result = value & ~bit;
+                        break;
+                    default:
+                        result = value | bit;
+                        break;
+                    }
+
+                    const auto& registers = prefixed_cpu.get_registers();
+                    // RES/SET leave the flags as SCF/CCF left them: N and H cleared
+                    failed += registers.accumulator != result
+                        || registers.flag[flag_type::zero] != (opcode >> 6 < 2 ? zero : false)
+                        || registers.flag[flag_type::subtract]
+                        || registers.flag[flag_type::half_carry] != half_carry
+                        || registers.flag[flag_type::carry] != carry_out
+                        || cycles != 8;
+                }
+            }
+        }
+
+        // (HL) operands: LD HL, 0xC000; LD (HL), 0x0F; SWAP (HL); SET 0, (HL); BIT 0, (HL); RES 4, (HL)
+        memory program;
+        const byte code[] = {0x21, 0x00, 0xC0, 0x36, 0x0F, 0xCB, 0x36, 0xCB, 0xC6, 0xCB, 0x46, 0xCB, 0xA6};
+        for (auto index = 0; index < static_cast<int>(sizeof(code)); ++index) {
+            program.set_byte(index, code[index]);
+        }
+
+        cpu indirect_cpu{program};
+        auto elapsed = indirect_cpu.run_until(24) + 24;
+        // runs exactly one instruction and returns its cycle count
+        const auto step = [&indirect_cpu, &elapsed]() {
+            const auto cycles = indirect_cpu.run_until(elapsed + 1) + 1;
+            elapsed += cycles;
+            return cycles;
+        };
+        failed += step() != 16;
+        failed += program.get_byte(0xC000) != 0xF0;
+        failed += step() != 16;
+        failed += program.get_byte(0xC000) != 0xF1;
+        failed += step() != 12;
+        failed += indirect_cpu.get_registers().flag[flag_type::zero];
+        failed += step() != 16;
+        failed += program.get_byte(0xC000) != 0xE1;
+
+        std::cout << "Test Prefixed: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool cpu_test::test_block_cache() const
+    {
+        memory blank;
+        for (auto address = 0; address < 0x10000; ++address) {
+            blank.set_byte(address, '\x00');
+        }
+
+        // every opcode, then every CB opcode, with zero operands and a JR back to it; the budgets split the
+        // run at different points, so any wrong cycle total in a block shows up as a different overshoot
+        const int budgets[] = {1, 5, 13, 29, 64, 200, 1000};
+        auto failed = 0;
+        for (auto index = 0; index < 0x200; ++index) {
+            for (const auto budget : budgets) {
+                memory interpreted_memory = blank;
+                memory cached_memory = blank;
+                const auto prefixed = index >= 0x100;
+                interpreted_memory.set_byte(0, static_cast<byte>(prefixed ? 0xCB : index));
+                cached_memory.set_byte(0, static_cast<byte>(prefixed ? 0xCB : index));
+                interpreted_memory.set_byte(1, static_cast<byte>(prefixed ? index - 0x100 : 0));
+                cached_memory.set_byte(1, static_cast<byte>(prefixed ? index - 0x100 : 0));
+                for (auto address = 3; address < 5; ++address) {
+                    interpreted_memory.set_byte(address, address == 3 ? 0x18 : 0xFB);
+                    cached_memory.set_byte(address, address == 3 ? 0x18 : 0xFB);
+                }
+
+                cpu interpreted{interpreted_memory};
+                cpu cached{cached_memory};
+                cached.enable_block_cache(true);
+                auto interpreted_overshoot = -1, cached_overshoot = -1;
+                try {
+                    interpreted_overshoot = interpreted.run_until(budget);
+                }
+                catch (const std::runtime_error&) {
+                }
+                try {
+                    cached_overshoot = cached.run_until(budget);
+                }
+                catch (const std::runtime_error&) {
+                }
+
+                failed += interpreted_overshoot != cached_overshoot
+                    || !same_registers(interpreted.get_registers(), cached.get_registers());
+            }
+        }
+
+        std::cout << "Test Block Cache: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool cpu_test::test_fusion() const
+    {
+        memory blank;
+        for (auto address = 0; address < 0x10000; ++address) {
+            blank.set_byte(address, '\x00');
+        }
+
+        // every fused sequence in a loop: copies both ways counted by DEC B / DEC C, a DEC BC countdown and the
+        // polling forms on 0xFF80/0xFF81, then a copy at 0x0100 that overwrites its own INC DE with INC E, and one
+        // at 0x01F0 doing the same at the end of its page, where it is the last entry of its block
+        const byte code[] = {
+            0x21, 0x00, 0xC0, 0x11, 0x00, 0xD0, 0x06, 0x10,
+            0x2A, 0x12, 0x13, 0x05, 0x20, 0xFA,
+            0x0E, 0x08,
+            0x1A, 0x22, 0x13, 0x0D, 0x20, 0xFA,
+            0x01, 0x20, 0x00,
+            0x0B, 0x78, 0xB1, 0x20, 0xFB,
+            0xF0, 0x80, 0xFE, 0x03, 0x20, 0x04,
+            0xF0, 0x81, 0xE6, 0x01,
+            0x28, 0x02, 0x3C, 0x3C,
+            0x21, 0x80, 0xFF, 0x34,
+            0xF0, 0x80, 0xE6, 0x02, 0x28, 0x01, 0x04,
+            0xF0, 0x81, 0xFE, 0x00, 0x20, 0xC3,
+            0xC3, 0x00, 0x01};
+        const byte rewriting[] = {0x21, 0x00, 0xC0, 0x11, 0x08, 0x01, 0x2A, 0x12, 0x13, 0xC3, 0xF0, 0x01};
+        const byte boundary[] = {0x21, 0x00, 0xC0, 0x11, 0xFF, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x2A, 0x12, 0x13, 0xC3, 0x00, 0x00};
+        for (auto index = 0; index < static_cast<int>(sizeof(code)); ++index) {
+            blank.set_byte(index, code[index]);
+        }
+        for (auto index = 0; index < static_cast<int>(sizeof(rewriting)); ++index) {
+            blank.set_byte(0x100 + index, rewriting[index]);
+        }
+        for (auto index = 0; index < static_cast<int>(sizeof(boundary)); ++index) {
+            blank.set_byte(0x1F0 + index, boundary[index]);
+        }
+        for (auto address = 0xC000; address < 0xC020; ++address) {
+            blank.set_byte(address, static_cast<byte>(0x1C + address));
+        }
+
+        auto failed = 0;
+        // budgets long enough for whole blocks to run, ending at different points inside the fused sequences
+        for (auto step = 7; step < 400; step += 29) {
+            memory interpreted_memory = blank;
+            memory fused_memory = blank;
+            cpu interpreted{interpreted_memory};
+            cpu fused{fused_memory};
+            fused.enable_block_cache(true);
+            fused.enable_fusion(true);
+
+            for (auto budget = step; budget < 20000; budget += step) {
+                failed += interpreted.run_until(budget) != fused.run_until(budget);
+                failed += !same_registers(interpreted.get_registers(), fused.get_registers());
+            }
+            for (auto address = 0; address < 0x10000; ++address) {
+                failed += interpreted_memory.get_byte(address) != fused_memory.get_byte(address);
+            }
+            failed += fused.get_fused_sequences() < 9;
+        }
+
+        std::cout << "Test Fusion: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool cpu_test::test_self_modifying_code() const
+    {
+        memory blank;
+        for (auto address = 0; address < 0x10000; ++address) {
+            blank.set_byte(address, '\x00');
+        }
+
+        // LD HL, 0x000B; LD (HL), 0x0C; LD A, 0; NOP x 4; INC B, already rewritten to INC C by then
+        // LD HL, 0x0120; loop: CALL 0x0120; LD (HL), 0x1C; JR loop
+        // 0x0120: INC D, rewritten to INC E after the first call; RET
+        const byte code[] = {0x21, 0x0B, 0x00, 0x36, 0x0C, 0x3E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04,
+            0x21, 0x20, 0x01, 0xCD, 0x20, 0x01, 0x36, 0x1C, 0x18, 0xF9};
+        const byte routine[] = {0x14, 0xC9};
+        for (auto index = 0; index < static_cast<int>(sizeof(code)); ++index) {
+            blank.set_byte(index, code[index]);
+        }
+        for (auto index = 0; index < static_cast<int>(sizeof(routine)); ++index) {
+            blank.set_byte(0x120 + index, routine[index]);
+        }
+
+        memory interpreted_memory = blank;
+        memory cached_memory = blank;
+        cpu interpreted{interpreted_memory};
+        cpu cached{cached_memory};
+        cached.enable_block_cache(true);
+
+        auto failed = 0;
+        for (auto budget = 100; budget < 5000; budget += 100) {
+            failed += interpreted.run_until(budget) != cached.run_until(budget);
+            failed += !same_registers(interpreted.get_registers(), cached.get_registers());
+        }
+
+        const auto& registers = cached.get_registers();
+        failed += registers.general_bc.bytes.high != 0x00;
+        failed += registers.general_bc.bytes.low != 0x01;
+        failed += registers.general_de.bytes.high != 0x01;
+        failed += registers.general_de.bytes.low < 0x10;
+        failed += cached.get_block_cache().get_hits() == 0;
+        failed += cached.get_block_cache().get_invalidations() == 0;
+
+        std::cout << "Test Self Modifying Code: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+}
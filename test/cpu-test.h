@@ -8,6 +8,16 @@ namespace gameboy {
     class cpu_test {
     public:
         cpu_test(memory& mem);
+
+        bool test_run_frame() const;
+        // the cycles the opcode tables give every instruction that does not branch against what its handler returns
+        bool test_durations() const;
+        bool test_control_flow() const;
+        bool test_high_page() const;
+        bool test_prefixed() const;
+        bool test_block_cache() const;
+        bool test_fusion() const;
+        bool test_self_modifying_code() const;
     private:
         cpu _cpu;
     };
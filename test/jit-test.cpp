@@ -0,0 +1,154 @@
+#include "jit-test.h"
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "test-helpers.h"
+
+namespace gameboy {
+#ifdef GAMEBOY_JIT
+    bool jit_test::test_lockstep() const
+    {
+        // all 8-bit register work and the CB page, plus memory and stack accesses the translated code hands back
+        // to the interpreter, some of them into the program itself
+        std::vector<std::vector<int>> choices;
+        for (auto opcode = 0x40; opcode < 0xC0; ++opcode) {
+            if (opcode != 0x76) {
+                choices.push_back({opcode});
+            }
+        }
+        for (auto y = 0; y < 8; ++y) {
+            choices.push_back({y << 3 | 4});
+            choices.push_back({y << 3 | 5});
+            choices.push_back({y << 3 | 6, -1});
+            choices.push_back({0xC6 | y << 3, -1});
+            choices.push_back({y << 3 | 7});
+        }
+        for (auto pair = 0; pair < 3; ++pair) {
+            choices.push_back({pair << 4 | 0x01, -1, -1});
+            choices.push_back({pair << 4 | 0x03});
+            choices.push_back({pair << 4 | 0x0B});
+            choices.push_back({pair << 4 | 0x09});
+            choices.push_back({0xC5 | pair << 4, 0xC1 | (pair + 1) % 3 << 4});
+        }
+        for (const auto opcode : {0x22, 0x2A, 0x32, 0x3A, 0x34, 0x35}) {
+            choices.push_back({opcode});
+        }
+        // LD HL, 0x01nn; INC (HL): the loop rewrites itself, often enough to hit blocks that are already translated
+        for (auto copy = 0; copy < 6; ++copy) {
+            choices.push_back({0x21, -1, 0x01, 0x34});
+        }
+        for (auto prefixed = 0; prefixed < 0x100; prefixed += 3) {
+            choices.push_back({0xCB, prefixed});
+        }
+
+        std::default_random_engine generator{42};
+        std::uniform_int_distribution<std::size_t> choice{0, choices.size() - 1};
+        std::uniform_int_distribution<int> value{0, 0xFF};
+        std::uniform_int_distribution<int> length{1, 24};
+
+        auto failed = 0;
+        auto compiled = 0;
+        for (auto program = 0; program < 300; ++program) {
+            memory reference_memory;
+            for (auto address = 0; address < 0x10000; ++address) {
+                reference_memory.set_byte(address, '\x00');
+            }
+
+            // 0x0100: body; JR cc, 0x0100; JP 0x0100
+            auto address = 0x0100;
+            const auto body_length = length(generator);
+            for (auto instruction = 0; instruction < body_length; ++instruction) {
+                for (const auto part : choices[choice(generator)]) {
+                    reference_memory.set_byte(address++, static_cast<byte>(part < 0 ? value(generator) : part));
+                }
+            }
+            reference_memory.set_byte(address, static_cast<byte>(0x20 | (value(generator) & 0x18)));
+            reference_memory.set_byte(address + 1, static_cast<byte>(0x100 - (address + 2)));
+            reference_memory.set_byte(address + 2, 0xC3);
+            reference_memory.set_byte(address + 3, 0x00);
+            reference_memory.set_byte(address + 4, 0x01);
+            // JP 0x0100 at reset
+            reference_memory.set_byte(0, 0xC3);
+            reference_memory.set_byte(1, 0x00);
+            reference_memory.set_byte(2, 0x01);
+
+            memory native_memory = reference_memory;
+            cpu reference{reference_memory};
+            cpu native{native_memory};
+            native.enable_jit(true);
+
+            auto elapsed = 0;
+            auto raised = false;
+            for (auto block = 0; block < 2000 && !raised; ++block) {
+                try {
+                    elapsed += native.step_block();
+                }
+                catch (const std::runtime_error&) {
+                    // the program wrote an invalid opcode over itself, which the interpreter has to run into too
+                    raised = true;
+                    auto reference_raised = false;
+                    try {
+                        reference.run_until(elapsed + 10000);
+                    }
+                    catch (const std::runtime_error&) {
+                        reference_raised = true;
+                    }
+                    failed += !reference_raised;
+                    break;
+                }
+                failed += reference.run_until(elapsed) != 0;
+                failed += !same_registers(reference.get_registers(), native.get_registers());
+            }
+            for (auto address = 0; address < 0x10000 && !raised; ++address) {
+                failed += reference_memory.get_byte(address) != native_memory.get_byte(address);
+            }
+            compiled += native.get_jit().get_compiled_blocks();
+        }
+
+        // the loops have to have been hot enough to run natively for any of this to mean something
+        failed += compiled == 0;
+
+        std::cout << "Test JIT Lockstep: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool jit_test::test_rewrites() const
+    {
+        auto failed = 0;
+
+        // CALL 0xC000 ten times, writing into its page after each, and then INC C; JR -3 at 0xC010, which is new
+        // code however often its page was written before
+        const auto busy = make_program({{0x0000, {0xC3, 0x00, 0x01}},
+            {0x0100, {0x31, 0xF0, 0xDF, 0x06, 0x0A, 0xCD, 0x00, 0xC0, 0xEA, 0x01, 0xC0, 0x05, 0x20, 0xF7, 0xC3, 0x10, 0xC0}},
+            {0xC000, {0xC9}}, {0xC010, {0x0C, 0x18, 0xFD}}});
+        {
+            memory mem = busy;
+            cpu fresh{mem};
+            fresh.enable_jit(true);
+            fresh.run_frame();
+            failed += fresh.get_jit().get_compiled_blocks() == 0;
+        }
+
+        // 40 rounds of CALL 0xC000 sixteen times, which makes LD A, n; RET there hot, and then a write over n: it
+        // is translated again only so often
+        const auto rewritten = make_program({{0x0000, {0xC3, 0x00, 0x01}},
+            {0x0100, {0x31, 0xF0, 0xDF, 0x06, 0x28, 0x0E, 0x10, 0xCD, 0x00, 0xC0, 0x0D, 0x20, 0xFA, 0xEA, 0x01, 0xC0, 0x05,
+                0x20, 0xF2, 0xC3, 0x10, 0xC0}},
+            {0xC000, {0x3E, 0x00, 0xC9}}, {0xC010, {0x0C, 0x18, 0xFD}}});
+        {
+            memory mem = rewritten;
+            cpu churning{mem};
+            churning.enable_jit(true);
+            churning.run_frame();
+            const auto compiled = churning.get_jit().get_compiled_blocks();
+            failed += compiled < jit::REWRITE_LIMIT || compiled > jit::REWRITE_LIMIT + 8;
+        }
+
+        std::cout << "Test JIT Rewrites: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+#endif
+}
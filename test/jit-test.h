@@ -0,0 +1,17 @@
+#ifndef JIT_TEST_H
+#define JIT_TEST_H
+
+#include "cpu.h"
+#include "memory.h"
+
+namespace gameboy {
+    class jit_test {
+    public:
+        // random loops run on the recompiler and the interpreter side by side, registers compared after every block
+        bool test_lockstep() const;
+        // fresh code on a page written many times is translated, and code rewritten over and over only so often
+        bool test_rewrites() const;
+    };
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "lazy-flags-test.h"
+#include <iostream>
+
+namespace gameboy {
+    bool lazy_flags_test::test_arithmetic() const
+    {
+        auto failed = 0;
+        for (auto i = 0; i < 256; ++i) {
+            for (auto j = 0; j < 256; ++j) {
+                for (auto carry = 0; carry < 2; ++carry) {
+                    const auto op1 = static_cast<byte>(i), op2 = static_cast<byte>(j);
+                    lazy_flags sum, difference;
+                    sum.record_add(op1, op2, carry != 0);
+                    difference.record_subtract(op1, op2, carry != 0);
+                    // single flags are decoded on their own path, so check the carry as well as the whole byte
+                    const auto cf_failed = sum[flag_type::carry] != _alu.add(op1, op2, carry != 0).status[flag_type::carry]
+                        || difference[flag_type::carry] != _alu.subtract(op1, op2, carry != 0).status[flag_type::carry];
+                    const auto sum_failed = static_cast<byte>(sum) != _alu.add(op1, op2, carry != 0).status;
+                    const auto difference_failed = static_cast<byte>(difference)
+                        != _alu.subtract(op1, op2, carry != 0).status;
+                    failed += cf_failed || sum_failed || difference_failed;
+                }
+            }
+        }
+
+        std::cout << "Test Lazy Flags Arithmetic: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool lazy_flags_test::test_increment() const
+    {
+        auto failed = 0;
+        for (auto i = 0; i < 256; ++i) {
+            for (auto j = 0; j < 256; ++j) {
+                const auto op1 = static_cast<byte>(i), op2 = static_cast<byte>(j);
+                // INC/DEC keep the carry of whatever pending operation came before them
+                lazy_flags lazy;
+                flags eager;
+                lazy.record_add(op1, op2, false);
+                eager = _alu.add(op1, op2).status;
+                lazy.record_increment(op2);
+                eager.assign<true, true, true, false>(_alu.add(op2, 1).status);
+                failed += static_cast<byte>(lazy) != eager;
+
+                lazy.record_subtract(op1, op2, false);
+                eager = _alu.subtract(op1, op2).status;
+                lazy.record_decrement(op2);
+                eager.assign<true, true, true, false>(_alu.subtract(op2, 1).status);
+                failed += static_cast<byte>(lazy) != eager;
+            }
+        }
+
+        std::cout << "Test Lazy Flags Increment: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef LAZY_FLAGS_TEST_H
+#define LAZY_FLAGS_TEST_H
+
+#include "alu.h"
+#include "lazy-flags.h"
+
+namespace gameboy {
+    class lazy_flags_test {
+    public:
+        bool test_arithmetic() const;
+        bool test_increment() const;
+    private:
+        gameboy::alu _alu;
+    };
+}
+
+#endif
@@ -6,7 +6,18 @@
 #include <thread>
 #include <unordered_map>
 #include "alu-test.h"
+#include "cartridge-test.h"
 #include "cpu-test.h"
+#include "jit-test.h"
+#include "lazy-flags-test.h"
+#include "memory-test.h"
+#include "opcode-profile-test.h"
+#include "ppu-test.h"
+#include "recompiler-test.h"
+#include "scheduler-test.h"
+#include "shared-export-test.h"
+#include "stream-sink-test.h"
+#include "timer-test.h"
 
 int main()
 {
@@ -26,6 +37,19 @@ int main()
 
     alu_test test_alu;
     cpu_test test_cpu{test_memory};
+    lazy_flags_test test_lazy_flags;
+#ifdef GAMEBOY_JIT
+    jit_test test_jit;
+#endif
+    memory_test test_memory_map;
+    cartridge_test test_cartridge;
+    opcode_profile_test test_opcode_profile;
+    ppu_test test_ppu;
+    recompiler_test test_recompiler;
+    scheduler_test test_scheduler;
+    shared_export_test test_shared_export;
+    stream_sink_test test_stream_sink;
+    timer_test test_timer;
 
     ++result[test_alu.test_addition<byte, byte>()];
     ++result[test_alu.test_addition<byte, sbyte>()];
@@ -36,6 +60,49 @@ int main()
     ++result[test_alu.test_shift_left<byte>()];
     ++result[test_alu.test_shift_left<unsigned short>()];
     ++result[test_alu.test_daa()];
+    ++result[test_cpu.test_run_frame()];
+    ++result[test_cpu.test_durations()];
+    ++result[test_cpu.test_control_flow()];
+    ++result[test_cpu.test_high_page()];
+    ++result[test_cpu.test_prefixed()];
+    ++result[test_cpu.test_block_cache()];
+    ++result[test_cpu.test_fusion()];
+    ++result[test_cpu.test_self_modifying_code()];
+    ++result[test_lazy_flags.test_arithmetic()];
+    ++result[test_lazy_flags.test_increment()];
+    ++result[test_memory_map.test_controllers()];
+    ++result[test_memory_map.test_mapping()];
+    ++result[test_memory_map.test_banked_code()];
+    ++result[test_cartridge.test_loading()];
+    ++result[test_opcode_profile.test_runs()];
+    ++result[test_recompiler.test_walk()];
+    ++result[test_recompiler.test_lockstep()];
+    ++result[test_scheduler.test_ordering()];
+    ++result[test_scheduler.test_interrupts()];
+    ++result[test_scheduler.test_serial()];
+    ++result[test_timer.test_divider()];
+    ++result[test_timer.test_overflow()];
+    ++result[test_timer.test_writes()];
+    ++result[test_timer.test_program()];
+    ++result[test_timer.test_halt()];
+    ++result[test_timer.test_idle_loops()];
+    ++result[test_ppu.test_decoder()];
+    ++result[test_ppu.test_compositor()];
+    ++result[test_ppu.test_timing()];
+    ++result[test_ppu.test_render()];
+    ++result[test_ppu.test_tile_cache()];
+    ++result[test_ppu.test_render_skip()];
+    ++result[test_ppu.test_threading()];
+    ++result[test_ppu.test_framebuffer()];
+    ++result[test_ppu.test_program()];
+    ++result[test_shared_export.test_snapshots()];
+    ++result[test_stream_sink.test_video()];
+    ++result[test_stream_sink.test_audio()];
+    ++result[test_stream_sink.test_overflow()];
+#ifdef GAMEBOY_JIT
+    ++result[test_jit.test_lockstep()];
+    ++result[test_jit.test_rewrites()];
+#endif
 #ifdef TIME_CONSUMING
     ++result[test_alu.test_addition<unsigned short, unsigned short>()];
     ++result[test_alu.test_addition<short, short>()];
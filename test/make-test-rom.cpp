@@ -0,0 +1,23 @@
+#include <fstream>
+#include <iostream>
+#include "test-rom.h"
+
+// gameboy-test-rom <output>
+int main(int argc, char* argv[])
+{
+    using namespace gameboy;
+
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <output>" << std::endl;
+        return 1;
+    }
+
+    memory rom;
+    load_test_rom(rom);
+    std::ofstream output{argv[1], std::ios::binary};
+    for (auto address = 0; address < 0x8000; ++address) {
+        output.put(static_cast<char>(rom.get_byte(address)));
+    }
+
+    return output ? 0 : 1;
+}
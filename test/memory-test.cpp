@@ -0,0 +1,329 @@
+#include "memory-test.h"
+#include <initializer_list>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "cartridge.h"
+#include "cpu-handlers.h"
+#include "cpu.h"
+#include "test-helpers.h"
+
+namespace gameboy {
+    namespace {
+        std::shared_ptr<const cartridge> make_cartridge(byte type, byte ram_size, int banks)
+        {
+            return std::make_shared<const cartridge>(make_rom(type, 0x00, ram_size, banks));
+        }
+
+        int lower_bank(const memory& mem)
+        {
+            return mem.get_byte(0x1000) | mem.get_byte(0x1001) << 8;
+        }
+
+        int upper_bank(const memory& mem)
+        {
+            return mem.get_byte(0x5000) | mem.get_byte(0x5001) << 8;
+        }
+
+        class recording_handler : public memory::handler {
+        public:
+            byte read(int address) override
+            {
+                return static_cast<byte>(address);
+            }
+
+            void write(int address, byte value) override
+            {
+                last_address = address;
+                last_value = value;
+            }
+
+            int last_address = 0;
+            byte last_value = 0;
+        };
+
+        // 0x4000 as gameboy-recompile would have translated it from bank 1
+        int bank_one(cpu& target)
+        {
+            target.run_static<0x7B>(0, 0x4001);
+            target.run_static<0xC6>(3, 0x4003);
+            target.run_static<0x5F>(0, 0x4004);
+            target.run_static<0x7A>(0, 0x4005);
+            target.run_static<0xCE>(0, 0x4007);
+            target.run_static<0x57>(0, 0x4008);
+            return 32 + target.run_static<0xC9>(0, 0x4009);
+        }
+
+        const recompiled_block bank_one_blocks[] = {{0x4000, 32, 0x40, 0x40, 1, 1, &bank_one}};
+    }
+
+    bool memory_test::test_controllers() const
+    {
+        auto failed = 0;
+
+        memory plain;
+        plain.insert(make_cartridge(0x00, 0x00, 2));
+        failed += lower_bank(plain) != 0 || upper_bank(plain) != 1;
+        plain.set_byte(0x2000, 0x05);
+        plain.set_byte(0xA000, 0x12);
+        failed += upper_bank(plain) != 1 || plain.get_byte(0xA000) != 0xFF;
+
+        memory mbc1;
+        mbc1.insert(make_cartridge(0x03, 0x03, 128));
+        failed += lower_bank(mbc1) != 0 || upper_bank(mbc1) != 1;
+        mbc1.set_byte(0x2000, 0x00);
+        failed += upper_bank(mbc1) != 1;
+        mbc1.set_byte(0x2000, 0x05);
+        failed += upper_bank(mbc1) != 0x05;
+        mbc1.set_byte(0x4000, 0x01);
+        failed += upper_bank(mbc1) != 0x25 || lower_bank(mbc1) != 0;
+        mbc1.set_byte(0x2000, 0x00);
+        failed += upper_bank(mbc1) != 0x21;
+        mbc1.set_byte(0x6000, 0x01);
+        failed += lower_bank(mbc1) != 0x20 || upper_bank(mbc1) != 0x21;
+        // RAM is off until enabled, and the upper bits select its bank only in the advanced mode
+        failed += mbc1.get_byte(0xA000) != 0xFF;
+        mbc1.set_byte(0x0000, 0x0A);
+        mbc1.set_byte(0xA000, 0x12);
+        mbc1.set_byte(0x4000, 0x00);
+        failed += mbc1.get_byte(0xA000) != 0x00;
+        mbc1.set_byte(0x4000, 0x01);
+        failed += mbc1.get_byte(0xA000) != 0x12;
+        mbc1.set_byte(0x6000, 0x00);
+        failed += mbc1.get_byte(0xA000) != 0x00 || lower_bank(mbc1) != 0;
+        mbc1.set_byte(0x0000, 0x00);
+        failed += mbc1.get_byte(0xA000) != 0xFF;
+
+        memory small;
+        small.insert(make_cartridge(0x01, 0x00, 4));
+        small.set_byte(0x2000, 0x06);
+        failed += upper_bank(small) != 2;
+
+        memory mbc3;
+        mbc3.insert(make_cartridge(0x10, 0x03, 128));
+        mbc3.set_byte(0x2000, 0x00);
+        failed += upper_bank(mbc3) != 1;
+        mbc3.set_byte(0x2000, 0x7F);
+        failed += upper_bank(mbc3) != 0x7F || lower_bank(mbc3) != 0;
+        mbc3.set_byte(0x0000, 0x0A);
+        mbc3.set_byte(0x4000, 0x02);
+        mbc3.set_byte(0xBFFF, 0x34);
+        mbc3.set_byte(0x4000, 0x00);
+        failed += mbc3.get_byte(0xBFFF) != 0x00;
+        mbc3.set_byte(0x4000, 0x02);
+        failed += mbc3.get_byte(0xBFFF) != 0x34;
+        // the seconds register reads back only once latched
+        mbc3.set_byte(0x4000, 0x08);
+        mbc3.set_byte(0xA000, 0x2A);
+        failed += mbc3.get_byte(0xA000) != 0x00;
+        mbc3.set_byte(0x6000, 0x00);
+        mbc3.set_byte(0x6000, 0x01);
+        failed += mbc3.get_byte(0xA000) != 0x2A;
+        mbc3.set_byte(0x4000, 0x02);
+        failed += mbc3.get_byte(0xBFFF) != 0x34;
+
+        memory mbc5;
+        mbc5.insert(make_cartridge(0x1B, 0x04, 512));
+        failed += upper_bank(mbc5) != 1;
+        mbc5.set_byte(0x2000, 0x00);
+        failed += upper_bank(mbc5) != 0;
+        mbc5.set_byte(0x2000, 0x34);
+        mbc5.set_byte(0x3000, 0x01);
+        failed += upper_bank(mbc5) != 0x134 || lower_bank(mbc5) != 0;
+        failed += mbc5.get_page_bank(0x40) != 0x134 || mbc5.get_page_bank(0x00) != 0;
+        mbc5.set_byte(0x0000, 0x0A);
+        mbc5.set_byte(0x4000, 0x0F);
+        mbc5.set_byte(0xA123, 0x56);
+        mbc5.set_byte(0x4000, 0x0E);
+        failed += mbc5.get_byte(0xA123) != 0x00;
+        mbc5.set_byte(0x4000, 0x0F);
+        failed += mbc5.get_byte(0xA123) != 0x56;
+
+        std::cout << "Test Memory Controllers: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool memory_test::test_mapping() const
+    {
+        auto failed = 0;
+
+        // without a cartridge every address is plain RAM
+        memory flat;
+        flat.set_byte(0x0000, 0x12);
+        flat.set_byte(0xE000, 0x34);
+        failed += flat.get_byte(0x0000) != 0x12 || flat.get_byte(0xC000) == 0x34;
+
+        memory mapped;
+        mapped.insert(make_cartridge(0x19, 0x02, 8));
+        mapped.set_byte(0xC123, 0x42);
+        mapped.set_byte(0xFD00, 0x43);
+        failed += mapped.get_byte(0xE123) != 0x42 || mapped.get_byte(0xDD00) != 0x43;
+
+        // code watched through one side of echo RAM is rewritten through the other
+        mapped.mark_code(0xC1);
+        const auto work_version = mapped.get_page_version(0xC1);
+        const auto echo_version = mapped.get_page_version(0xE1);
+        mapped.set_byte(0xE150, 0x00);
+        failed += mapped.get_page_version(0xC1) == work_version || mapped.get_page_version(0xE1) == echo_version;
+
+        // a bank switch under watched ROM stops the code running, but keeps what was decoded from either bank
+        mapped.mark_code(0x40);
+        const auto rom_version = mapped.get_page_version(0x40);
+        const auto code_writes = mapped.get_code_writes();
+        mapped.set_byte(0x2000, 0x02);
+        failed += mapped.get_code_writes() != code_writes + 1 || mapped.get_page_version(0x40) != rom_version;
+        failed += mapped.get_page_bank(0x40) != 2;
+
+        recording_handler registers;
+        mapped.set_handler(0xFF, &registers);
+        failed += mapped.get_byte(0xFF44) != 0x44;
+        mapped.mark_code(0xFF);
+        const auto handled_version = mapped.get_page_version(0xFF);
+        // only HRAM holds code on the I/O page, so only a write there counts
+        mapped.set_byte(0xFF90, 0x07);
+        failed += mapped.get_page_version(0xFF) == handled_version;
+        mapped.mark_code(0xFF);
+        const auto register_version = mapped.get_page_version(0xFF);
+        mapped.set_byte(0xFF01, 0x07);
+        failed += registers.last_address != 0xFF01 || registers.last_value != 0x07;
+        failed += mapped.get_page_version(0xFF) != register_version;
+        mapped.set_handler(0xFF, nullptr);
+        mapped.set_byte(0xFF44, 0x99);
+        failed += mapped.get_byte(0xFF44) != 0x99 || registers.last_address != 0xFF01;
+
+        // HRAM is plain memory beside the registers, watched for code unlike them, and the whole page's handler takes
+        // it too
+        mapped.set_io_handler(0xFF44, &registers);
+        mapped.mark_code(0xFF);
+        const auto high_version = mapped.get_page_version(0xFF);
+        const auto io_code_writes = mapped.get_code_writes();
+        mapped.set_byte(0xFF46, 0xC0);
+        mapped.set_byte(0xFF44, 0x12);
+        failed += mapped.get_page_version(0xFF) != high_version || mapped.get_code_writes() != io_code_writes;
+        mapped.set_byte(0xFF80, 0x55);
+        mapped.set_byte(0xFFFE, 0x66);
+        failed += mapped.get_byte(0xFF80) != 0x55 || mapped.get_byte(0xFFFE) != 0x66 || registers.last_address != 0xFF44;
+        failed += mapped.get_page_version(0xFF) == high_version;
+        // unless the code was decoded from the registers, which a write to any of them may then change
+        mapped.mark_register_code();
+        const auto register_code_version = mapped.get_page_version(0xFF);
+        mapped.set_byte(0xFF46, 0xC0);
+        failed += mapped.get_page_version(0xFF) == register_code_version;
+        mapped.mark_code(0xFF);
+        const auto hram_code_version = mapped.get_page_version(0xFF);
+        mapped.set_byte(0xFF46, 0xC0);
+        failed += mapped.get_page_version(0xFF) != hram_code_version;
+        mapped.set_handler(0xFF, &registers);
+        failed += mapped.get_byte(0xFF80) != 0x80;
+        mapped.set_byte(0xFF90, 0x77);
+        failed += registers.last_address != 0xFF90;
+
+        // a copy has RAM of its own, and the same banks selected
+        mapped.set_byte(0x0000, 0x0A);
+        mapped.set_byte(0xA000, 0x11);
+        memory copy = mapped;
+        copy.set_byte(0xA000, 0x22);
+        copy.set_byte(0xC000, 0x33);
+        failed += mapped.get_byte(0xA000) != 0x11 || mapped.get_byte(0xC000) == 0x33 || mapped.get_byte(0xE000) == 0x33;
+        failed += copy.get_byte(0xA000) != 0x22 || copy.get_byte(0xE000) != 0x33 || upper_bank(copy) != 2;
+
+        // and leaves the original's devices alone
+        copy.set_byte(0xFF44, 0x12);
+        copy.set_byte(0xFF91, 0x34);
+        failed += registers.last_address != 0xFF90 || copy.get_byte(0xFF44) != 0x12 || copy.get_byte(0xFF91) != 0x34;
+        mapped.set_handler(0xFF, nullptr);
+        mapped.set_io_handler(0xFF44, nullptr);
+
+        std::cout << "Test Memory Mapping: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool memory_test::test_banked_code() const
+    {
+        const auto banks = 8;
+        std::vector<byte> rom(banks * cartridge::ROM_BANK_SIZE);
+        const auto place = [&rom](int address, std::initializer_list<int> code) {
+            for (const auto value : code) {
+                rom[static_cast<std::size_t>(address++)] = static_cast<byte>(value);
+            }
+        };
+
+        place(0x0000, {0xC3, 0x50, 0x01});
+        place(0x0150, {
+            0x31, 0xFE, 0xFF,   // LD SP, 0xFFFE
+            0x06, 0x01,         // LD B, 1
+            0x78,               // loop: LD A, B
+            0xEA, 0x00, 0x20,   // LD (0x2000), A
+            0xCD, 0x00, 0x40,   // CALL 0x4000
+            0x04,               // INC B
+            0x78,               // LD A, B
+            0xFE, banks,        // CP banks
+            0x20, 0xF3,         // JR NZ, loop
+            0xC3, 0x50, 0x01,   // JP 0x0150
+        });
+        rom[0x0147] = 0x01;
+        rom[0x014D] = cartridge::compute_header_checksum(rom.data());
+        // DE += 3 * bank, from the same address in every bank
+        for (auto bank = 1; bank < banks; ++bank) {
+            place(bank * cartridge::ROM_BANK_SIZE, {
+                0x7B,               // LD A, E
+                0xC6, 3 * bank,     // ADD A, 3 * bank
+                0x5F,               // LD E, A
+                0x7A,               // LD A, D
+                0xCE, 0x00,         // ADC A, 0
+                0x57,               // LD D, A
+                0xC9,               // RET
+            });
+        }
+        const auto inserted = std::make_shared<const cartridge>(std::move(rom));
+
+        auto failed = 0;
+        for (auto mode = 0; mode < 4; ++mode) {
+            memory reference_memory;
+            reference_memory.insert(inserted);
+            memory tested_memory;
+            tested_memory.insert(inserted);
+            cpu reference{reference_memory};
+            cpu tested{tested_memory};
+            switch (mode) {
+            case 0:
+                tested.enable_block_cache(true);
+                break;
+            case 1:
+                tested.enable_block_cache(true);
+                tested.enable_fusion(true);
+                break;
+            case 2:
+                // only good for bank 1; the others have to go to the interpreter
+                tested.load_recompiled(bank_one_blocks, 1);
+                break;
+            default:
+#ifdef GAMEBOY_JIT
+                tested.enable_jit(true);
+#else
+                tested.enable_block_cache(true);
+#endif
+                break;
+            }
+
+            for (auto budget = 1; budget < 30000; budget += 41) {
+                failed += reference.run_until(budget) != tested.run_until(budget);
+                failed += !same_registers(reference.get_registers(), tested.get_registers());
+            }
+            for (auto frame = 0; frame < 5; ++frame) {
+                failed += reference.run_frame() != tested.run_frame();
+                failed += !same_registers(reference.get_registers(), tested.get_registers());
+            }
+            failed += mode == 2 && tested.get_recompiled_runs() == 0;
+            // each bank keeps its own blocks, so switching back and forth never drops any
+            failed += tested.get_block_cache().get_invalidations() != 0;
+        }
+
+        std::cout << "Test Banked Code: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef MEMORY_TEST_H
+#define MEMORY_TEST_H
+
+namespace gameboy {
+    class memory_test {
+    public:
+        // bank and RAM registers of MBC1, MBC3 and MBC5 against what each bank holds
+        bool test_controllers() const;
+        // echo RAM, handlers, copies and how code pages follow writes and bank switches
+        bool test_mapping() const;
+        // a program calling the same address in every bank, with each way of running code against the interpreter
+        bool test_banked_code() const;
+    };
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include "opcode-profile-test.h"
+#include <iostream>
+#include "cpu.h"
+#include "opcode-profile.h"
+
+namespace gameboy {
+    bool opcode_profile_test::test_runs() const
+    {
+        memory program;
+        // 0x0000: LD B, 3; DEC B; JR NZ, 0x0002; BIT 7, H; JP 0x0000
+        const byte code[] = {0x06, 0x03, 0x05, 0x20, 0xFD, 0xCB, 0x7C, 0xC3, 0x00, 0x00};
+        for (auto address = 0; address < static_cast<int>(sizeof code); ++address) {
+            program.set_byte(address, code[address]);
+        }
+
+        cpu processor{program};
+        opcode_profile profile;
+        // ten rounds of nine instructions
+        for (auto executed = 0; executed < 90; ++executed) {
+            profile.record(program, processor.get_registers().program_counter);
+            processor.fetch_and_execute();
+        }
+
+        auto failed = 0;
+        failed += profile.get_count({0x05}) != 30;
+        failed += profile.get_count({0x06, 0x05}) != 10;
+        failed += profile.get_count({0x05, 0x20}) != 30;
+        failed += profile.get_count({0x06, 0x05, 0x20}) != 10;
+        failed += profile.get_count({0x17C, 0xC3}) != 10;
+        // nothing runs on past a jump, taken or not
+        failed += profile.get_count({0x20, 0x05}) != 0;
+        failed += profile.get_count({0x20, 0x17C}) != 0;
+        failed += profile.get_count({0xC3, 0x06}) != 0;
+
+        const auto top = profile.get_top(2, 2);
+        failed += top.size() != 2 || top[0].first != opcode_profile::sequence{0x05, 0x20} || top[0].second != 30
+            || top[1].second != 10;
+
+        // 0x0000: EI; loop: INC B; JR loop, with VBlank already requested, and RETI at its vector; the JR that gives
+        // way to the interrupt is only counted when it runs
+        memory interrupted;
+        const byte looping[] = {0xFB, 0x04, 0x18, 0xFD};
+        for (auto address = 0; address < static_cast<int>(sizeof looping); ++address) {
+            interrupted.set_byte(address, looping[address]);
+        }
+        interrupted.set_byte(0x0040, 0xD9);
+        interrupted.set_byte(0xFFFF, 0x01);
+        interrupted.set_byte(0xFF0F, 0x01);
+        cpu serviced{interrupted};
+        opcode_profile counted;
+        auto calls = 0;
+        for (auto executed = 0; executed < 9; ++calls) {
+            const auto address = serviced.get_registers().program_counter;
+            const auto instruction = opcode_profile::read_instruction(interrupted, address);
+            if (serviced.fetch_and_execute()) {
+                counted.record(instruction, address);
+                ++executed;
+            }
+        }
+        // EI, INC B, RETI, then JR and INC B three times
+        failed += calls != 10 || counted.get_count({0x04}) != 4 || counted.get_count({0x18}) != 3;
+        failed += counted.get_count({0xD9}) != 1 || counted.get_count({0xD9, 0x18}) != 0;
+
+        std::cout << "Test Opcode Profile: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+}
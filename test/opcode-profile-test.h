@@ -0,0 +1,12 @@
+#ifndef OPCODE_PROFILE_TEST_H
+#define OPCODE_PROFILE_TEST_H
+
+namespace gameboy {
+    class opcode_profile_test {
+    public:
+        // runs are counted up to the instruction that ends their block, and CB opcodes apart from the rest
+        bool test_runs() const;
+    };
+}
+
+#endif
@@ -0,0 +1,628 @@
+#include "ppu-test.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "cpu.h"
+#include "framebuffer.h"
+#include "line-compositor.h"
+#include "ppu.h"
+#include "test-helpers.h"
+#include "tile-decoder.h"
+
+namespace gameboy {
+    bool ppu_test::test_decoder() const
+    {
+        auto failed = 0;
+        // the example from the Pan Docs
+        const tile_decoder scalar{tile_decoder::kernel::scalar};
+        const byte example[] = {0x3C, 0x7E};
+        std::array<byte, 8> decoded;
+        scalar.decode(example, decoded.data(), 1);
+        failed += decoded != std::array<byte, 8>{{0, 2, 3, 3, 3, 3, 2, 0}};
+
+        std::default_random_engine generator{42};
+        std::uniform_int_distribution<int> distribution{0, 255};
+        std::vector<byte> rows(2 * 21);
+        for (auto& value : rows) {
+            value = static_cast<byte>(distribution(generator));
+        }
+
+        for (const auto type : {tile_decoder::kernel::sse2, tile_decoder::kernel::bmi2, tile_decoder::kernel::avx2}) {
+            if (!tile_decoder::is_supported(type)) {
+                std::cout << "Test PPU Decoder: " << tile_decoder::get_name(type) << " not supported here" << std::endl;
+                continue;
+            }
+
+            const tile_decoder tested{type};
+            failed += tested.get_kernel() != type;
+            for (std::size_t count = 0; count <= rows.size() / 2; ++count) {
+                // one more byte each to catch a kernel writing past the end
+                std::vector<byte> expected(8 * count + 1, 0xAA);
+                std::vector<byte> actual(8 * count + 1, 0xAA);
+                scalar.decode(rows.data(), expected.data(), count);
+                tested.decode(rows.data(), actual.data(), count);
+                failed += expected != actual;
+            }
+        }
+
+        std::cout << "Test PPU Decoder: failed = " << failed << " (best is "
+            << tile_decoder::get_name(tile_decoder::best()) << ")" << std::endl;
+
+        return failed == 0;
+    }
+
+    bool ppu_test::test_compositor() const
+    {
+        auto failed = 0;
+        const line_compositor scalar{tile_decoder::kernel::scalar};
+        // entries 0 and 2 start on line 0, entry 1 on line 8, entry 3 above the screen and entry 39 below it
+        line_compositor::positions ys{};
+        ys[0] = 16;
+        ys[1] = 24;
+        ys[2] = 16;
+        ys[3] = 8;
+        ys[39] = 160;
+        failed += scalar.scan(ys, 0, 8) != 0x5;
+        failed += scalar.scan(ys, 7, 8) != 0x5;
+        failed += scalar.scan(ys, 8, 8) != 0x2;
+        failed += scalar.scan(ys, 7, 16) != 0xD;
+        failed += scalar.scan(ys, 8, 16) != 0x7;
+        failed += scalar.scan(ys, 144, 8) != 1ull << 39;
+
+        // background 1 and 2 under sprite colour 3 from OBP1, in front of the background and then behind it
+        line_compositor::shades table{{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}};
+        const byte background[] = {1, 0, 2, 2};
+        const byte sprites[] = {0, 3, 3, 3};
+        const byte attributes[] = {0, 0x90, 0x10, 0x90};
+        byte output[4];
+        scalar.composite(background, sprites, attributes, table, output, 4);
+        failed += output[0] != 1 || output[1] != 11 || output[2] != 11 || output[3] != 2;
+
+        std::default_random_engine generator{42};
+        std::uniform_int_distribution<int> distribution{0, 255};
+        const auto random_bytes = [&](std::size_t count, int modulo) {
+            std::vector<byte> values(count);
+            for (auto& value : values) {
+                value = static_cast<byte>(distribution(generator) % modulo);
+            }
+            return values;
+        };
+
+        for (const auto type : {tile_decoder::kernel::sse2, tile_decoder::kernel::bmi2, tile_decoder::kernel::avx2}) {
+            if (!tile_decoder::is_supported(type)) {
+                continue;
+            }
+
+            const line_compositor tested{type};
+            failed += tested.get_kernel() != type;
+            for (auto round = 0; round < 20; ++round) {
+                // mostly where sprites are on screen, with the odd one anywhere at all
+                const auto random = random_bytes(line_compositor::OAM_ENTRIES, 256);
+                for (std::size_t index = 0; index < random.size(); ++index) {
+                    ys[index] = static_cast<byte>(random[index] < 224 ? random[index] % 176 : random[index]);
+                }
+                for (auto line = 0; line < ppu::LINES; ++line) {
+                    failed += tested.scan(ys, line, 8) != scalar.scan(ys, line, 8);
+                    failed += tested.scan(ys, line, 16) != scalar.scan(ys, line, 16);
+                }
+
+                const auto shades = random_bytes(table.size(), 4);
+                std::copy(shades.begin(), shades.end(), table.begin());
+                const auto colours = random_bytes(ppu::WIDTH, 4);
+                // half the pixels without a sprite
+                const auto pixels = random_bytes(ppu::WIDTH, 8);
+                std::vector<byte> indices(ppu::WIDTH);
+                std::transform(pixels.begin(), pixels.end(), indices.begin(), [](byte pixel) {
+                    return static_cast<byte>(pixel < 4 ? 0 : pixel - 4);
+                });
+                const auto flags = random_bytes(ppu::WIDTH, 256);
+                for (std::size_t count = 0; count <= ppu::WIDTH; ++count) {
+                    // one more byte each to catch a kernel writing past the end
+                    std::vector<byte> expected(count + 1, 0xAA);
+                    std::vector<byte> actual(count + 1, 0xAA);
+                    scalar.composite(colours.data(), indices.data(), flags.data(), table, expected.data(), count);
+                    tested.composite(colours.data(), indices.data(), flags.data(), table, actual.data(), count);
+                    failed += expected != actual;
+                }
+            }
+        }
+
+        std::cout << "Test PPU Compositor: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool ppu_test::test_timing() const
+    {
+        auto failed = 0;
+        memory mem;
+        ppu video{mem};
+        auto& events = mem.get_scheduler();
+        const auto mode_at = [&mem, &events](unsigned long long time) {
+            events.set_now(time);
+            events.run_due();
+            return mem.get_byte(ppu::LCD_STATUS) & 3;
+        };
+
+        failed += mem.get_byte(ppu::LINE) != 0 || mode_at(0) != 2;
+        failed += mode_at(79) != 2 || mode_at(80) != 3;
+        failed += mode_at(80 + 171) != 3 || mode_at(80 + 172) != 0;
+        failed += mode_at(455) != 0 || mem.get_byte(ppu::LINE) != 0;
+        failed += mode_at(456) != 2 || mem.get_byte(ppu::LINE) != 1;
+
+        // VBlank, and back to the top
+        failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::VBLANK_INTERRUPT) != 0;
+        failed += mode_at(144 * 456 - 1) != 0 || video.get_frames() != 0;
+        failed += mode_at(144 * 456) != 1 || mem.get_byte(ppu::LINE) != 144 || video.get_frames() != 1;
+        failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::VBLANK_INTERRUPT) == 0;
+        failed += mode_at(153 * 456) != 1 || mem.get_byte(ppu::LINE) != 153;
+        const auto frame = static_cast<unsigned long long>(ppu::FRAME_CYCLES);
+        failed += mode_at(frame) != 2 || mem.get_byte(ppu::LINE) != 0;
+
+        // LY = LYC raises STAT once when it starts to hold
+        mem.set_byte(memory::INTERRUPT_FLAG, 0);
+        mem.set_byte(ppu::LINE_COMPARE, 3);
+        mem.set_byte(ppu::LCD_STATUS, 0x40);
+        mode_at(frame + 3 * 456 - 1);
+        failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::STAT_INTERRUPT) != 0;
+        failed += (mem.get_byte(ppu::LCD_STATUS) & 0x04) != 0;
+        mode_at(frame + 3 * 456);
+        failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::STAT_INTERRUPT) == 0;
+        failed += mem.get_byte(ppu::LCD_STATUS) != (0x80 | 0x40 | 0x04 | 2);
+        mem.set_byte(memory::INTERRUPT_FLAG, 0);
+        mode_at(frame + 3 * 456 + 300);
+        failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::STAT_INTERRUPT) != 0;
+
+        // a fine scroll of 2 and a sprite 2 pixels into a background tile make mode 3 2 + 6 + 3 cycles longer
+        mem.set_byte(0xFE00, 16 + 1);
+        mem.set_byte(0xFE01, 8);
+        mem.set_byte(ppu::SCROLL_X, 2);
+        mem.set_byte(ppu::LCD_CONTROL, 0x93);
+        const auto line = frame + 5 * 456;
+        failed += mode_at(line + 80 + 172 + 2 + 9 - 1) != 3 || mode_at(line + 80 + 172 + 2 + 9) != 0;
+        // the sprite is on lines 1 to 8 only
+        failed += mode_at(frame + 9 * 456 + 80 + 172 + 2) != 0;
+
+        // switched off, LY stays at 0 in HBlank, and on again it starts over from line 0
+        mem.set_byte(ppu::LCD_CONTROL, 0x13);
+        failed += mem.get_byte(ppu::LINE) != 0 || (mem.get_byte(ppu::LCD_STATUS) & 3) != 0;
+        failed += events.get_timestamp(scheduler::event::video_line) != scheduler::NEVER;
+        events.set_now(frame + 20 * 456 + 10);
+        mem.set_byte(ppu::LCD_CONTROL, 0x93);
+        failed += mode_at(frame + 20 * 456 + 10 + 79) != 2 || mode_at(frame + 20 * 456 + 10 + 80) != 3;
+
+        std::cout << "Test PPU Timing: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool ppu_test::test_render() const
+    {
+        auto failed = 0;
+        // tile 1 is the Pan Docs example, 2 has its left half in colour 1 and 3 is all colour 3; BGP and OBP0 are
+        // the identity and OBP1 maps everything to 1
+        const auto draw = [](std::initializer_list<std::pair<int, int>> writes) {
+            memory mem;
+            for (auto row = 0; row < 8; ++row) {
+                mem.set_byte(0x8010 + row * 2, 0x3C);
+                mem.set_byte(0x8011 + row * 2, 0x7E);
+                mem.set_byte(0x8020 + row * 2, 0xF0);
+                mem.set_byte(0x8030 + row * 2, 0xFF);
+                mem.set_byte(0x8031 + row * 2, 0xFF);
+            }
+            mem.set_byte(0x9800, 1);
+            ppu video{mem};
+            mem.set_byte(ppu::BACKGROUND_PALETTE, 0xE4);
+            mem.set_byte(ppu::OBJECT_PALETTE_0, 0xE4);
+            mem.set_byte(ppu::OBJECT_PALETTE_1, 0x55);
+            for (const auto& write : writes) {
+                mem.set_byte(write.first, static_cast<byte>(write.second));
+            }
+
+            // to the end of line 0
+            mem.get_scheduler().set_now(455);
+            mem.get_scheduler().run_due();
+            const auto& frame = video.get_frame();
+            return std::vector<byte>(frame.begin(), frame.begin() + ppu::WIDTH);
+        };
+        const auto expect = [](std::initializer_list<std::pair<int, std::vector<int>>> runs) {
+            std::vector<byte> line(ppu::WIDTH);
+            for (const auto& run : runs) {
+                auto x = run.first;
+                for (const auto shade : run.second) {
+                    line[static_cast<std::size_t>(x++)] = static_cast<byte>(shade);
+                }
+            }
+            return line;
+        };
+
+        failed += draw({}) != expect({{0, {0, 2, 3, 3, 3, 3, 2, 0}}});
+        failed += draw({{ppu::SCROLL_X, 3}}) != expect({{0, {3, 3, 3, 2, 0}}});
+        // scrolled down a tile there is only tile 0, and with signed tile numbers tile 1 is the one at 0x9010
+        failed += draw({{ppu::SCROLL_Y, 8}}) != expect({});
+        failed += draw({{0x9010, 0xFF}, {ppu::LCD_CONTROL, 0x81}}) != expect({{0, {1, 1, 1, 1, 1, 1, 1, 1}}});
+        // the background switched off is white, and BGP applies to it
+        failed += draw({{ppu::LCD_CONTROL, 0x90}}) != expect({});
+        failed += draw({{ppu::BACKGROUND_PALETTE, 0x1B}}) != expect({{0, {3, 1, 0, 0, 0, 0, 1, 3}}, {8, std::vector<int>(152, 3)}});
+
+        // the window from x = 16 on shows its own first tile there, over the background
+        failed += draw({{ppu::LCD_CONTROL, 0xB1}, {ppu::WINDOW_X, 7 + 16}})
+            != expect({{0, {0, 2, 3, 3, 3, 3, 2, 0}}, {16, {0, 2, 3, 3, 3, 3, 2, 0}}});
+        // and a window 3 pixels off the left edge starts with the rest of that tile
+        failed += draw({{ppu::LCD_CONTROL, 0xB1}, {ppu::WINDOW_X, 4}, {ppu::SCROLL_X, 8}}) != expect({{0, {3, 3, 3, 2, 0}}});
+        // below WY there is no window
+        failed += draw({{ppu::LCD_CONTROL, 0xB1}, {ppu::WINDOW_X, 7 + 16}, {ppu::WINDOW_Y, 1}})
+            != expect({{0, {0, 2, 3, 3, 3, 3, 2, 0}}});
+
+        // tile 2 as a sprite at x = 40, and flipped
+        failed += draw({{ppu::LCD_CONTROL, 0x93}, {0xFE00, 16}, {0xFE01, 48}, {0xFE02, 2}})
+            != expect({{0, {0, 2, 3, 3, 3, 3, 2, 0}}, {40, {1, 1, 1, 1}}});
+        failed += draw({{ppu::LCD_CONTROL, 0x93}, {0xFE00, 16}, {0xFE01, 48}, {0xFE02, 2}, {0xFE03, 0x20}})
+            != expect({{0, {0, 2, 3, 3, 3, 3, 2, 0}}, {44, {1, 1, 1, 1}}});
+        // over the background tile at x = 0, the sprite behind it only shows where the background has colour 0
+        failed += draw({{ppu::LCD_CONTROL, 0x93}, {0xFE00, 16}, {0xFE01, 8}, {0xFE02, 3}, {0xFE03, 0x80}})
+            != expect({{0, {3, 2, 3, 3, 3, 3, 2, 3}}});
+        // sprites switched off
+        failed += draw({{0xFE00, 16}, {0xFE01, 48}, {0xFE02, 2}}) != expect({{0, {0, 2, 3, 3, 3, 3, 2, 0}}});
+        // the sprite further left wins where they overlap, even when it comes later in OAM
+        failed += draw({{ppu::LCD_CONTROL, 0x93}, {0xFE00, 16}, {0xFE01, 52}, {0xFE02, 3},
+            {0xFE04, 16}, {0xFE05, 48}, {0xFE06, 3}, {0xFE07, 0x10}})
+            != expect({{0, {0, 2, 3, 3, 3, 3, 2, 0}}, {40, {1, 1, 1, 1, 1, 1, 1, 1}}, {48, {3, 3, 3, 3}}});
+        // only ten sprites on a line, the first ones in OAM
+        failed += draw({{ppu::LCD_CONTROL, 0x93}, {0xFE00, 16}, {0xFE01, 20}, {0xFE02, 3}, {0xFE04, 16}, {0xFE05, 28},
+            {0xFE06, 3}, {0xFE08, 16}, {0xFE09, 36}, {0xFE0A, 3}, {0xFE0C, 16}, {0xFE0D, 44}, {0xFE0E, 3},
+            {0xFE10, 16}, {0xFE11, 52}, {0xFE12, 3}, {0xFE14, 16}, {0xFE15, 60}, {0xFE16, 3}, {0xFE18, 16},
+            {0xFE19, 68}, {0xFE1A, 3}, {0xFE1C, 16}, {0xFE1D, 76}, {0xFE1E, 3}, {0xFE20, 16}, {0xFE21, 84},
+            {0xFE22, 3}, {0xFE24, 16}, {0xFE25, 92}, {0xFE26, 3}, {0xFE28, 16}, {0xFE29, 100}, {0xFE2A, 3}})
+            != expect({{0, {0, 2, 3, 3, 3, 3, 2, 0}}, {12, std::vector<int>(80, 3)}});
+
+        std::cout << "Test PPU Render: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool ppu_test::test_tile_cache() const
+    {
+        auto failed = 0;
+        {
+            memory mem;
+            mem.set_byte(0x8010, 0xFF);
+            failed += mem.take_write(0x8010);
+            mem.track_writes(0x80);
+            // everything starts out written, once
+            failed += !mem.take_write(0x8000);
+            failed += !mem.take_write(0x80F0);
+            failed += mem.take_write(0x8000);
+            failed += mem.take_write(0x8100);
+            for (auto address = 0x8000; address < 0x8100; address += memory::WRITE_BLOCK) {
+                mem.take_write(address);
+            }
+
+            mem.set_byte(0x801F, 0x12);
+            failed += !mem.take_write(0x8010);
+            failed += mem.take_write(0x8000);
+            failed += mem.take_write(0x8020);
+            failed += mem.take_write(0x8010);
+        }
+
+        memory mem;
+        for (auto row = 0; row < 8; ++row) {
+            mem.set_byte(0x8010 + row * 2, 0xF0);
+        }
+        mem.set_byte(0x9800, 1);
+        ppu video{mem};
+        mem.set_byte(ppu::BACKGROUND_PALETTE, 0xE4);
+        mem.set_byte(ppu::OBJECT_PALETTE_0, 0xE4);
+        mem.set_byte(ppu::LCD_CONTROL, 0x93);
+        // tile 1 as a flipped sprite at x = 40
+        mem.set_byte(0xFE00, 16);
+        mem.set_byte(0xFE01, 48);
+        mem.set_byte(0xFE02, 1);
+        mem.set_byte(0xFE03, 0x20);
+        // mode 3 of line 0 picks the sprite, which covers the lines drawn again below
+        mem.get_scheduler().set_now(455);
+        mem.get_scheduler().run_due();
+        const auto draw = [&](int line) {
+            video.render_line(line);
+            const auto& frame = video.get_frame();
+            const auto start = frame.begin() + line * ppu::WIDTH;
+            return std::vector<byte>(start, start + 48);
+        };
+        const auto expect = [](std::vector<int> background, std::vector<int> sprite) {
+            std::vector<byte> line(48);
+            std::copy(background.begin(), background.end(), line.begin());
+            std::copy(sprite.begin(), sprite.end(), line.begin() + 40);
+            return line;
+        };
+
+        failed += draw(0) != expect({1, 1, 1, 1, 0, 0, 0, 0}, {0, 0, 0, 0, 1, 1, 1, 1});
+        // only row 0 changes, in the background and the sprite both
+        mem.set_byte(0x8011, 0x81);
+        failed += draw(0) != expect({3, 1, 1, 1, 0, 0, 0, 2}, {2, 0, 0, 0, 1, 1, 1, 3});
+        failed += draw(1) != expect({1, 1, 1, 1, 0, 0, 0, 0}, {0, 0, 0, 0, 1, 1, 1, 1});
+        // and the last byte of the tile reaches its last row
+        mem.set_byte(0x801F, 0xFF);
+        failed += draw(7) != expect({3, 3, 3, 3, 2, 2, 2, 2}, {2, 2, 2, 2, 3, 3, 3, 3});
+        failed += draw(0) != expect({3, 1, 1, 1, 0, 0, 0, 2}, {2, 0, 0, 0, 1, 1, 1, 3});
+
+        std::cout << "Test PPU Tile Cache: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool ppu_test::test_render_skip() const
+    {
+        auto failed = 0;
+        // the window, sprites and every STAT source, whose mode 3 lengths differ from line to line
+        const auto set_up = [](memory& mem) {
+            for (auto address = 0x8000; address < 0x9800; ++address) {
+                mem.set_byte(address, static_cast<byte>(address * 7));
+            }
+            for (auto index = 0; index < 40; ++index) {
+                mem.set_byte(0xFE00 + index * 4, static_cast<byte>(16 + index * 3));
+                mem.set_byte(0xFE01 + index * 4, static_cast<byte>(index * 5));
+            }
+            mem.set_byte(ppu::LCD_CONTROL, 0xF3);
+            mem.set_byte(ppu::LCD_STATUS, 0x78);
+            mem.set_byte(ppu::LINE_COMPARE, 100);
+            mem.set_byte(ppu::SCROLL_X, 5);
+            mem.set_byte(ppu::WINDOW_Y, 40);
+            mem.set_byte(ppu::WINDOW_X, 60);
+        };
+        memory drawn_memory, skipped_memory;
+        ppu drawn{drawn_memory}, skipped{skipped_memory};
+        set_up(drawn_memory);
+        set_up(skipped_memory);
+        // the frame under way is still drawn
+        skipped.set_rendering(false);
+        failed += !skipped.is_rendering();
+
+        std::vector<ppu::frame> drawn_frames, skipped_frames;
+        for (auto cycle = 1ull; cycle <= 3ull * ppu::FRAME_CYCLES; ++cycle) {
+            for (auto mem : {&drawn_memory, &skipped_memory}) {
+                mem->get_scheduler().set_now(cycle);
+                mem->get_scheduler().run_due();
+            }
+            for (const auto address : {ppu::LINE, ppu::LCD_STATUS, static_cast<int>(memory::INTERRUPT_FLAG)}) {
+                failed += drawn_memory.get_byte(address) != skipped_memory.get_byte(address);
+            }
+            drawn_memory.set_byte(memory::INTERRUPT_FLAG, 0);
+            skipped_memory.set_byte(memory::INTERRUPT_FLAG, 0);
+
+            if (cycle % ppu::FRAME_CYCLES == ppu::HEIGHT * ppu::LINE_CYCLES) {
+                drawn_frames.push_back(drawn.get_frame());
+                skipped_frames.push_back(skipped.get_frame());
+                // a different palette for every frame, and drawing again from the third one
+                drawn_memory.set_byte(ppu::BACKGROUND_PALETTE, static_cast<byte>(0x1B + drawn_frames.size()));
+                skipped_memory.set_byte(ppu::BACKGROUND_PALETTE, static_cast<byte>(0x1B + skipped_frames.size()));
+                skipped.set_rendering(drawn_frames.size() == 2);
+            }
+        }
+
+        failed += drawn_frames.size() != 3;
+        failed += skipped_frames[0] != drawn_frames[0];
+        failed += skipped_frames[1] != drawn_frames[0];
+        failed += skipped_frames[1] == drawn_frames[1];
+        failed += skipped_frames[2] != drawn_frames[2];
+        // the last cycle starts a fourth frame, not drawn again
+        failed += skipped.is_rendering();
+
+        std::cout << "Test PPU Render Skip: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool ppu_test::test_threading() const
+    {
+        auto failed = 0;
+        memory single_memory, threaded_memory;
+        ppu single{single_memory}, threaded{threaded_memory};
+        threaded.enable_threading(true);
+        for (auto mem : {&single_memory, &threaded_memory}) {
+            mem->set_byte(ppu::LCD_CONTROL, 0xF7);
+            mem->set_byte(ppu::WINDOW_Y, 50);
+            mem->set_byte(ppu::WINDOW_X, 90);
+        }
+
+        std::default_random_engine generator{1};
+        std::uniform_int_distribution<int> distribution{0, 255};
+        const std::vector<int> registers{ppu::SCROLL_X, ppu::SCROLL_Y, ppu::BACKGROUND_PALETTE, ppu::OBJECT_PALETTE_0,
+            ppu::WINDOW_X};
+        auto frames = 0;
+        for (auto cycle = 1ull; cycle <= 4ull * ppu::FRAME_CYCLES; ++cycle) {
+            if (cycle % 16 == 0) {
+                // somewhere in VRAM, OAM or the registers, the same for both
+                const auto choice = distribution(generator);
+                const auto address = choice < 192 ? 0x8000 + distribution(generator) * 32 + distribution(generator) % 32
+                    : choice < 240 ? 0xFE00 + distribution(generator) % 160
+                    : registers[static_cast<std::size_t>(distribution(generator)) % registers.size()];
+                const auto value = static_cast<byte>(distribution(generator));
+                single_memory.set_byte(address, value);
+                threaded_memory.set_byte(address, value);
+            }
+            for (auto mem : {&single_memory, &threaded_memory}) {
+                mem->get_scheduler().set_now(cycle);
+                mem->get_scheduler().run_due();
+            }
+
+            if (cycle % ppu::FRAME_CYCLES == ppu::HEIGHT * ppu::LINE_CYCLES) {
+                failed += threaded.get_frame() != single.get_frame();
+                // drawn on this thread for one frame in between
+                threaded.enable_threading(++frames != 2);
+            }
+        }
+        failed += frames != 4;
+
+        std::cout << "Test PPU Threading: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool ppu_test::test_framebuffer() const
+    {
+        auto failed = 0;
+        const std::array<std::uint32_t, 4> colours{{0x102030, 0x405060, 0x708090, 0xA0B0C0}};
+        const auto rgba = [](std::uint32_t colour) {
+            const byte bytes[] = {static_cast<byte>(colour >> 16), static_cast<byte>(colour >> 8), static_cast<byte>(colour),
+                0xFF};
+            std::uint32_t pixel;
+            std::memcpy(&pixel, bytes, sizeof(pixel));
+            return pixel;
+        };
+        const auto rgb565 = [](std::uint32_t colour) {
+            return static_cast<std::uint16_t>((colour >> 19 & 0x1F) << 11 | (colour >> 10 & 0x3F) << 5 | (colour >> 3 & 0x1F));
+        };
+        const auto all = [](const auto& pixels, std::uint32_t pixel) {
+            return std::all_of(pixels.begin(), pixels.end(), [pixel](std::uint32_t value) { return value == pixel; });
+        };
+
+        for (const auto threading : {false, true}) {
+            // VRAM is all 0, so BGP picks the one shade of every frame
+            memory mem;
+            ppu video{mem};
+            video.enable_threading(threading);
+            std::vector<std::uint32_t> first(ppu::WIDTH * ppu::HEIGHT), second(ppu::WIDTH * ppu::HEIGHT);
+            framebuffer output{framebuffer::format::rgba8888, first.data(), second.data(), colours};
+            video.set_framebuffer(&output);
+            failed += output.get_frames() != 0 || output.get_front() != second.data();
+
+            mem.set_byte(ppu::BACKGROUND_PALETTE, 0xE4);
+            mem.get_scheduler().set_now(ppu::HEIGHT * ppu::LINE_CYCLES);
+            mem.get_scheduler().run_due();
+            video.get_frame();
+            failed += output.get_frames() != 1 || output.get_front() != first.data() || !all(first, rgba(colours[0]));
+
+            // the next frame goes to the other buffer and leaves this one alone
+            mem.set_byte(ppu::BACKGROUND_PALETTE, 0x03);
+            mem.get_scheduler().set_now(ppu::FRAME_CYCLES + ppu::HEIGHT * ppu::LINE_CYCLES);
+            mem.get_scheduler().run_due();
+            video.get_frame();
+            failed += output.get_frames() != 2 || output.get_front() != second.data();
+            failed += !all(first, rgba(colours[0])) || !all(second, rgba(colours[3]));
+
+            // without it, the buffers are left as they are
+            video.set_framebuffer(nullptr);
+            mem.get_scheduler().set_now(2 * ppu::FRAME_CYCLES + ppu::HEIGHT * ppu::LINE_CYCLES);
+            mem.get_scheduler().run_due();
+            video.get_frame();
+            failed += output.get_frames() != 2 || !all(first, rgba(colours[0]));
+        }
+
+        {
+            memory mem;
+            ppu video{mem};
+            std::vector<std::uint16_t> first(ppu::WIDTH * ppu::HEIGHT), second(ppu::WIDTH * ppu::HEIGHT);
+            framebuffer output{framebuffer::format::rgb565, first.data(), second.data(), colours};
+            video.set_framebuffer(&output);
+            mem.set_byte(ppu::BACKGROUND_PALETTE, 0x02);
+            mem.get_scheduler().set_now(ppu::HEIGHT * ppu::LINE_CYCLES);
+            mem.get_scheduler().run_due();
+            failed += output.get_frames() != 1 || !all(first, rgb565(colours[2]));
+            failed += framebuffer::get_pixel_size(output.get_format()) != sizeof(std::uint16_t);
+        }
+
+        {
+            // a palette written mid-frame, and then new colours, each showing from the next line drawn on
+            memory mem;
+            ppu video{mem};
+            std::vector<std::uint32_t> first(ppu::WIDTH * ppu::HEIGHT), second(ppu::WIDTH * ppu::HEIGHT);
+            framebuffer output{framebuffer::format::rgba8888, first.data(), second.data(), colours};
+            video.set_framebuffer(&output);
+            const std::array<std::uint32_t, 4> recoloured{{0xFF0000, 0x00FF00, 0x0000FF, 0xFFFF00}};
+            mem.set_byte(ppu::BACKGROUND_PALETTE, 0x00);
+            mem.get_scheduler().set_now(48 * ppu::LINE_CYCLES);
+            mem.get_scheduler().run_due();
+            mem.set_byte(ppu::BACKGROUND_PALETTE, 0x03);
+            mem.get_scheduler().set_now(96 * ppu::LINE_CYCLES);
+            mem.get_scheduler().run_due();
+            output.set_colours(recoloured);
+            mem.get_scheduler().set_now(ppu::HEIGHT * ppu::LINE_CYCLES);
+            mem.get_scheduler().run_due();
+            for (std::size_t line = 0; line < ppu::HEIGHT; ++line) {
+                const auto expected = line < 48 ? rgba(colours[0]) : line < 96 ? rgba(colours[3]) : rgba(recoloured[3]);
+                failed += first[line * ppu::WIDTH] != expected || first[line * ppu::WIDTH + ppu::WIDTH - 1] != expected;
+            }
+        }
+
+        // a frame in one shade after another, which a reader seeing the same frame count before and after reading
+        // never sees mixed
+        memory mem;
+        ppu video{mem};
+        video.enable_threading(true);
+        std::vector<std::uint32_t> first(ppu::WIDTH * ppu::HEIGHT), second(ppu::WIDTH * ppu::HEIGHT);
+        framebuffer output{framebuffer::format::rgba8888, first.data(), second.data(), colours};
+        video.set_framebuffer(&output);
+        std::atomic<bool> running{true};
+        auto torn = 0, whole = 0;
+        std::thread reader{[&]() {
+            while (running.load()) {
+                const auto frames = output.get_frames();
+                const auto front = static_cast<const std::uint32_t*>(output.get_front());
+                const auto pixel = front[0];
+                const auto mixed = std::any_of(front, front + ppu::WIDTH * ppu::HEIGHT,
+                    [pixel](std::uint32_t value) { return value != pixel; });
+                if (frames > 0 && output.get_frames() == frames) {
+                    torn += mixed;
+                    ++whole;
+                }
+            }
+        }};
+        for (auto frame = 0; frame < 60; ++frame) {
+            mem.set_byte(ppu::BACKGROUND_PALETTE, static_cast<byte>(frame % 4));
+            mem.get_scheduler().set_now(static_cast<unsigned long long>(frame + 1) * ppu::FRAME_CYCLES);
+            mem.get_scheduler().run_due();
+            video.get_frame();
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        running = false;
+        reader.join();
+        failed += torn != 0 || whole == 0;
+
+        std::cout << "Test PPU Framebuffer: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool ppu_test::test_program() const
+    {
+        auto failed = 0;
+        // LDH A, (0x44); CP 0x90; JR NZ, -6; INC B; LDH A, (0x44); CP 0x90; JR Z, -6; JR -15: counts VBlanks in B
+        memory program;
+        const std::vector<byte> code{0xC3, 0x00, 0x01};
+        const std::vector<byte> loop{0xF0, 0x44, 0xFE, 0x90, 0x20, 0xFA, 0x04, 0xF0, 0x44, 0xFE, 0x90, 0x28, 0xFA, 0x18, 0xF1};
+        for (std::size_t offset = 0; offset < code.size(); ++offset) {
+            program.set_byte(static_cast<int>(offset), code[offset]);
+        }
+        for (std::size_t offset = 0; offset < loop.size(); ++offset) {
+            program.set_byte(0x0100 + static_cast<int>(offset), loop[offset]);
+        }
+
+        memory reference_memory = program;
+        memory tested_memory = program;
+        ppu reference_video{reference_memory};
+        ppu tested_video{tested_memory};
+        cpu reference{reference_memory};
+        cpu tested{tested_memory};
+        tested.enable_block_cache(true);
+        const auto end = 3 * ppu::FRAME_CYCLES;
+        for (auto budget = 333; budget < end; budget += 333) {
+            failed += reference.run_until(budget) != tested.run_until(budget);
+            failed += !same_registers(reference.get_registers(), tested.get_registers());
+        }
+        failed += reference.get_registers().general_bc.bytes.high != 3 || reference_video.get_frames() != 3;
+        // nearly all of it spent waiting
+        failed += tested.get_skipped_cycles() < static_cast<unsigned long long>(end) / 2;
+
+        std::cout << "Test PPU Program: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef PPU_TEST_H
+#define PPU_TEST_H
+
+#include "memory.h"
+#include "registers.h"
+
+namespace gameboy {
+    class ppu_test {
+    public:
+        // every kernel the processor supports against the scalar one, for every number of rows up to a line's worth
+        bool test_decoder() const;
+        // OAM scans and line compositing of every kernel the processor supports against the scalar ones, pixel for
+        // pixel, with a few cases of the scalar ones checked by hand
+        bool test_compositor() const;
+        // LY, the modes and their interrupts at the cycle they change, with and without sprites
+        bool test_timing() const;
+        // background, window and sprites of a single line
+        bool test_render() const;
+        // VRAM writes reaching the decoded tiles, and only the tiles written to marked
+        bool test_tile_cache() const;
+        // frames not drawn against ones that are: the same LY, STAT and interrupts at every cycle, and no pixels
+        bool test_render_skip() const;
+        // lines drawn on another thread against drawn straight away, with VRAM, OAM and registers written mid-frame
+        bool test_threading() const;
+        // host pixels in both formats going to the back buffer and swapped in at the end of each frame, palettes and
+        // colours changed mid-frame, and a thread reading the front buffer while frames are drawn
+        bool test_framebuffer() const;
+        // a program waiting for VBlank by polling LY, through the block cache against the interpreter
+        bool test_program() const;
+    };
+}
+
+#endif
@@ -0,0 +1,85 @@
+#include "recompiler-test.h"
+#include <iostream>
+#include "recompiler.h"
+#include "test-helpers.h"
+#include "test-rom.h"
+
+namespace gameboy {
+    // generated from the test ROM by gameboy-recompile at build time
+    extern const recompiled_block test_rom[];
+    extern const std::size_t test_rom_count;
+    extern const unsigned int test_rom_checksum;
+
+    bool recompiler_test::test_walk() const
+    {
+        auto failed = 0;
+        memory rom;
+        load_test_rom(rom);
+
+        recompiler translator{rom};
+        translator.walk();
+        const auto& blocks = translator.get_blocks();
+        const auto found = [&blocks](unsigned short address) {
+            return blocks.find(address) != blocks.end();
+        };
+
+        // entry, copy loop and its exit, the call target and the return address
+        for (const auto address : {0x0100, 0x0150, 0x015B, 0x0161, 0x0200, 0x0168, 0x016C}) {
+            failed += !found(static_cast<unsigned short>(address));
+        }
+        // JP (HL) target, what only it leads to, and the routine in RAM
+        for (const auto address : {0x0240, 0x0280, 0xC000}) {
+            failed += found(static_cast<unsigned short>(address));
+        }
+        // the loop is cut after the conditional JR
+        failed += blocks.at(0x015B).instructions.size() != 5 || blocks.at(0x015B).cycles != 28;
+
+        // given as an extra entry point, the indirect target leads on to the rest
+        recompiler extended{rom};
+        extended.add_entry(0x0240);
+        extended.walk();
+        failed += extended.get_blocks().count(0x0280) != 1;
+        failed += extended.get_blocks().size() <= blocks.size();
+
+        std::cout << "Test Recompiler Walk: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool recompiler_test::test_lockstep() const
+    {
+        auto failed = 0;
+        memory reference_memory;
+        load_test_rom(reference_memory);
+        failed += recompiler::checksum(reference_memory) != test_rom_checksum;
+
+        for (const auto cached : {false, true}) {
+            memory recompiled_memory;
+            load_test_rom(recompiled_memory);
+            memory interpreted_memory = recompiled_memory;
+            cpu interpreted{interpreted_memory};
+            cpu recompiled{recompiled_memory};
+            recompiled.load_recompiled(test_rom, test_rom_count);
+            recompiled.enable_block_cache(cached);
+
+            // budgets that fall everywhere inside the blocks, then whole frames
+            for (auto budget = 1; budget < 20000; budget += 37) {
+                failed += interpreted.run_until(budget) != recompiled.run_until(budget);
+                failed += !same_registers(interpreted.get_registers(), recompiled.get_registers());
+            }
+            for (auto frame = 0; frame < 10; ++frame) {
+                failed += interpreted.run_frame() != recompiled.run_frame();
+                failed += !same_registers(interpreted.get_registers(), recompiled.get_registers());
+            }
+            for (auto address = 0; address < 0x10000; ++address) {
+                failed += interpreted_memory.get_byte(address) != recompiled_memory.get_byte(address);
+            }
+
+            failed += recompiled.get_recompiled_runs() == 0;
+        }
+
+        std::cout << "Test Recompiler Lockstep: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef RECOMPILER_TEST_H
+#define RECOMPILER_TEST_H
+
+#include "cpu.h"
+#include "memory.h"
+
+namespace gameboy {
+    class recompiler_test {
+    public:
+        // blocks are found along calls, jumps and fall-throughs, but not behind JP (HL) or outside ROM
+        bool test_walk() const;
+        // the test ROM, translated at build time, against the interpreter
+        bool test_lockstep() const;
+    };
+}
+
+#endif
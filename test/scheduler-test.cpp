@@ -0,0 +1,224 @@
+#include "scheduler-test.h"
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "cpu-handlers.h"
+#include "scheduler.h"
+#include "serial.h"
+#include "test-helpers.h"
+
+namespace gameboy {
+    namespace {
+        class recording_handler : public scheduler::handler {
+        public:
+            void run(scheduler::event kind, unsigned long long timestamp) override
+            {
+                runs.emplace_back(kind, timestamp);
+            }
+
+            std::vector<std::pair<scheduler::event, unsigned long long>> runs;
+        };
+
+        // JP 0x0100 at reset, then LD SP, 0xFFFE; LD A, 0x04; LDH (0xFF), A, which enables the timer interrupt;
+        // INC C; RETI at its vector
+        memory timer_program(std::initializer_list<int> code)
+        {
+            std::vector<int> start{0x31, 0xFE, 0xFF, 0x3E, 0x04, 0xE0, 0xFF};
+            start.insert(start.end(), code);
+            return make_program({{0x0000, {0xC3, 0x00, 0x01}}, {0x0050, {0x0C, 0xD9}}, {0x0100, start}});
+        }
+
+        // 0x0109 of the IF write program, as gameboy-recompile would have translated it
+        int block_0109(cpu& target)
+        {
+            const auto writes = target.get_code_writes();
+            target.run_static<0x3E>(0x0004, 0x010B);
+            target.run_static<0xE0>(0x000F, 0x010D);
+            if (target.get_code_writes() != writes) {
+                return 20;
+            }
+            target.run_static<0x04>(0x0000, 0x010E);
+            target.run_static<0x04>(0x0000, 0x010F);
+            return 28 + target.run_static<0x18>(0x00FC, 0x0111);
+        }
+
+        const recompiled_block if_write_blocks[] = {{0x0109, 28, 1, 1, 0, 0, &block_0109}};
+    }
+
+    bool scheduler_test::test_ordering() const
+    {
+        auto failed = 0;
+        scheduler events;
+        recording_handler recorder;
+        for (const auto kind : {scheduler::event::timer, scheduler::event::video_line, scheduler::event::video_mode,
+            scheduler::event::serial}) {
+            events.set_handler(kind, &recorder);
+        }
+
+        failed += events.get_next() != scheduler::NEVER;
+        events.schedule(scheduler::event::timer, 300);
+        events.schedule(scheduler::event::video_line, 100);
+        events.schedule(scheduler::event::video_mode, 200);
+        events.schedule(scheduler::event::serial, 50);
+        failed += events.get_next() != 50 || events.get_preemptions() != 3;
+        // moved later, cancelled, and moved ahead of everything
+        events.schedule(scheduler::event::serial, 400);
+        events.cancel(scheduler::event::video_mode);
+        events.schedule(scheduler::event::timer, 20);
+        failed += events.get_next() != 20 || events.get_timestamp(scheduler::event::video_mode) != scheduler::NEVER;
+        failed += events.get_preemptions() != 4;
+        // and a cancelled one scheduled again, level with another
+        events.schedule(scheduler::event::video_mode, 100);
+        failed += events.get_next() != 20 || events.get_preemptions() != 4;
+
+        events.set_now(19);
+        events.run_due();
+        failed += !recorder.runs.empty();
+        events.set_now(100);
+        events.run_due();
+        // ties go to the kind declared first
+        const std::vector<std::pair<scheduler::event, unsigned long long>> expected = {
+            {scheduler::event::timer, 20}, {scheduler::event::video_line, 100}, {scheduler::event::video_mode, 100}};
+        failed += recorder.runs != expected;
+        failed += events.get_next() != 400;
+
+        events.set_now(1000);
+        events.run_due();
+        failed += recorder.runs.size() != 4 || recorder.runs.back().first != scheduler::event::serial;
+        failed += events.get_next() != scheduler::NEVER;
+
+        // an event without a handler is only dropped
+        events.schedule(scheduler::event::interrupt, 1000);
+        events.run_due();
+        failed += recorder.runs.size() != 4 || events.get_next() != scheduler::NEVER;
+
+        std::cout << "Test Scheduler Ordering: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool scheduler_test::test_interrupts() const
+    {
+        auto failed = 0;
+
+        // LDH (0x0F), A; EI; INC B; INC B; INC B; JR -2: the interrupt is taken after the INC B following EI
+        const auto delay = timer_program({0xE0, 0x0F, 0xFB, 0x04, 0x04, 0x04, 0x18, 0xFE});
+        failed += run_lockstep(delay, nullptr, 0);
+        {
+            memory mem = delay;
+            cpu interpreted{mem};
+            interpreted.run_until(68);
+            failed += interpreted.get_registers().program_counter != 0x010B
+                || interpreted.get_registers().general_bc.bytes.high != 1;
+            failed += interpreted.run_until(69) != 19;
+            failed += interpreted.get_registers().program_counter != 0x0050
+                || interpreted.get_registers().stack_pointer != 0xFFFC;
+            failed += mem.get_byte(0xFFFC) != 0x0B || mem.get_byte(0xFFFD) != 0x01;
+            failed += (mem.get_byte(memory::INTERRUPT_FLAG) & 0x1F) != 0;
+            interpreted.run_until(1000);
+            failed += interpreted.get_registers().general_bc.bytes.low != 1
+                || interpreted.get_registers().stack_pointer != 0xFFFE;
+        }
+
+        // LDH (0x0F), A; EI; DI; INC B; JR -3: never taken
+        const auto cancelled = timer_program({0xE0, 0x0F, 0xFB, 0xF3, 0x04, 0x18, 0xFD});
+        failed += run_lockstep(cancelled, nullptr, 0);
+        {
+            memory mem = cancelled;
+            cpu interpreted{mem};
+            interpreted.run_until(1000);
+            failed += interpreted.get_registers().general_bc.bytes.low != 0
+                || (mem.get_byte(memory::INTERRUPT_FLAG) & 0x1F) != memory::TIMER_INTERRUPT;
+        }
+
+        // EI; NOP; LD A, 0x04; LDH (0x0F), A; INC B; INC B; JR -4: taken right after the write, inside the block
+        const auto if_write = timer_program({0xFB, 0x00, 0x3E, 0x04, 0xE0, 0x0F, 0x04, 0x04, 0x18, 0xFC});
+        failed += run_lockstep(if_write, if_write_blocks, 1);
+        {
+            memory mem = if_write;
+            cpu interpreted{mem};
+            failed += interpreted.run_until(77) != 19;
+            failed += interpreted.get_registers().program_counter != 0x0050
+                || interpreted.get_registers().general_bc.bytes.high != 0;
+            failed += mem.get_byte(0xFFFC) != 0x0D || mem.get_byte(0xFFFD) != 0x01;
+        }
+
+        std::cout << "Test Interrupts: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool scheduler_test::test_serial() const
+    {
+        auto failed = 0;
+        // LD A, 0x42; LDH (0x01), A; LD A, 0x81; LDH (0x02), A; EI; INC B; JR -3, with the serial interrupt
+        // enabled instead of the timer's and INC C; RETI at its vector
+        auto program = timer_program({0x3E, 0x42, 0xE0, 0x01, 0x3E, 0x81, 0xE0, 0x02, 0xFB, 0x04, 0x18, 0xFD});
+        program.set_byte(0x0104, memory::SERIAL_INTERRUPT);
+        program.set_byte(0x0058, 0x0C);
+        program.set_byte(0x0059, 0xD9);
+
+        memory mem = program;
+        serial port{mem};
+        cpu interpreted{mem};
+        // the transfer starts with the write to SC at 76, and the last bit comes in 4096 cycles later
+        interpreted.run_until(76 + 4095);
+        failed += (mem.get_byte(serial::SERIAL_CONTROL) & 0x80) == 0 || mem.get_byte(serial::SERIAL_DATA) != 0x7F;
+        failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::SERIAL_INTERRUPT) != 0;
+        interpreted.run_until(10000);
+        failed += mem.get_byte(serial::SERIAL_DATA) != 0xFF || (mem.get_byte(serial::SERIAL_CONTROL) & 0x80) != 0;
+        failed += interpreted.get_registers().general_bc.bytes.low != 1 || port.get_output() != "B";
+
+        std::cout << "Test Serial: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    int scheduler_test::run_lockstep(const memory& program, const recompiled_block* blocks, std::size_t count)
+    {
+        auto failed = 0;
+        auto recompiled_runs = 0;
+        for (auto mode = 0; mode < 4; ++mode) {
+#ifndef GAMEBOY_JIT
+            if (mode == 2) {
+                continue;
+            }
+#endif
+            for (const auto step : {1, 3, 7, 16, 41, 50}) {
+                memory reference_memory = program;
+                memory tested_memory = program;
+                cpu reference{reference_memory};
+                cpu tested{tested_memory};
+                if (mode == 0) {
+                    tested.enable_block_cache(true);
+                }
+                else if (mode == 1) {
+                    tested.enable_block_cache(true);
+                    tested.enable_fusion(true);
+                }
+#ifdef GAMEBOY_JIT
+                else if (mode == 2) {
+                    tested.enable_jit(true);
+                }
+#endif
+                else if (blocks != nullptr) {
+                    tested.load_recompiled(blocks, count);
+                }
+
+                for (auto budget = step; budget < 2000; budget += step) {
+                    failed += reference.run_until(budget) != tested.run_until(budget);
+                    failed += !same_registers(reference.get_registers(), tested.get_registers());
+                }
+                for (auto address = 0; address < 0x10000; ++address) {
+                    failed += reference_memory.get_byte(address) != tested_memory.get_byte(address);
+                }
+                recompiled_runs += tested.get_recompiled_runs();
+            }
+        }
+        // only a budget that leaves room for a whole block gets to run it
+        failed += blocks != nullptr && recompiled_runs == 0;
+
+        return failed;
+    }
+}
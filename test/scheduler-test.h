@@ -0,0 +1,24 @@
+#ifndef SCHEDULER_TEST_H
+#define SCHEDULER_TEST_H
+
+#include <cstddef>
+#include "cpu.h"
+#include "memory.h"
+#include "recompiled.h"
+
+namespace gameboy {
+    class scheduler_test {
+    public:
+        // events come out earliest first whatever order they were scheduled, moved or cancelled in
+        bool test_ordering() const;
+        // the EI delay, DI right after EI, and an IF write in the middle of a block, with every way of running code
+        bool test_interrupts() const;
+        // a byte shifted out over 4096 cycles, then the serial interrupt
+        bool test_serial() const;
+    private:
+        // runs program with the block cache, fusion, the JIT and blocks against the interpreter at many budgets
+        static int run_lockstep(const memory& program, const recompiled_block* blocks, std::size_t count);
+    };
+}
+
+#endif
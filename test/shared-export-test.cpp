@@ -0,0 +1,191 @@
+#include "shared-export-test.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "memory.h"
+#include "ppu.h"
+#include "registers.h"
+#include "shared-export.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace gameboy {
+    namespace {
+        // a timed register that counts how often it is read
+        class polled_register : public memory::handler {
+        public:
+            byte read(int) override
+            {
+                ++reads;
+                return 0x00;
+            }
+
+            void write(int, byte) override
+            {
+            }
+
+            bool is_timed(int) const override
+            {
+                return true;
+            }
+
+            int reads = 0;
+        };
+    }
+
+    bool shared_export_test::test_snapshots() const
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        // one of its own for every run, which one killed half way through cannot leave in the way
+        const auto name = "/gameboy-test-export-" + std::to_string(getpid());
+        const auto refused = [](const std::function<void()>& attempt) {
+            try {
+                attempt();
+            }
+            catch (const std::runtime_error&) {
+                return true;
+            }
+            return false;
+        };
+
+        auto failed = 0;
+        memory mem;
+        for (auto offset = 0; offset < 16; ++offset) {
+            mem.set_byte(0xC000 + offset, static_cast<byte>(0xA0 + offset));
+        }
+        mem.set_byte(0xFF80, 0x5A);
+        registers state;
+        state.accumulator = 0x12;
+        state.flag = static_cast<byte>(0xB0);
+        state.general_bc.bytes.high = 0x34;
+        state.general_bc.bytes.low = 0x56;
+        state.general_hl.bytes.low = 0x78;
+        state.stack_pointer = 0xFFFE;
+        state.program_counter = 0x0150;
+        ppu::frame frame;
+        for (std::size_t pixel = 0; pixel < frame.size(); ++pixel) {
+            frame[pixel] = static_cast<byte>(pixel % 4);
+        }
+
+        failed += !refused([&name]() { shared_export::view{name}; });
+        failed += !refused([&name]() { shared_export{name, std::vector<std::pair<int, int>>(9, {0xC000, 1})}; });
+        failed += !refused([&name]() { shared_export{name, {{0xFFF0, 0x20}}}; });
+
+        std::unique_ptr<shared_export::view> kept;
+        {
+            shared_export exported{name, {{0xC000, 16}, {0xFF80, 1}}};
+            // the name stays with whoever has it
+            failed += !refused([&name]() { shared_export{name, {}}; });
+            shared_export::view reader{exported.get_name()};
+            const auto& header = reader.get_header();
+            failed += header.magic != shared_export::MAGIC || header.width != ppu::WIDTH || header.height != ppu::HEIGHT;
+            std::uint64_t sequence;
+            failed += header.region_count != 2 || header.snapshots != 0 || !reader.begin_read(sequence) || sequence != 0;
+
+            exported.publish(state, mem, frame);
+            failed += !reader.begin_read(sequence) || sequence != 2 || header.snapshots != 1;
+            failed += !std::equal(frame.begin(), frame.end(), reader.get_frame());
+            const auto& values = reader.get_registers();
+            failed += values.a != 0x12 || values.f != 0xB0 || values.b != 0x34 || values.c != 0x56 || values.l != 0x78;
+            failed += values.sp != 0xFFFE || values.pc != 0x0150;
+            failed += reader.get_region(0)[15] != 0xAF || reader.get_region(1)[0] != 0x5A;
+            failed += !reader.end_read(sequence);
+
+            // a snapshot published in the middle of a read spoils it
+            failed += !reader.begin_read(sequence);
+            mem.set_byte(0xFF80, 0xA5);
+            exported.publish(state, mem, frame);
+            failed += reader.end_read(sequence) || reader.get_region(1)[0] != 0xA5;
+
+            // frames in one shade after another, which a reader keeping only what end_read() lets through never
+            // sees mixed
+            std::fill(frame.begin(), frame.end(), byte{0});
+            exported.publish(state, mem, frame);
+            std::atomic<bool> running{true};
+            auto torn = 0, whole = 0;
+            std::thread sampler{[&]() {
+                std::vector<byte> copy(frame.size());
+                while (running.load()) {
+                    std::uint64_t read;
+                    const auto begun = reader.begin_read(read);
+                    std::copy_n(reader.get_frame(), copy.size(), copy.begin());
+                    if (begun && reader.end_read(read)) {
+                        ++whole;
+                        torn += std::any_of(copy.begin(), copy.end(), [&copy](byte shade) { return shade != copy[0]; });
+                    }
+                    std::this_thread::yield();
+                }
+            }};
+            for (auto count = 1; count <= 2000; ++count) {
+                std::fill(frame.begin(), frame.end(), static_cast<byte>(count % 4));
+                exported.publish(state, mem, frame);
+                std::this_thread::yield();
+            }
+            running.store(false);
+            sampler.join();
+            failed += torn != 0 || whole == 0 || header.snapshots != 2003;
+
+            // a writer that died in the middle of a publish leaves the sequence odd, which a reader gives up on
+            const auto descriptor = shm_open(name.c_str(), O_RDWR, 0);
+            const auto mapping = descriptor >= 0
+                ? mmap(nullptr, sizeof(shared_export::header), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0)
+                : MAP_FAILED;
+            if (descriptor >= 0) {
+                close(descriptor);
+            }
+            if (mapping == MAP_FAILED) {
+                ++failed;
+            }
+            else {
+                auto& written = static_cast<shared_export::header*>(mapping)->sequence;
+                written.fetch_add(1);
+                failed += reader.begin_read(sequence);
+                written.fetch_sub(1);
+                failed += !reader.begin_read(sequence) || sequence != 4006;
+                munmap(mapping, sizeof(shared_export::header));
+            }
+
+            kept.reset(new shared_export::view{name});
+        }
+        // the name is gone, but a view keeps what it mapped for as long as it lives
+        failed += !refused([&name]() { shared_export::view{name}; });
+        failed += kept->get_header().snapshots != 2003 || kept->get_registers().pc != 0x0150;
+
+        // publishing copies what memory holds, and never reads a device's registers, which are left out of regions
+        // as memory has no say in what they read
+        {
+            polled_register device;
+            mem.set_io_handler(0xFF44, &device);
+            failed += !refused([&name]() { shared_export{name, {{0xFF40, 8}}}; });
+            failed += !refused([&name]() { shared_export{name, {{0xFEF0, 0x11}}}; });
+            failed += !refused([&name]() { shared_export{name, {{0xFF7F, 2}}}; });
+            mem.set_byte(0xFEFF, 0x3C);
+            mem.set_byte(0xFFFF, 0x1F);
+            shared_export exported{name, {{0xFEFF, 1}, {0xFF80, 0x80}, {0xFF00, 0}}};
+            exported.publish(state, mem, frame);
+            shared_export::view reader{name};
+            failed += device.reads != 0 || mem.get_timed_reads() != 0;
+            const auto high = reader.get_region(1);
+            failed += reader.get_region(0)[0] != 0x3C || high[0] != 0xA5 || high[0x7F] != 0x1F;
+            mem.set_io_handler(0xFF44, nullptr);
+        }
+
+        std::cout << "Test Shared Export Snapshots: failed = " << failed << std::endl;
+
+        return failed == 0;
+#else
+        std::cout << "Test Shared Export Snapshots: not supported here" << std::endl;
+        return true;
+#endif
+    }
+}
@@ -0,0 +1,13 @@
+#ifndef SHARED_EXPORT_TEST_H
+#define SHARED_EXPORT_TEST_H
+
+namespace gameboy {
+    class shared_export_test {
+    public:
+        // a snapshot read back whole through a view, a read overlapping a publish caught, a reader thread never
+        // keeping a mixed frame, a reader giving up on a writer that died, and publishing leaving devices alone
+        bool test_snapshots() const;
+    };
+}
+
+#endif
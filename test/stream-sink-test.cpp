@@ -0,0 +1,202 @@
+#include "stream-sink-test.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include "ppu.h"
+#include "stream-sink.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace gameboy {
+    bool stream_sink_test::test_video() const
+    {
+        const std::string path = "gameboy-test-video.y4m";
+        const std::string header = "YUV4MPEG2 W160 H144 F262144:4389 Ip A1:1 Cmono\n";
+        const std::size_t record = 6 + ppu::WIDTH * ppu::HEIGHT;
+        // enough frames for a dozen chunks, each one in a shade of its own after a row in each of the others
+        constexpr auto frame_count = 150;
+        auto failed = 0;
+        {
+            y4m_sink sink{path};
+            ppu::frame frame;
+            for (auto count = 0; count < frame_count; ++count) {
+                std::fill(frame.begin(), frame.end(), static_cast<byte>(count % 4));
+                for (std::size_t pixel = 0; pixel < 4; ++pixel) {
+                    frame[pixel] = static_cast<byte>(pixel);
+                }
+                failed += !sink.write_frame(frame);
+            }
+            sink.get_writer().flush();
+            failed += sink.get_frames() != frame_count || sink.get_writer().get_written() != header.size() + frame_count * record;
+            failed += sink.get_writer().get_dropped() != 0 || sink.get_writer().has_failed();
+
+            // a record bigger than a chunk is dropped, and leaves the file alone
+            std::vector<byte> oversized(stream_writer::CHUNK_SIZE + 1);
+            failed += sink.get_writer().write(oversized.data(), oversized.size()) || sink.get_writer().get_dropped() != 1;
+        }
+
+        const auto contents = read_file(path);
+        failed += contents.size() != header.size() + frame_count * record;
+        failed += !std::equal(header.begin(), header.end(), contents.begin());
+        for (auto count = 0; count < frame_count && contents.size() == header.size() + frame_count * record; ++count) {
+            const auto start = contents.begin() + static_cast<long>(header.size() + count * record);
+            const byte luma[] = {0xFF, 0xAA, 0x55, 0x00};
+            failed += std::memcmp(&*start, "FRAME\n", 6) != 0 || !std::equal(luma, luma + 4, start + 6);
+            failed += std::any_of(start + 10, start + static_cast<long>(record),
+                [&luma, count](byte value) { return value != luma[count % 4]; });
+        }
+        std::remove(path.c_str());
+
+        try {
+            y4m_sink missing{"gameboy-test-missing/video.y4m"};
+            ++failed;
+        }
+        catch (const std::runtime_error&) {
+        }
+
+        std::cout << "Test Stream Sink Video: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool stream_sink_test::test_audio() const
+    {
+        const std::string path = "gameboy-test-audio.wav";
+        // more than a chunk's worth in one go
+        std::vector<std::int16_t> samples(stream_writer::CHUNK_SIZE);
+        for (std::size_t index = 0; index < samples.size(); ++index) {
+            samples[index] = static_cast<std::int16_t>(index * 7 - 30000);
+        }
+        auto failed = 0;
+        {
+            wav_sink sink{path, 48000, 2};
+            failed += !sink.write_samples(samples.data(), samples.size());
+            failed += !sink.write_samples(samples.data(), 2);
+        }
+
+        const auto contents = read_file(path);
+        const auto little = [&contents](std::size_t offset, int size) {
+            std::uint32_t value = 0;
+            for (auto index = size - 1; index >= 0; --index) {
+                value = value << 8 | contents[offset + static_cast<std::size_t>(index)];
+            }
+            return value;
+        };
+        const auto data_size = (samples.size() + 2) * 2;
+        failed += contents.size() != wav_sink::HEADER_SIZE + data_size;
+        if (contents.size() == wav_sink::HEADER_SIZE + data_size) {
+            failed += std::memcmp(&contents[0], "RIFF", 4) != 0 || std::memcmp(&contents[8], "WAVEfmt ", 8) != 0;
+            failed += std::memcmp(&contents[36], "data", 4) != 0;
+            failed += little(4, 4) != wav_sink::HEADER_SIZE - 8 + data_size || little(40, 4) != data_size;
+            failed += little(20, 2) != 1 || little(22, 2) != 2 || little(24, 4) != 48000 || little(28, 4) != 48000 * 4;
+            failed += little(32, 2) != 4 || little(34, 2) != 16;
+            for (std::size_t index = 0; index < samples.size(); ++index) {
+                failed += static_cast<std::int16_t>(little(wav_sink::HEADER_SIZE + index * 2, 2)) != samples[index];
+            }
+            failed += static_cast<std::int16_t>(little(contents.size() - 2, 2)) != samples[1];
+        }
+        std::remove(path.c_str());
+
+        std::cout << "Test Stream Sink Audio: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool stream_sink_test::test_overflow() const
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        const auto path = "gameboy-test-pipe-" + std::to_string(getpid());
+        auto failed = 0;
+        for (const auto policy : {stream_writer::overflow::drop, stream_writer::overflow::wait}) {
+            failed += mkfifo(path.c_str(), 0600) != 0;
+            // the read end opened first, so the sink does not wait to open the write one
+            const auto reader = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+            failed += reader < 0;
+
+            std::atomic<bool> reading{false};
+            std::atomic<unsigned long long> read_count{0};
+            std::thread drain{[&]() {
+                std::vector<char> buffer(65536);
+                for (;;) {
+                    if (!reading.load()) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        continue;
+                    }
+                    const auto count = read(reader, buffer.data(), buffer.size());
+                    if (count > 0) {
+                        read_count += static_cast<unsigned long long>(count);
+                    }
+                    else if (count == 0) {
+                        return;
+                    }
+                    else {
+                        std::this_thread::yield();
+                    }
+                }
+            }};
+
+            {
+                y4m_sink sink{path, policy};
+                ppu::frame frame{};
+                // ten seconds of frames are more than the pool and the pipe hold together
+                constexpr auto frame_count = 600;
+                if (policy == stream_writer::overflow::drop) {
+                    // with nothing read until the end, the first few fill the pipe and the pool and the rest go
+                    const auto start = std::chrono::steady_clock::now();
+                    for (auto count = 0; count < frame_count; ++count) {
+                        sink.write_frame(frame);
+                    }
+                    const auto elapsed = std::chrono::steady_clock::now() - start;
+                    failed += sink.get_writer().get_dropped() == 0 || elapsed > std::chrono::seconds(2);
+                    failed += sink.get_frames() + sink.get_writer().get_dropped() != frame_count;
+                    reading.store(true);
+                }
+                else {
+                    // all of them, once the pipe is read
+                    std::thread late{[&reading]() {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                        reading.store(true);
+                    }};
+                    for (auto count = 0; count < frame_count; ++count) {
+                        failed += !sink.write_frame(frame);
+                    }
+                    late.join();
+                    failed += sink.get_writer().get_dropped() != 0;
+                }
+                sink.get_writer().finish();
+                failed += sink.get_writer().has_failed();
+                failed += sink.get_writer().get_written() != 47 + sink.get_frames() * (6 + ppu::WIDTH * ppu::HEIGHT);
+            }
+
+            drain.join();
+            close(reader);
+            unlink(path.c_str());
+            failed += read_count.load() == 0;
+        }
+
+        std::cout << "Test Stream Sink Overflow: failed = " << failed << std::endl;
+
+        return failed == 0;
+#else
+        std::cout << "Test Stream Sink Overflow: not supported here" << std::endl;
+        return true;
+#endif
+    }
+
+    std::vector<byte> stream_sink_test::read_file(const std::string& path)
+    {
+        std::ifstream file{path, std::ios::binary};
+        return {std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+}
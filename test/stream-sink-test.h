@@ -0,0 +1,22 @@
+#ifndef STREAM_SINK_TEST_H
+#define STREAM_SINK_TEST_H
+
+#include <string>
+#include <vector>
+#include "byte.h"
+
+namespace gameboy {
+    class stream_sink_test {
+    public:
+        // the header and frames read back from a Y4M file, many chunks long
+        bool test_video() const;
+        // the header, sizes filled in, and samples read back from a WAV file
+        bool test_audio() const;
+        // frames to a pipe nobody reads from are dropped rather than waited for, or waited for until it is read
+        bool test_overflow() const;
+    private:
+        static std::vector<byte> read_file(const std::string& path);
+    };
+}
+
+#endif
@@ -0,0 +1,50 @@
+#include "test-helpers.h"
+#include "cartridge.h"
+
+namespace gameboy {
+    memory make_program(const std::vector<std::pair<int, std::vector<int>>>& code)
+    {
+        memory program;
+        for (const auto& part : code) {
+            auto address = part.first;
+            for (const auto value : part.second) {
+                program.set_byte(address++, static_cast<byte>(value));
+            }
+        }
+
+        return program;
+    }
+
+    std::vector<byte> make_rom(byte type, byte rom_size, byte ram_size, int banks)
+    {
+        std::vector<byte> rom(static_cast<std::size_t>(banks * cartridge::ROM_BANK_SIZE));
+        for (auto bank = 0; bank < banks; ++bank) {
+            rom[static_cast<std::size_t>(bank * cartridge::ROM_BANK_SIZE + 0x1000)] = static_cast<byte>(bank);
+            rom[static_cast<std::size_t>(bank * cartridge::ROM_BANK_SIZE + 0x1001)] = static_cast<byte>(bank >> 8);
+        }
+        rom[0x0147] = type;
+        rom[0x0148] = rom_size;
+        rom[0x0149] = ram_size;
+        rom[0x014D] = cartridge::compute_header_checksum(rom.data());
+
+        auto sum = 0u;
+        for (const auto value : rom) {
+            sum += value;
+        }
+        rom[0x014E] = static_cast<byte>(sum >> 8);
+        rom[0x014F] = static_cast<byte>(sum);
+
+        return rom;
+    }
+
+    bool same_registers(const registers& expected, const registers& actual)
+    {
+        return expected.accumulator == actual.accumulator
+            && static_cast<byte>(expected.flag) == static_cast<byte>(actual.flag)
+            && expected.general_bc.value == actual.general_bc.value
+            && expected.general_de.value == actual.general_de.value
+            && expected.general_hl.value == actual.general_hl.value
+            && expected.stack_pointer == actual.stack_pointer
+            && expected.program_counter == actual.program_counter;
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <utility>
+#include <vector>
+#include "byte.h"
+#include "memory.h"
+#include "registers.h"
+
+namespace gameboy {
+    // plain RAM with each piece of code placed at its address, and zeros around them
+    memory make_program(const std::vector<std::pair<int, std::vector<int>>>& code);
+    // banks of the given count, each with its own number at offset 0x1000, low byte first, behind a header with
+    // valid checksums
+    std::vector<byte> make_rom(byte type, byte rom_size, byte ram_size, int banks);
+    // every register, the flags compared as the byte F holds however they are kept
+    bool same_registers(const registers& expected, const registers& actual);
+}
+
+#endif
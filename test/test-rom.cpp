@@ -0,0 +1,105 @@
+#include "test-rom.h"
+#include <array>
+#include <initializer_list>
+#include "cartridge.h"
+
+namespace gameboy {
+    namespace {
+        void place(memory& rom, int address, std::initializer_list<int> code)
+        {
+            for (const auto value : code) {
+                rom.set_byte(address++, static_cast<byte>(value));
+            }
+        }
+    }
+
+    void load_test_rom(memory& rom)
+    {
+        for (auto address = 0; address < 0x8000; ++address) {
+            rom.set_byte(address, 0x00);
+        }
+
+        // reset jumps to the entry point, RST targets return straight away and the interrupt vectors with RETI
+        place(rom, 0x0000, {0xC3, 0x00, 0x01});
+        for (auto vector = 0x08; vector < 0x40; vector += 0x08) {
+            place(rom, vector, {0xC9});
+        }
+        for (auto vector = 0x40; vector <= 0x60; vector += 0x08) {
+            place(rom, vector, {0xD9});
+        }
+
+        // NOP; JP 0x0150
+        place(rom, 0x0100, {0x00, 0xC3, 0x50, 0x01});
+        place(rom, 0x0150, {
+            0x31, 0xFE, 0xFF,   // LD SP, 0xFFFE
+            0x21, 0x00, 0xC0,   // LD HL, 0xC000
+            0x11, 0x00, 0x03,   // LD DE, 0x0300
+            0x06, 0x08,         // LD B, 8
+            0x1A,               // copy: LD A, (DE)
+            0x22,               // LD (HL+), A
+            0x13,               // INC DE
+            0x05,               // DEC B
+            0x20, 0xFA,         // JR NZ, copy
+            0x3E, 0x12,         // loop: LD A, 0x12
+            0x06, 0x34,         // LD B, 0x34
+            0xCD, 0x00, 0x02,   // CALL 0x0200
+            0x1C,               // INC E
+            0xCD, 0x00, 0xC0,   // CALL 0xC000
+            0x21, 0x40, 0x02,   // LD HL, 0x0240
+            0xE9                // JP (HL)
+        });
+        place(rom, 0x0200, {
+            0x80,               // ADD A, B
+            0x07,               // RLCA
+            0xA9,               // XOR C
+            0x4F,               // LD C, A
+            0xCB, 0x37,         // SWAP A
+            0x27,               // DAA
+            0xC9                // RET
+        });
+        // only reached through JP (HL)
+        place(rom, 0x0240, {
+            0xCE, 0x05,         // ADC A, 5
+            0x9A,               // SBC A, D
+            0xFE, 0x40,         // CP 0x40
+            0x38, 0x02,         // JR C, +2
+            0x14,               // INC D
+            0x14,               // INC D
+            0xEA, 0x00, 0xC1,   // LD (0xC100), A
+            0x21, 0x01, 0xC1,   // LD HL, 0xC101
+            0x34,               // INC (HL)
+            0x7E,               // LD A, (HL)
+            0xE6, 0x03,         // AND 3
+            0x20, 0x03,         // JR NZ, +3
+            0xCD, 0x80, 0x02,   // CALL 0x0280
+            0xC3, 0x61, 0x01    // JP loop
+        });
+        place(rom, 0x0280, {
+            0xC5,               // PUSH BC
+            0x01, 0x11, 0x22,   // LD BC, 0x2211
+            0x09,               // ADD HL, BC
+            0xC1,               // POP BC
+            0xCB, 0x11,         // RL C
+            0xD0,               // RET NC
+            0x3C,               // INC A
+            0xC9                // RET
+        });
+        // copied to 0xC000 and called there
+        place(rom, 0x0300, {
+            0x3C,               // INC A
+            0x87,               // ADD A, A
+            0xCB, 0x3F,         // SRL A
+            0x2F,               // CPL
+            0x37,               // SCF
+            0x3F,               // CCF
+            0xC9                // RET
+        });
+
+        // an all-zero header otherwise, which is a ROM without a controller or RAM
+        std::array<byte, 0x0150> header;
+        for (std::size_t address = 0; address < header.size(); ++address) {
+            header[address] = static_cast<byte>(rom.get_byte(static_cast<int>(address)));
+        }
+        rom.set_byte(0x014D, cartridge::compute_header_checksum(header.data()));
+    }
+}
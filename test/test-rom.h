@@ -0,0 +1,12 @@
+#ifndef TEST_ROM_H
+#define TEST_ROM_H
+
+#include "memory.h"
+
+namespace gameboy {
+    // a small program that runs forever without I/O: a copy loop, calls into ROM and into code it copied to RAM,
+    // and a JP (HL) into code nothing else leads to. gameboy-test-rom writes it out for gameboy-recompile.
+    void load_test_rom(memory& rom);
+}
+
+#endif
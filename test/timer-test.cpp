@@ -0,0 +1,319 @@
+#include "timer-test.h"
+#include <initializer_list>
+#include <functional>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "test-helpers.h"
+#include "timer.h"
+
+namespace gameboy {
+    bool timer_test::test_divider() const
+    {
+        auto failed = 0;
+        memory mem;
+        timer device{mem};
+        auto& events = mem.get_scheduler();
+
+        for (const auto time : {0ull, 255ull, 256ull, 1000ull, 65535ull, 65536ull, 70000ull}) {
+            events.set_now(time);
+            failed += mem.get_byte(timer::DIVIDER) != static_cast<byte>(time >> 8);
+        }
+
+        // any write resets it
+        events.set_now(70100);
+        mem.set_byte(timer::DIVIDER, 0x55);
+        failed += mem.get_byte(timer::DIVIDER) != 0;
+        events.set_now(70100 + 255);
+        failed += mem.get_byte(timer::DIVIDER) != 0;
+        events.set_now(70100 + 256);
+        failed += mem.get_byte(timer::DIVIDER) != 1;
+
+        std::cout << "Test Timer Divider: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool timer_test::test_overflow() const
+    {
+        auto failed = 0;
+        // TIMA set to 0xFE at cycle 100 overflows on the second falling edge after it
+        const std::initializer_list<std::pair<byte, unsigned long long>> rates = {
+            {0x04, 2048}, {0x05, 128}, {0x06, 192}, {0x07, 512}};
+        for (const auto& rate : rates) {
+            memory mem;
+            timer device{mem};
+            auto& events = mem.get_scheduler();
+            const auto period = rate.first == 0x04 ? 1024ull : rate.first == 0x05 ? 16ull : rate.first == 0x06 ? 64ull : 256ull;
+
+            events.set_now(100);
+            mem.set_byte(timer::MODULO, 0x80);
+            mem.set_byte(timer::COUNTER, 0xFE);
+            mem.set_byte(timer::CONTROL, rate.first);
+            failed += events.get_timestamp(scheduler::event::timer) != rate.second;
+            failed += mem.get_byte(timer::CONTROL) != (rate.first | 0xF8);
+
+            events.set_now(rate.second - period);
+            events.run_due();
+            failed += mem.get_byte(timer::COUNTER) != 0xFF;
+            events.set_now(rate.second - 1);
+            events.run_due();
+            failed += mem.get_byte(timer::COUNTER) != 0xFF;
+            failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::TIMER_INTERRUPT) != 0;
+
+            events.set_now(rate.second);
+            events.run_due();
+            failed += mem.get_byte(timer::COUNTER) != 0x80;
+            failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::TIMER_INTERRUPT) == 0;
+            // from TMA, 0x80 more edges to the next one
+            failed += events.get_timestamp(scheduler::event::timer) != rate.second + 0x80 * period;
+
+            // reads in between count the edges passed
+            events.set_now(rate.second + 5 * period + period / 2);
+            failed += mem.get_byte(timer::COUNTER) != 0x85;
+        }
+
+        std::cout << "Test Timer Overflow: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool timer_test::test_writes() const
+    {
+        auto failed = 0;
+        memory mem;
+        timer device{mem};
+        auto& events = mem.get_scheduler();
+
+        // every 16 cycles, from 0x10
+        mem.set_byte(timer::COUNTER, 0x10);
+        mem.set_byte(timer::CONTROL, 0x05);
+        events.set_now(56);
+        failed += mem.get_byte(timer::COUNTER) != 0x13;
+        // bit 3 of the counter is set at 56, so resetting it is one more edge, and the next one is 16 cycles on
+        mem.set_byte(timer::DIVIDER, 0x00);
+        failed += mem.get_byte(timer::COUNTER) != 0x14;
+        events.set_now(71);
+        failed += mem.get_byte(timer::COUNTER) != 0x14;
+        events.set_now(72);
+        failed += mem.get_byte(timer::COUNTER) != 0x15;
+        failed += events.get_timestamp(scheduler::event::timer) != 56 + (0x100 - 0x14) * 16;
+
+        // with bit 3 clear, a reset is not an edge
+        events.set_now(76);
+        mem.set_byte(timer::DIVIDER, 0x00);
+        failed += mem.get_byte(timer::COUNTER) != 0x15;
+
+        // turning the timer off while the bit is set is one too, and then TIMA stays put
+        events.set_now(76 + 8);
+        mem.set_byte(timer::CONTROL, 0x01);
+        failed += mem.get_byte(timer::COUNTER) != 0x16;
+        failed += events.get_timestamp(scheduler::event::timer) != scheduler::NEVER;
+        events.set_now(5000);
+        failed += mem.get_byte(timer::COUNTER) != 0x16;
+
+        // on again at 1024 cycles, and TIMA written to 0xFF overflows on the very next edge
+        mem.set_byte(timer::CONTROL, 0x04);
+        mem.set_byte(timer::COUNTER, 0xFF);
+        failed += events.get_timestamp(scheduler::event::timer) != 76 + 5 * 1024;
+        events.set_now(76 + 5 * 1024);
+        events.run_due();
+        failed += mem.get_byte(timer::COUNTER) != 0x00;
+        failed += (mem.get_byte(memory::INTERRUPT_FLAG) & memory::TIMER_INTERRUPT) == 0;
+
+        std::cout << "Test Timer Writes: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool timer_test::test_program() const
+    {
+        // TIMA every 16 cycles from TMA 0xF8, so an interrupt every 128; the loop logs TIMA and DIV from 0xC000 on
+        // and the handler counts in C and logs TIMA at 0xD000 on
+        const auto program = make_program({
+            {0x0000, {0xC3, 0x00, 0x01}},
+            // INC C; LDH A, (0x05); LD (DE), A; INC DE; RETI
+            {0x0050, {0x0C, 0xF0, 0x05, 0x12, 0x13, 0xD9}},
+            // LD SP, 0xFFFE; LD HL, 0xC000; LD DE, 0xD000; LD A, 0x04; LDH (0xFF), A; LD A, 0xF8; LDH (0x06), A;
+            // LD A, 0x05; LDH (0x07), A; EI
+            {0x0100, {0x31, 0xFE, 0xFF, 0x21, 0x00, 0xC0, 0x11, 0x00, 0xD0, 0x3E, 0x04, 0xE0, 0xFF, 0x3E, 0xF8,
+                0xE0, 0x06, 0x3E, 0x05, 0xE0, 0x07, 0xFB,
+                // LDH A, (0x05); LD (HL+), A; LDH A, (0x04); LD (HL+), A; INC B; RES 4, H; JR -11
+                0xF0, 0x05, 0x22, 0xF0, 0x04, 0x22, 0x04, 0xCB, 0xA4, 0x18, 0xF5}}});
+
+        const auto failed = run_lockstep(program, [](const cpu& reference, const memory& mem) {
+            // TAC is written at 100, six edges in, so TIMA first overflows from 0 on edge 262 and then every 8
+            // edges; one more overflow can be waiting for the instruction in progress to end
+            const auto interrupts = reference.get_registers().general_bc.bytes.low;
+            const auto expected = (LOCKSTEP_CYCLES - 1 - 262 * 16) / 128 + 1;
+            // the handler reads TIMA a few cycles after the reload
+            return (interrupts != (expected & 0xFF) && interrupts != ((expected - 1) & 0xFF)) + (mem.get_byte(0xD000) != 0xF9);
+        });
+
+        std::cout << "Test Timer Program: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool timer_test::test_halt() const
+    {
+        auto failed = 0;
+        // TIMA every 16 cycles from TMA 0xF0, so an interrupt every 256, with the handler counting in C
+        const std::vector<int> setup = {
+            // LD SP, 0xFFFE; LD A, 0x04; LDH (0xFF), A; LD A, 0xF0; LDH (0x06), A; LDH (0x05), A; LD A, 0x05;
+            // LDH (0x07), A
+            0x31, 0xFE, 0xFF, 0x3E, 0x04, 0xE0, 0xFF, 0x3E, 0xF0, 0xE0, 0x06, 0xE0, 0x05, 0x3E, 0x05, 0xE0, 0x07};
+        const auto with = [&setup](std::vector<int> code) {
+            code.insert(code.begin(), setup.begin(), setup.end());
+            return make_program({{0x0000, {0xC3, 0x00, 0x01}}, {0x0050, {0x0C, 0xD9}}, {0x0100, code}});
+        };
+
+        // EI; HALT; INC B; JR -4: TAC is written at 88, five edges in, so the first overflow is on edge 21
+        const auto halted = with({0xFB, 0x76, 0x04, 0x18, 0xFC});
+        {
+            memory mem = halted;
+            timer device{mem};
+            cpu interpreted{mem};
+            // the HALT sleeps right up to the end of the run, and then to the overflow
+            failed += interpreted.run_until(333) != 3;
+            failed += interpreted.get_registers().program_counter != 0x0112 || interpreted.get_registers().general_bc.value != 0;
+            failed += interpreted.run_until(337) != 19;
+            failed += interpreted.get_registers().program_counter != 0x0050;
+            // the interrupt returns past the HALT
+            failed += mem.get_byte(0xFFFC) != 0x13 || mem.get_byte(0xFFFD) != 0x01;
+        }
+        failed += run_lockstep(halted, [](const cpu& reference, const memory&) {
+            const auto expected = (LOCKSTEP_CYCLES - 1 - 336) / 256 + 1;
+            const auto& registers = reference.get_registers();
+            return registers.general_bc.bytes.low != expected || registers.general_bc.bytes.high != expected;
+        });
+
+        // DI; HALT; INC B; XOR A; LDH (0x0F), A; JR -7: with IME off the HALT just ends, and IF has to be cleared
+        const auto polled = with({0xF3, 0x76, 0x04, 0xAF, 0xE0, 0x0F, 0x18, 0xF9});
+        failed += run_lockstep(polled, [](const cpu& reference, const memory&) {
+            const auto expected = (LOCKSTEP_CYCLES - 1 - 336) / 256 + 1;
+            const auto& registers = reference.get_registers();
+            return registers.general_bc.bytes.low != 0 || registers.general_bc.bytes.high != expected;
+        });
+
+        // EI; STOP; INC B; JR -5: the divider reset on every STOP moves the edges, but the timer still wakes it
+        const auto stopped = with({0xFB, 0x10, 0x00, 0x04, 0x18, 0xFB});
+        failed += run_lockstep(stopped, [](const cpu& reference, const memory&) {
+            const auto& registers = reference.get_registers();
+            return registers.general_bc.bytes.low < 10 || registers.general_bc.bytes.low != registers.general_bc.bytes.high;
+        });
+
+        std::cout << "Test Timer Halt: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    bool timer_test::test_idle_loops() const
+    {
+        auto failed = 0;
+        // the same timer as test_halt(), with the handler counting in C and setting the flag at 0xC000
+        const std::vector<int> setup = {
+            0x31, 0xFE, 0xFF, 0x3E, 0x04, 0xE0, 0xFF, 0x3E, 0xF0, 0xE0, 0x06, 0xE0, 0x05, 0x3E, 0x05, 0xE0, 0x07};
+        const auto with = [&setup](std::vector<int> code) {
+            code.insert(code.begin(), setup.begin(), setup.end());
+            // INC C; LD A, 0x01; LD (0xC000), A; RETI
+            return make_program({{0x0000, {0xC3, 0x00, 0x01}}, {0x0050, {0x0C, 0x3E, 0x01, 0xEA, 0x00, 0xC0, 0xD9}},
+                {0x0100, code}});
+        };
+        // runs the whole stretch at once through the block cache, and returns the cycles it skipped
+        const auto skipped = [](const memory& program, bool enabled, registers& result) {
+            memory mem = program;
+            timer device{mem};
+            cpu tested{mem};
+            tested.enable_block_cache(true);
+            tested.enable_idle_skipping(enabled);
+            tested.run_until(LOCKSTEP_CYCLES);
+            result = tested.get_registers();
+            return tested.get_skipped_cycles();
+        };
+
+        // EI; XOR A; LD (0xC000), A; LD A, (0xC000); OR A; JR Z, -6; INC B; JR -13: waiting for the handler to
+        // set the flag, the way games wait for VBlank
+        const auto flagged = with({0xFB, 0xAF, 0xEA, 0x00, 0xC0, 0xFA, 0x00, 0xC0, 0xB7, 0x28, 0xFA, 0x04, 0x18, 0xF3});
+        failed += run_lockstep(flagged, [](const cpu& reference, const memory&) {
+            const auto& registers = reference.get_registers();
+            return registers.general_bc.bytes.low < 10 || registers.general_bc.bytes.high + 1 < registers.general_bc.bytes.low
+                || registers.general_bc.bytes.high > registers.general_bc.bytes.low;
+        });
+        registers on, off;
+        // a good part of the time goes to waiting, and skipping it changes nothing
+        failed += skipped(flagged, true, on) < LOCKSTEP_CYCLES / 5;
+        failed += skipped(flagged, false, off) != 0;
+        failed += !same_registers(on, off);
+
+        // DI; LDH A, (0x0F); AND 0x04; JR Z, -6; INC B; XOR A; LDH (0x0F), A; JR -11: polling IF with IME off
+        const auto polled = with({0xF3, 0xF0, 0x0F, 0xE6, 0x04, 0x28, 0xFA, 0x04, 0xAF, 0xE0, 0x0F, 0x18, 0xF4});
+        failed += run_lockstep(polled, [](const cpu& reference, const memory&) {
+            const auto expected = (LOCKSTEP_CYCLES - 1 - 336) / 256 + 1;
+            const auto& registers = reference.get_registers();
+            return registers.general_bc.bytes.low != 0 || registers.general_bc.bytes.high < expected - 1
+                || registers.general_bc.bytes.high > expected;
+        });
+        failed += skipped(polled, true, on) < LOCKSTEP_CYCLES / 5;
+
+        // LDH A, (0x04); CP 0x40; JR NZ, -6; INC B; JR -9: DIV changes between events, so this loop has to run
+        const auto divided = make_program({{0x0000, {0xC3, 0x00, 0x01}},
+            {0x0100, {0xF0, 0x04, 0xFE, 0x40, 0x20, 0xFA, 0x04, 0x18, 0xF7}}});
+        failed += run_lockstep(divided, [](const cpu& reference, const memory&) {
+            return reference.get_registers().general_bc.bytes.high == 0;
+        });
+        failed += skipped(divided, true, on) != 0;
+
+        // EI; INC D; LD A, (0xC000); OR A; JR Z, -7; INC B; JR -10: a loop that counts comes round to different
+        // registers
+        const auto counted = with({0xFB, 0x14, 0xFA, 0x00, 0xC0, 0xB7, 0x28, 0xF9, 0x04, 0x18, 0xF6});
+        failed += run_lockstep(counted, [](const cpu& reference, const memory&) {
+            return reference.get_registers().general_de.bytes.high == 0;
+        });
+        failed += skipped(counted, true, on) != 0;
+
+        std::cout << "Test Idle Loops: failed = " << failed << std::endl;
+
+        return failed == 0;
+    }
+
+    int timer_test::run_lockstep(const memory& program, const std::function<int(const cpu&, const memory&)>& check)
+    {
+        auto failed = 0;
+        for (auto mode = 0; mode < 3; ++mode) {
+#ifndef GAMEBOY_JIT
+            if (mode == 2) {
+                continue;
+            }
+#endif
+            for (const auto step : {1, 5, 17, 64, 333}) {
+                memory reference_memory = program;
+                memory tested_memory = program;
+                timer reference_timer{reference_memory};
+                timer tested_timer{tested_memory};
+                cpu reference{reference_memory};
+                cpu tested{tested_memory};
+                tested.enable_block_cache(true);
+                if (mode == 1) {
+                    tested.enable_fusion(true);
+                }
+#ifdef GAMEBOY_JIT
+                else if (mode == 2) {
+                    tested.enable_jit(true);
+                }
+#endif
+
+                for (auto budget = step; budget < LOCKSTEP_CYCLES; budget += step) {
+                    failed += reference.run_until(budget) != tested.run_until(budget);
+                    failed += !same_registers(reference.get_registers(), tested.get_registers());
+                }
+                for (auto address = 0; address < 0x10000; ++address) {
+                    failed += reference_memory.get_byte(address) != tested_memory.get_byte(address);
+                }
+                failed += check(reference, reference_memory);
+            }
+        }
+
+        return failed;
+    }
+}
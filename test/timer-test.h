@@ -0,0 +1,34 @@
+#ifndef TIMER_TEST_H
+#define TIMER_TEST_H
+
+#include <functional>
+#include "cpu.h"
+#include "memory.h"
+
+namespace gameboy {
+    class timer_test {
+    public:
+        // DIV counting up every 256 cycles from its last reset
+        bool test_divider() const;
+        // the exact cycle TIMA overflows at for each rate, and the reload from TMA
+        bool test_overflow() const;
+        // increments from writes to DIV and TAC, and writes to TIMA moving the overflow
+        bool test_writes() const;
+        // a program polling the timer and counting its interrupts, with every way of running code against the
+        // interpreter
+        bool test_program() const;
+        // HALT and STOP sleeping until the timer interrupt, with IME on and off
+        bool test_halt() const;
+        // loops polling WRAM or IF skipped up to the timer interrupt, and ones polling DIV or counting left alone
+        bool test_idle_loops() const;
+    private:
+        // where the lockstep runs stop
+        static constexpr auto LOCKSTEP_CYCLES = 20000;
+
+        // runs program with a timer through the block cache, fusion and the JIT against the interpreter at many
+        // budgets, and then checks the interpreter's state
+        static int run_lockstep(const memory& program, const std::function<int(const cpu&, const memory&)>& check);
+    };
+}
+
+#endif